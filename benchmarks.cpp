@@ -0,0 +1,410 @@
+/**
+ * <h2>Microbenchmarks</h2>
+ * <p>Times the primitives of the engine over fixed pseudo-random inputs drawn from positions reached by
+ * random play, and reports nanoseconds per operation along with the L1 data cache and last level cache misses per
+ * operation, so that changes to the layout of the lookup tables can be judged with data.</p>
+ * <p>Each benchmark folds independent operations into one value, so it measures throughput rather than latency.
+ * Every sliding attack backend is measured regardless of the one the engine was built with, using tables of the
+ * benchmark's own.</p>
+ */
+#include <simple_chess/simple_chess.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * Counts a hardware event of the calling thread through the Linux performance counters. Where they are unavailable,
+ * for example in a container denying <code>perf_event_open</code>, <code>is_available</code> returns false.
+ */
+class hardware_event_counter {
+    private:
+        int descriptor = -1;
+    public:
+        hardware_event_counter([[maybe_unused]] const std::uint32_t type, [[maybe_unused]] const std::uint64_t config) {
+#if defined(__linux__)
+            perf_event_attr attributes {};
+            attributes.size = sizeof(attributes);
+            attributes.type = type;
+            attributes.config = config;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            descriptor = static_cast<int>(::syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+        }
+
+        hardware_event_counter(const hardware_event_counter&) = delete;
+        hardware_event_counter& operator=(const hardware_event_counter&) = delete;
+
+        ~hardware_event_counter() {
+            if (descriptor >= 0) ::close(descriptor);
+        }
+
+        [[nodiscard]] bool is_available() const { return descriptor >= 0; }
+
+        void start() {
+#if defined(__linux__)
+            if (!is_available()) return;
+            ::ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        /** Stops counting and returns the count since <code>start</code>. */
+        std::uint64_t stop() {
+            std::uint64_t count = 0;
+#if defined(__linux__)
+            if (!is_available()) return 0;
+            ::ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+            if (::read(descriptor, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif
+            return count;
+        }
+};
+
+/** Prevents the compiler from discarding the computation of the given value. */
+template<typename value_type>
+inline void keep(const value_type& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** The number of entries of every input array. A power of two, so that indices wrap with a mask. */
+constexpr std::size_t input_count = 4096;
+
+/** The arguments of one call to <code>lookup_target</code>, taken from a legal move. */
+struct target_query {
+    uint8_t origin;
+    uint8_t destination;
+    piece_type moved_piece_type;
+    piece_type destination_occupant_type;
+    piece_color aggressor_color;
+};
+
+/** A position in both layouts and its legal moves, for the <code>make_move</code> and copy-make round trips. */
+struct round_trip_input {
+    flat_chess_position position;
+    compact_chess_position compact;
+    move_buffer moves;
+};
+
+/** A move of one of the round trip positions, given by its index. */
+struct round_trip_query {
+    std::uint16_t position;
+    bitmove move;
+};
+
+struct benchmark_inputs {
+    std::array<uint8_t, input_count> squares;
+    std::vector<position_batch> batches;
+    std::array<bitboard, input_count> occupancies;
+    std::array<bitboard, input_count> rotated_occupancies;
+    std::array<target_query, input_count> target_queries;
+    std::vector<std::unique_ptr<round_trip_input>> round_trips;
+    std::array<round_trip_query, input_count> round_trip_queries;
+};
+
+/** The number of positions reached by random play, from those of the perft suite, which the inputs are drawn from. */
+constexpr std::size_t sample_position_count = 256;
+constexpr unsigned max_random_plies = 40;
+
+/**
+ * Plays random legal moves from the perft suite positions with a fixed seed, and draws the inputs of every benchmark
+ * from the positions reached, so that occupancies and moves are those of real games and the same on every run.
+ */
+benchmark_inputs generate_inputs() {
+    benchmark_inputs inputs;
+    std::uint64_t state = 0x5EED5EED5EED5EED;
+    while (inputs.round_trips.size() < sample_position_count) {
+        auto input = std::make_unique<round_trip_input>();
+        const perft_suite_entry& entry = perft_suite[splitmix64(state) % perft_suite.size()];
+        if (!load_fen(entry.fen, input->position)) continue;
+        const unsigned plies = splitmix64(state) % max_random_plies;
+        for (unsigned ply = 0; ply < plies; ++ply) {
+            move_buffer moves;
+            generate_legal_moves(input->position, moves);
+            if (moves.size == 0) break;
+            make_move(moves.moves[splitmix64(state) % moves.size], input->position);
+        }
+        generate_legal_moves(input->position, input->moves);
+        if (input->moves.size == 0) continue;
+        input->compact = to_compact_position(input->position);
+        inputs.round_trips.push_back(std::move(input));
+    }
+    inputs.batches.resize(sample_position_count / attack_batch_width);
+    for (std::size_t i = 0; i < sample_position_count; ++i) {
+        set_batch_lane(inputs.batches[i / attack_batch_width], i % attack_batch_width, inputs.round_trips[i]->position);
+    }
+    for (std::size_t i = 0; i < input_count; ++i) {
+        const round_trip_input& sample = *inputs.round_trips[splitmix64(state) % inputs.round_trips.size()];
+        const flat_chess_position& position = sample.position;
+        const bitboard occupancy = ~position.type_specific_bitboard[piece_type::none];
+        const bitmove move = sample.moves.moves[splitmix64(state) % sample.moves.size];
+        const uint8_t origin = move.unpack_origin();
+        const uint8_t destination = move.unpack_destination();
+        inputs.squares[i] = static_cast<uint8_t>(splitmix64(state) & 0b111111);
+        inputs.occupancies[i] = occupancy;
+        inputs.rotated_occupancies[i] = rotate_bitboard(occupancy);
+        // Consecutive round trips visit the positions in turn, so that they touch different positions as a search
+        // does when it moves between siblings.
+        const std::uint16_t position_index = i % inputs.round_trips.size();
+        const move_buffer& moves = inputs.round_trips[position_index]->moves;
+        inputs.round_trip_queries[i] = round_trip_query {
+            .position = position_index,
+            .move = moves.moves[splitmix64(state) % moves.size]
+        };
+        inputs.target_queries[i] = target_query {
+            .origin = origin,
+            .destination = destination,
+            .moved_piece_type = position.occupier_type_lookup_table[origin],
+            .destination_occupant_type = position.occupier_type_lookup_table[destination],
+            .aggressor_color = position.whos_turn
+        };
+    }
+    return inputs;
+}
+
+std::array<magic_entry, 64> magic_rooklike_entries {};
+std::array<magic_entry, 64> magic_bishoplike_entries {};
+std::array<bitboard, rooklike_attack_table_size> magic_rooklike_table {};
+std::array<bitboard, bishoplike_attack_table_size> magic_bishoplike_table {};
+#if defined(__BMI2__)
+std::array<magic_entry, 64> pext_rooklike_entries {};
+std::array<magic_entry, 64> pext_bishoplike_entries {};
+std::array<bitboard, rooklike_attack_table_size> pext_rooklike_table {};
+std::array<bitboard, bishoplike_attack_table_size> pext_bishoplike_table {};
+#endif
+
+/** Fills the benchmark's own magic and PEXT tables, which are independent of the engine's active backend. */
+void fill_backend_tables() {
+    fill_magic_table(magic_rooklike_entries, magic_rooklike_table, rooklike_magics, rooklike_directions, false);
+    fill_magic_table(magic_bishoplike_entries, magic_bishoplike_table, bishoplike_magics, bishoplike_directions, false);
+#if defined(__BMI2__)
+    fill_magic_table(pext_rooklike_entries, pext_rooklike_table, rooklike_magics, rooklike_directions, true);
+    fill_magic_table(pext_bishoplike_entries, pext_bishoplike_table, bishoplike_magics, bishoplike_directions, true);
+#endif
+}
+
+/**
+ * Checks the batch attack maps of the given kernel against <code>attacked_squares</code> for every sample position,
+ * so that the kernel is only timed once it is known to be right.
+ */
+template<typename vector_type>
+bool verify_batch_attack_maps(const benchmark_inputs& inputs) {
+    batch_attack_maps maps;
+    for (std::size_t i = 0; i < sample_position_count; ++i) {
+        if (i % attack_batch_width == 0) {
+            compute_batch_attack_maps<vector_type>(inputs.batches[i / attack_batch_width], maps);
+        }
+        const flat_chess_position& position = inputs.round_trips[i]->position;
+        const bitboard occupancy = ~position.type_specific_bitboard[piece_type::none];
+        for (const piece_color color : { piece_color::white, piece_color::black }) {
+            if (maps.all[color][i % attack_batch_width] != attacked_squares(position, color, occupancy)) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Checks <code>compute_batch_threats</code> of the given kernel against a square-by-square reading of
+ * <code>attackers_of</code> for every sample position: a piece other than a king is threatened if an opponent's
+ * piece of lower value attacks it, or if it is attacked and not defended.
+ */
+template<typename vector_type>
+bool verify_batch_threats(const benchmark_inputs& inputs) {
+    // The value order of the threats: pawns, then knights and bishops alike, then rooks, queens and kings.
+    constexpr std::array<int, 6> ranks = { 2, 1, 1, 3, 4, 0 };
+    batch_attack_maps maps;
+    std::array<batch_bitboards, 2> threatened;
+    for (std::size_t i = 0; i < sample_position_count; ++i) {
+        if (i % attack_batch_width == 0) {
+            const position_batch& batch = inputs.batches[i / attack_batch_width];
+            compute_batch_attack_maps<vector_type>(batch, maps);
+            compute_batch_threats<vector_type>(batch, maps, threatened);
+        }
+        const flat_chess_position& position = inputs.round_trips[i]->position;
+        const bitboard occupancy = ~position.type_specific_bitboard[piece_type::none];
+        for (const piece_color color : { piece_color::white, piece_color::black }) {
+            bitboard expected = 0;
+            for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+                const piece_type type = piece_type_on(position, sindex);
+                if (type == piece_type::none || type == piece_type::king
+                    || !(position.color_bitboard[color] & sbitboard(sindex))) continue;
+                const bitboard attackers = attackers_of(position, sindex, occupancy);
+                const bitboard opponents = attackers & position.color_bitboard[!color];
+                bool is_threatened = opponents && !(attackers & position.color_bitboard[color]);
+                for (uint8_t attacker = 0; attacker < 64; ++attacker) {
+                    if (opponents & sbitboard(attacker)) {
+                        is_threatened |= ranks[piece_type_on(position, attacker)] < ranks[type];
+                    }
+                }
+                if (is_threatened) expected |= sbitboard(sindex);
+            }
+            if (threatened[color][i % attack_batch_width] != expected) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Times <code>iterations</code> calls of the given operation, which is passed the iteration index and returns a
+ * value, and prints a row of the report.
+ */
+template<typename operation_type>
+void run_benchmark(const std::string_view name, const std::uint64_t iterations, const operation_type& operation) {
+    hardware_event_counter l1_misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    hardware_event_counter llc_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    std::uint64_t folded = 0;
+    l1_misses.start();
+    llc_misses.start();
+    const auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < iterations; ++i) folded ^= static_cast<std::uint64_t>(operation(i));
+    const auto end = std::chrono::steady_clock::now();
+    const std::uint64_t l1_count = l1_misses.stop();
+    const std::uint64_t llc_count = llc_misses.stop();
+    keep(folded);
+
+    const double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    const auto per_operation = [iterations](const std::uint64_t count) {
+        return static_cast<double>(count) / static_cast<double>(iterations);
+    };
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << nanoseconds / static_cast<double>(iterations);
+    if (l1_misses.is_available()) std::cout << std::setprecision(4) << std::setw(16) << per_operation(l1_count);
+    else std::cout << std::setw(16) << "-";
+    if (llc_misses.is_available()) std::cout << std::setprecision(4) << std::setw(16) << per_operation(llc_count);
+    else std::cout << std::setw(16) << "-";
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv) {
+    const std::vector<std::string_view> arguments(argv + 1, argv + argc);
+    std::uint64_t iterations = 20000000;
+    if (arguments.size() == 2 && arguments[0] == "--iterations") {
+        iterations = std::stoull(std::string(arguments[1]));
+    } else if (!arguments.empty()) {
+        std::cout << "Usage: simple_chess_benchmarks [--iterations <count>]\n";
+        return 1;
+    }
+
+    const benchmark_inputs inputs = generate_inputs();
+    fill_backend_tables();
+    constexpr std::size_t mask = input_count - 1;
+    std::cout << "sliding backend of the engine: "
+              << std::array { "rotated", "magic", "pext" }[static_cast<int>(active_sliding_backend)] << "\n"
+              << "table sizes: rooklike_move_table " << sizeof(rooklike_move_table) << " B, magic rooklike "
+              << sizeof(magic_rooklike_table) << " B, magic bishoplike " << sizeof(magic_bishoplike_table) << " B\n"
+              << (hardware_event_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES).is_available()
+                  ? "" : "hardware event counters are unavailable, so cache misses are not reported\n")
+              << "\n" << std::left << std::setw(36) << "benchmark" << std::right << std::setw(10) << "ns/op"
+              << std::setw(16) << "L1d misses/op" << std::setw(16) << "LLC misses/op" << "\n";
+
+    run_benchmark("rotate_sindex", iterations, [&](const std::uint64_t i) {
+        return rotate_sindex(inputs.squares[i & mask]);
+    });
+    run_benchmark("lookup_target", iterations, [&](const std::uint64_t i) {
+        const target_query& query = inputs.target_queries[i & mask];
+        return lookup_target(query.origin, query.destination, query.moved_piece_type,
+                             query.destination_occupant_type, query.aggressor_color);
+    });
+    run_benchmark("knight_move_table", iterations, [&](const std::uint64_t i) {
+        return knight_move_table[inputs.squares[i & mask]];
+    });
+    run_benchmark("rooklike_move_table (rank)", iterations, [&](const std::uint64_t i) {
+        return rank_attacks(inputs.squares[i & mask], inputs.occupancies[i & mask]);
+    });
+    run_benchmark("rooklike_move_table (file)", iterations, [&](const std::uint64_t i) {
+        return file_attacks(inputs.squares[i & mask], inputs.rotated_occupancies[i & mask]);
+    });
+    run_benchmark("rook attacks, rotated", iterations, [&](const std::uint64_t i) {
+        const uint8_t sindex = inputs.squares[i & mask];
+        return rank_attacks(sindex, inputs.occupancies[i & mask]) |
+               file_attacks(sindex, inputs.rotated_occupancies[i & mask]);
+    });
+    run_benchmark("rook attacks, magic", iterations, [&](const std::uint64_t i) {
+        const uint8_t sindex = inputs.squares[i & mask];
+        return magic_rooklike_table[magic_index(magic_rooklike_entries[sindex], inputs.occupancies[i & mask])];
+    });
+#if defined(__BMI2__)
+    run_benchmark("rook attacks, pext", iterations, [&](const std::uint64_t i) {
+        const uint8_t sindex = inputs.squares[i & mask];
+        return pext_rooklike_table[pext_index(pext_rooklike_entries[sindex], inputs.occupancies[i & mask])];
+    });
+#endif
+    run_benchmark("bishop attacks, rotated", iterations, [&](const std::uint64_t i) {
+        return diagonal_attacks(inputs.squares[i & mask], inputs.occupancies[i & mask]);
+    });
+    run_benchmark("bishop attacks, magic", iterations, [&](const std::uint64_t i) {
+        const uint8_t sindex = inputs.squares[i & mask];
+        return magic_bishoplike_table[magic_index(magic_bishoplike_entries[sindex], inputs.occupancies[i & mask])];
+    });
+#if defined(__BMI2__)
+    run_benchmark("bishop attacks, pext", iterations, [&](const std::uint64_t i) {
+        const uint8_t sindex = inputs.squares[i & mask];
+        return pext_bishoplike_table[pext_index(pext_bishoplike_entries[sindex], inputs.occupancies[i & mask])];
+    });
+#endif
+
+    // A copy-make writes a child which is then simply abandoned, so it needs no unmake.
+    run_benchmark("make_move + unmake_move", iterations / 4, [&](const std::uint64_t i) {
+        const round_trip_query& query = inputs.round_trip_queries[i & mask];
+        flat_chess_position& position = inputs.round_trips[query.position]->position;
+        make_move(query.move, position);
+        const zobrist_key hash = position.hash;
+        unmake_move(position);
+        return hash;
+    });
+    // The scalar kernel processes the same lanes with plain integer operations, as a baseline for the vector one.
+    constexpr std::array<std::string_view, 3> attack_kernel_names = { "scalar", "avx2", "avx512" };
+    if (!verify_batch_attack_maps<bitboard_vector>(inputs)
+        || !verify_batch_attack_maps<scalar_bitboard_vector<attack_batch_width>>(inputs)) {
+        std::cout << "batch attack maps disagree with attacked_squares\n";
+        return 1;
+    }
+    if (!verify_batch_threats<bitboard_vector>(inputs)
+        || !verify_batch_threats<scalar_bitboard_vector<attack_batch_width>>(inputs)) {
+        std::cout << "batch threats disagree with attackers_of\n";
+        return 1;
+    }
+    run_benchmark("attacked_squares, both colors", iterations / 4, [&](const std::uint64_t i) {
+        const flat_chess_position& position = inputs.round_trips[i % sample_position_count]->position;
+        const bitboard occupancy = ~position.type_specific_bitboard[piece_type::none];
+        return attacked_squares(position, piece_color::white, occupancy) ^
+               attacked_squares(position, piece_color::black, occupancy);
+    });
+    batch_attack_maps maps;
+    const std::string batch_suffix = ", batch of " + std::to_string(attack_batch_width);
+    const auto run_batch_benchmark = [&]<typename vector_type>(const std::string& name) {
+        run_benchmark(name + batch_suffix, iterations / 4 / attack_batch_width, [&](const std::uint64_t i) {
+            compute_batch_attack_maps<vector_type>(inputs.batches[i % inputs.batches.size()], maps);
+            return maps.all[piece_color::white][0] ^ maps.all[piece_color::black][attack_batch_width - 1];
+        });
+    };
+    run_batch_benchmark.template operator()<scalar_bitboard_vector<attack_batch_width>>("batch attack maps, scalar");
+    if constexpr (active_attack_kernel != attack_kernel::scalar) {
+        run_batch_benchmark.template operator()<bitboard_vector>(
+                "batch attack maps, " + std::string(attack_kernel_names[static_cast<int>(active_attack_kernel)]));
+    }
+
+    compact_chess_position child;
+    run_benchmark("copy_make_move", iterations / 4, [&](const std::uint64_t i) {
+        const round_trip_query& query = inputs.round_trip_queries[i & mask];
+        copy_make_move(query.move, inputs.round_trips[query.position]->compact, child);
+        return child.hash;
+    });
+    return 0;
+}
@@ -0,0 +1,370 @@
+#pragma once
+
+/**
+ * <h2>Batch Attack Maps</h2>
+ * <p>The squares attacked by each piece type of either color, computed for several positions at once with
+ * Kogge-Stone fills in the 64-bit lanes of a vector register.</p>
+ */
+
+#include "board.hpp"
+#include "position.hpp"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Batch Attack Maps
+
+/**
+ * The instruction set of the batch attack kernel. Like the network kernel, it defaults to the widest one the compiler
+ * targets, and may be overridden by defining <code>SIMPLE_CHESS_ATTACK_KERNEL</code>.
+ */
+enum class attack_kernel { scalar, avx2, avx512 };
+
+#if !defined(SIMPLE_CHESS_ATTACK_KERNEL)
+#if defined(__AVX512F__)
+#define SIMPLE_CHESS_ATTACK_KERNEL avx512
+#elif defined(__AVX2__)
+#define SIMPLE_CHESS_ATTACK_KERNEL avx2
+#else
+#define SIMPLE_CHESS_ATTACK_KERNEL scalar
+#endif
+#endif
+
+constexpr attack_kernel active_attack_kernel = attack_kernel::SIMPLE_CHESS_ATTACK_KERNEL;
+
+#if !defined(__AVX512F__)
+static_assert(active_attack_kernel != attack_kernel::avx512,
+              "The avx512 attack kernel requires an AVX-512F target, for example -mavx512f or -march=native.");
+#endif
+#if !defined(__AVX2__)
+static_assert(active_attack_kernel != attack_kernel::avx2,
+              "The avx2 attack kernel requires an AVX2 target, for example -mavx2 or -march=native.");
+#endif
+
+/**
+ * <p>A bitboard per lane, with the operations the fills need. The scalar vector loops over its lanes, which the
+ * compiler is free to vectorize for whatever target it has. Shifts by a positive count move bits towards the eighth
+ * rank, and by a negative count towards the first.</p>
+ */
+template<std::size_t lane_count>
+struct scalar_bitboard_vector {
+    static constexpr std::size_t lanes = lane_count;
+    std::array<bitboard, lanes> value;
+
+    [[nodiscard]] static scalar_bitboard_vector load(const bitboard* lanes_of) {
+        scalar_bitboard_vector vector;
+        for (std::size_t i = 0; i < lanes; ++i) vector.value[i] = lanes_of[i];
+        return vector;
+    }
+
+    [[nodiscard]] static scalar_bitboard_vector broadcast(const bitboard board) {
+        scalar_bitboard_vector vector;
+        vector.value.fill(board);
+        return vector;
+    }
+
+    void store(bitboard* lanes_of) const {
+        for (std::size_t i = 0; i < lanes; ++i) lanes_of[i] = value[i];
+    }
+
+    template<int shift>
+    [[nodiscard]] scalar_bitboard_vector shifted() const {
+        scalar_bitboard_vector vector;
+        for (std::size_t i = 0; i < lanes; ++i) {
+            if constexpr (shift > 0) vector.value[i] = value[i] << shift;
+            else vector.value[i] = value[i] >> -shift;
+        }
+        return vector;
+    }
+
+    friend scalar_bitboard_vector operator&(const scalar_bitboard_vector& a, const scalar_bitboard_vector& b) {
+        scalar_bitboard_vector vector;
+        for (std::size_t i = 0; i < lanes; ++i) vector.value[i] = a.value[i] & b.value[i];
+        return vector;
+    }
+
+    friend scalar_bitboard_vector operator|(const scalar_bitboard_vector& a, const scalar_bitboard_vector& b) {
+        scalar_bitboard_vector vector;
+        for (std::size_t i = 0; i < lanes; ++i) vector.value[i] = a.value[i] | b.value[i];
+        return vector;
+    }
+
+    /** The bits of <code>b</code> which are clear in <code>a</code>. */
+    [[nodiscard]] friend scalar_bitboard_vector and_not(const scalar_bitboard_vector& a,
+                                                        const scalar_bitboard_vector& b) {
+        scalar_bitboard_vector vector;
+        for (std::size_t i = 0; i < lanes; ++i) vector.value[i] = ~a.value[i] & b.value[i];
+        return vector;
+    }
+};
+
+#if defined(__AVX2__)
+/** As <code>scalar_bitboard_vector</code>, over the four lanes of an AVX2 register. */
+struct avx2_bitboard_vector {
+    static constexpr std::size_t lanes = 4;
+    __m256i value;
+
+    [[nodiscard]] static avx2_bitboard_vector load(const bitboard* lanes_of) {
+        return { _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes_of)) };
+    }
+
+    [[nodiscard]] static avx2_bitboard_vector broadcast(const bitboard board) {
+        return { _mm256_set1_epi64x(static_cast<long long>(board)) };
+    }
+
+    void store(bitboard* lanes_of) const { _mm256_store_si256(reinterpret_cast<__m256i*>(lanes_of), value); }
+
+    template<int shift>
+    [[nodiscard]] avx2_bitboard_vector shifted() const {
+        if constexpr (shift > 0) return { _mm256_slli_epi64(value, shift) };
+        else return { _mm256_srli_epi64(value, -shift) };
+    }
+
+    friend avx2_bitboard_vector operator&(const avx2_bitboard_vector a, const avx2_bitboard_vector b) {
+        return { _mm256_and_si256(a.value, b.value) };
+    }
+
+    friend avx2_bitboard_vector operator|(const avx2_bitboard_vector a, const avx2_bitboard_vector b) {
+        return { _mm256_or_si256(a.value, b.value) };
+    }
+
+    [[nodiscard]] friend avx2_bitboard_vector and_not(const avx2_bitboard_vector a, const avx2_bitboard_vector b) {
+        return { _mm256_andnot_si256(a.value, b.value) };
+    }
+};
+#endif
+
+#if defined(__AVX512F__)
+/** As <code>scalar_bitboard_vector</code>, over the eight lanes of an AVX-512 register. */
+struct avx512_bitboard_vector {
+    static constexpr std::size_t lanes = 8;
+    __m512i value;
+
+    [[nodiscard]] static avx512_bitboard_vector load(const bitboard* lanes_of) {
+        return { _mm512_load_si512(lanes_of) };
+    }
+
+    [[nodiscard]] static avx512_bitboard_vector broadcast(const bitboard board) {
+        return { _mm512_set1_epi64(static_cast<long long>(board)) };
+    }
+
+    void store(bitboard* lanes_of) const { _mm512_store_si512(lanes_of, value); }
+
+    template<int shift>
+    [[nodiscard]] avx512_bitboard_vector shifted() const {
+        if constexpr (shift > 0) return { _mm512_slli_epi64(value, shift) };
+        else return { _mm512_srli_epi64(value, -shift) };
+    }
+
+    friend avx512_bitboard_vector operator&(const avx512_bitboard_vector a, const avx512_bitboard_vector b) {
+        return { _mm512_and_si512(a.value, b.value) };
+    }
+
+    friend avx512_bitboard_vector operator|(const avx512_bitboard_vector a, const avx512_bitboard_vector b) {
+        return { _mm512_or_si512(a.value, b.value) };
+    }
+
+    [[nodiscard]] friend avx512_bitboard_vector and_not(const avx512_bitboard_vector a,
+                                                        const avx512_bitboard_vector b) {
+        return { _mm512_andnot_si512(a.value, b.value) };
+    }
+};
+#endif
+
+template<attack_kernel kernel>
+struct bitboard_vector_of {
+    using type = scalar_bitboard_vector<4>;
+};
+
+#if defined(__AVX2__)
+template<>
+struct bitboard_vector_of<attack_kernel::avx2> {
+    using type = avx2_bitboard_vector;
+};
+#endif
+
+#if defined(__AVX512F__)
+template<>
+struct bitboard_vector_of<attack_kernel::avx512> {
+    using type = avx512_bitboard_vector;
+};
+#endif
+
+using bitboard_vector = bitboard_vector_of<active_attack_kernel>::type;
+
+/** The number of positions of a batch, one per lane of <code>bitboard_vector</code>. */
+constexpr std::size_t attack_batch_width = bitboard_vector::lanes;
+
+/** A bitboard per position of a batch, aligned for loading into a vector register. */
+using batch_bitboards = std::array<bitboard, attack_batch_width>;
+
+/**
+ * <h2>Position Batch</h2>
+ * <p>The boards of <code>attack_batch_width</code> positions, in structure-of-arrays form: each bitboard of
+ * <code>color_bitboard</code> and <code>type_specific_bitboard</code> is stored for every position side by side, so
+ * that one load fills a vector register with the same bitboard of every position. Lanes left empty hold no pieces, and
+ * so attack nothing.</p>
+ */
+struct alignas(64) position_batch {
+    std::array<batch_bitboards, 2> colors {};
+    std::array<batch_bitboards, 6> types {};
+};
+
+/** Copies the board of the given position into a lane of the batch. */
+template<typename position_type>
+void set_batch_lane(position_batch& batch, const std::size_t lane, const position_type& position) {
+    for (const piece_color color : { piece_color::white, piece_color::black })
+        batch.colors[color][lane] = color_bitboards(position)[color];
+    for (uint8_t type = piece_type::rook; type < piece_type::none; ++type)
+        batch.types[type][lane] = piece_bitboards(position)[type];
+}
+
+/**
+ * The attack maps of a batch, indexed by color, then by the piece type of the attackers, then by lane. The map of a
+ * type holds every square a piece of that type attacks, whether empty or occupied by a piece of either color.
+ */
+struct alignas(64) batch_attack_maps {
+    std::array<std::array<batch_bitboards, 6>, 2> by_type;
+    std::array<batch_bitboards, 2> all;
+};
+
+/**
+ * The squares reached from the generators in the direction of the shift, moving only through the squares of the
+ * propagator, which the caller has cleared of the file the shift would wrap into. The fill takes three doubling steps
+ * rather than seven single ones.
+ */
+template<int shift, typename vector_type>
+[[nodiscard]] vector_type occluded_fill(vector_type generators, vector_type propagator) {
+    generators = generators | (propagator & generators.template shifted<shift>());
+    propagator = propagator & propagator.template shifted<shift>();
+    generators = generators | (propagator & generators.template shifted<2 * shift>());
+    propagator = propagator & propagator.template shifted<2 * shift>();
+    return generators | (propagator & generators.template shifted<4 * shift>());
+}
+
+/**
+ * The squares attacked by the given sliders in the direction of the shift: the fill through the empty squares, and
+ * one step further onto the first occupied square, if any. <code>wrap_mask</code> excludes the file on which the
+ * shift lands after leaving the board sideways.
+ */
+template<int shift, typename vector_type>
+[[nodiscard]] vector_type sliding_attacks(const vector_type sliders, const vector_type empty,
+                                          const vector_type wrap_mask) {
+    return occluded_fill<shift>(sliders, empty & wrap_mask).template shifted<shift>() & wrap_mask;
+}
+
+/** The squares attacked along both diagonals by the given sliders. */
+template<typename vector_type>
+[[nodiscard]] vector_type diagonal_batch_attacks(const vector_type sliders, const vector_type empty) {
+    const vector_type not_a_file = vector_type::broadcast(~file_bitboard(0));
+    const vector_type not_h_file = vector_type::broadcast(~file_bitboard(7));
+    return sliding_attacks<9>(sliders, empty, not_a_file) | sliding_attacks<7>(sliders, empty, not_h_file) |
+           sliding_attacks<-7>(sliders, empty, not_a_file) | sliding_attacks<-9>(sliders, empty, not_h_file);
+}
+
+/** The squares attacked along ranks and files by the given sliders. */
+template<typename vector_type>
+[[nodiscard]] vector_type orthogonal_batch_attacks(const vector_type sliders, const vector_type empty) {
+    const vector_type all_files = vector_type::broadcast(~bitboard(0));
+    return sliding_attacks<8>(sliders, empty, all_files) | sliding_attacks<-8>(sliders, empty, all_files) |
+           sliding_attacks<1>(sliders, empty, vector_type::broadcast(~file_bitboard(0))) |
+           sliding_attacks<-1>(sliders, empty, vector_type::broadcast(~file_bitboard(7)));
+}
+
+template<typename vector_type>
+[[nodiscard]] vector_type knight_batch_attacks(const vector_type knights) {
+    const vector_type not_a_file = vector_type::broadcast(~file_bitboard(0));
+    const vector_type not_h_file = vector_type::broadcast(~file_bitboard(7));
+    const vector_type not_ab_files = vector_type::broadcast(~(file_bitboard(0) | file_bitboard(1)));
+    const vector_type not_gh_files = vector_type::broadcast(~(file_bitboard(6) | file_bitboard(7)));
+    return (knights.template shifted<17>() & not_a_file) | (knights.template shifted<15>() & not_h_file) |
+           (knights.template shifted<10>() & not_ab_files) | (knights.template shifted<6>() & not_gh_files) |
+           (knights.template shifted<-6>() & not_ab_files) | (knights.template shifted<-10>() & not_gh_files) |
+           (knights.template shifted<-15>() & not_a_file) | (knights.template shifted<-17>() & not_h_file);
+}
+
+template<typename vector_type>
+[[nodiscard]] vector_type king_batch_attacks(const vector_type kings) {
+    const vector_type beside = (kings.template shifted<1>() & vector_type::broadcast(~file_bitboard(0))) |
+                               (kings.template shifted<-1>() & vector_type::broadcast(~file_bitboard(7)));
+    const vector_type row = kings | beside;
+    return beside | row.template shifted<8>() | row.template shifted<-8>();
+}
+
+template<piece_color color, typename vector_type>
+[[nodiscard]] vector_type pawn_batch_attacks(const vector_type pawns) {
+    const vector_type not_a_file = vector_type::broadcast(~file_bitboard(0));
+    const vector_type not_h_file = vector_type::broadcast(~file_bitboard(7));
+    if constexpr (color == piece_color::white)
+        return (pawns.template shifted<9>() & not_a_file) | (pawns.template shifted<7>() & not_h_file);
+    else return (pawns.template shifted<-7>() & not_a_file) | (pawns.template shifted<-9>() & not_h_file);
+}
+
+/**
+ * <h2>Batch Attack Map Kernel</h2>
+ * <p>Computes the attack maps of every position of the batch at once. Where the scalar <code>attacked_squares</code>
+ * looks up the attacks of one piece after another, a chain of dependent loads per position, the kernel computes
+ * the attacks of all the pieces of a type together, by shifting and masking whole bitboards. Sliding attacks are
+ * Kogge-Stone fills through the empty squares, three steps in each of the eight directions, for every lane of the
+ * register at once, so the throughput grows with the width of the vector.</p>
+ */
+template<typename vector_type = bitboard_vector>
+void compute_batch_attack_maps(const position_batch& batch, batch_attack_maps& maps) {
+    static_assert(vector_type::lanes == attack_batch_width);
+    const vector_type empty = and_not(vector_type::load(batch.colors[0].data()) |
+                                      vector_type::load(batch.colors[1].data()), vector_type::broadcast(~bitboard(0)));
+    const auto compute = [&]<piece_color color>() {
+        const vector_type own = vector_type::load(batch.colors[color].data());
+        const auto pieces = [&](const piece_type type) { return own & vector_type::load(batch.types[type].data()); };
+        std::array<vector_type, 6> attacks;
+        attacks[piece_type::rook] = orthogonal_batch_attacks(pieces(piece_type::rook), empty);
+        attacks[piece_type::knight] = knight_batch_attacks(pieces(piece_type::knight));
+        attacks[piece_type::bishop] = diagonal_batch_attacks(pieces(piece_type::bishop), empty);
+        attacks[piece_type::queen] = orthogonal_batch_attacks(pieces(piece_type::queen), empty) |
+                                     diagonal_batch_attacks(pieces(piece_type::queen), empty);
+        attacks[piece_type::king] = king_batch_attacks(pieces(piece_type::king));
+        attacks[piece_type::pawn] = pawn_batch_attacks<color>(pieces(piece_type::pawn));
+        vector_type all = attacks[0];
+        for (uint8_t type = piece_type::rook; type < piece_type::none; ++type) {
+            attacks[type].store(maps.by_type[color][type].data());
+            all = all | attacks[type];
+        }
+        all.store(maps.all[color].data());
+    };
+    compute.template operator()<piece_color::white>();
+    compute.template operator()<piece_color::black>();
+}
+
+/**
+ * <p>The pieces of each color, the kings aside, which the opponent could capture at a profit by static exchange, as
+ * read off the attack maps: those attacked by a piece of lower value, knights and bishops counting as equal, and
+ * those attacked and not defended at all.
+ * Pins and pieces lined up behind others are not considered, as in <code>static_exchange_evaluation</code>, but
+ * neither is the order of recaptures, so a piece attacked twice and defended once is not counted.</p>
+ * <p>It tells which positions of a batch hold a profitable capture, and so are not quiet, without running the
+ * exchange of each capture. The benchmarks check it against <code>attackers_of</code>.</p>
+ */
+template<typename vector_type = bitboard_vector>
+void compute_batch_threats(const position_batch& batch, const batch_attack_maps& maps,
+                           std::array<batch_bitboards, 2>& threatened) {
+    const auto load = [](const batch_bitboards& lanes_of) { return vector_type::load(lanes_of.data()); };
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        const piece_color opponent = !color;
+        const vector_type own = load(batch.colors[color]);
+        const vector_type queens = own & load(batch.types[piece_type::queen]);
+        const vector_type majors = queens | (own & load(batch.types[piece_type::rook]));
+        const vector_type pieces = majors | (own & (load(batch.types[piece_type::bishop]) |
+                                                    load(batch.types[piece_type::knight])));
+        const std::array<batch_bitboards, 6>& attacks = maps.by_type[opponent];
+        const vector_type minor_attacks = load(attacks[piece_type::knight]) | load(attacks[piece_type::bishop]);
+        const vector_type undefended = and_not(load(maps.all[color]), load(maps.all[opponent]));
+        const vector_type threats = (load(attacks[piece_type::pawn]) & pieces) | (minor_attacks & majors) |
+                                    (load(attacks[piece_type::rook]) & queens) |
+                                    (undefended & and_not(load(batch.types[piece_type::king]), own));
+        threats.store(threatened[color].data());
+    }
+}
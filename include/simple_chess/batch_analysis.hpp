@@ -0,0 +1,205 @@
+#pragma once
+
+/**
+ * <h2>Batch Analysis</h2>
+ * <p>Searching every record of a FEN, EPD or packed dataset file in parallel.</p>
+ */
+
+#include "packed_position.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Batch Analysis
+
+/** The outcome of analyzing one record of a batch. */
+struct batch_analysis_entry {
+    bool is_well_formed = false;
+    search_result result;
+};
+
+struct batch_analysis_statistics {
+    std::uint64_t positions = 0;
+    std::uint64_t malformed = 0;
+    std::uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+/**
+ * Appends the result of analyzing a record to the given buffer as the operations of an EPD record: <code>acd</code>
+ * (depth), <code>acn</code> (nodes), <code>bm</code> (best move, in long algebraic notation) and <code>ce</code>
+ * (score in centipawns, from the side to move).
+ */
+inline void append_epd_operations(std::string& buffer, const search_result& result) {
+    buffer += "acd ";
+    append_integer(buffer, result.depth);
+    buffer += "; acn ";
+    append_integer(buffer, result.nodes);
+    buffer += "; bm ";
+    buffer += result.best_move.is_null() ? "0000" : to_long_algebraic(result.best_move);
+    buffer += "; ce ";
+    append_integer(buffer, result.score);
+    buffer += ";\n";
+}
+
+/**
+ * Reads FEN or EPD records from a stream, in batches, into line buffers which are reused from batch to batch, so
+ * once the buffers have grown to fit the longest record, neither reading nor parsing allocates. Blank lines and lines
+ * beginning with <code>#</code> are skipped.
+ */
+class epd_record_source {
+    private:
+        std::istream& input;
+        std::vector<std::string> records;
+    public:
+        explicit epd_record_source(std::istream& input) : input(input) {}
+
+        /** Reads up to the given number of records and returns the number read. */
+        std::size_t next_batch(const std::size_t batch_size) {
+            records.resize(std::max(records.size(), batch_size));
+            std::size_t record_count = 0;
+            while (record_count < batch_size && std::getline(input, records[record_count])) {
+                const std::string_view record = records[record_count];
+                const std::size_t first = record.find_first_not_of(" \t\r");
+                if (first == std::string_view::npos || record[first] == '#') continue;
+                ++record_count;
+            }
+            return record_count;
+        }
+
+        [[nodiscard]] bool load(const std::size_t index, search_position& position) const {
+            return load_fen(records[index], position);
+        }
+
+        /** Appends the four position fields of the given record, or the whole record if it is malformed. */
+        void append_position(std::string& buffer, const std::size_t index, const bool is_well_formed) const {
+            std::string_view record = records[index];
+            if (!is_well_formed) {
+                buffer += "; malformed: ";
+                buffer += record;
+                return;
+            }
+            for (int i = 0; i < 4; ++i) {
+                buffer += take_field(record);
+                buffer += ' ';
+            }
+        }
+};
+
+/** Reads the records of a mapped dataset of packed positions in place, in batches. */
+class packed_record_source {
+    private:
+        std::span<const packed_position> records;
+        std::size_t batch_begin = 0;
+        std::size_t batch_end = 0;
+    public:
+        explicit packed_record_source(const std::span<const packed_position> records) : records(records) {}
+
+        std::size_t next_batch(const std::size_t batch_size) {
+            batch_begin = batch_end;
+            batch_end = std::min(records.size(), batch_begin + batch_size);
+            return batch_end - batch_begin;
+        }
+
+        [[nodiscard]] bool load(const std::size_t index, search_position& position) const {
+            return unpack_position(records[batch_begin + index], position);
+        }
+
+        /** Appends the position of the given record as the four position fields of FEN. */
+        void append_position(std::string& buffer, const std::size_t index, const bool is_well_formed) const {
+            search_position position;
+            if (!is_well_formed || !unpack_position(records[batch_begin + index], position)) {
+                buffer += "; malformed: record ";
+                append_integer(buffer, batch_begin + index);
+                return;
+            }
+            std::array<char, max_fen_length> fen;
+            std::string_view fields(fen.data(), write_fen(position, fen));
+            for (int i = 0; i < 4; ++i) {
+                buffer += take_field(fields);
+                buffer += ' ';
+            }
+        }
+};
+
+/**
+ * <h2>Batch Analysis</h2>
+ * <p>Searches every position of the given source of records to the given limits, and writes one EPD record of
+ * results per position to the output, in the order of the input. The source is either an
+ * <code>epd_record_source</code> or a <code>packed_record_source</code>.</p>
+ * <p>Records are read in batches of <code>batch_size</code>, and the records of a batch are claimed one at a time by
+ * the threads, so that a thread landing on a slow position does not hold up the others.</p>
+ * <p>Each thread owns a search worker and a transposition table, and the table is cleared before every position.
+ * A position's result therefore depends only on the position and the limits, never on which thread searched it or
+ * what that thread searched before, and the output is identical for any number of threads. For the same reason the
+ * limits should be in depth or nodes, not time.</p>
+ */
+template<typename record_source>
+batch_analysis_statistics analyze_batch(record_source& source, std::ostream& output, const search_limits& limits,
+                                        const unsigned thread_count, const std::size_t hash_megabytes) {
+    const std::size_t batch_size = 256 * thread_count;
+    std::vector<batch_analysis_entry> entries(batch_size);
+    std::string output_buffer;
+    std::atomic<bool> stop_signal = false;
+    const search_position empty_position {};
+
+    std::vector<std::unique_ptr<transposition_table>> tables;
+    std::vector<std::unique_ptr<search_worker>> workers;
+    for (unsigned id = 0; id < thread_count; ++id) {
+        tables.push_back(std::make_unique<transposition_table>(hash_megabytes));
+        workers.push_back(std::make_unique<search_worker>(empty_position, *tables.back(), limits, stop_signal));
+    }
+
+    batch_analysis_statistics statistics;
+    statistics.seconds = time_seconds([&] {
+        std::size_t record_count;
+        do {
+            record_count = source.next_batch(batch_size);
+
+            std::atomic<std::size_t> next_record = 0;
+            const auto run_thread = [&](const unsigned id) {
+                search_position position;
+                for (std::size_t i; (i = next_record.fetch_add(1, std::memory_order_relaxed)) < record_count;) {
+                    batch_analysis_entry& entry = entries[i];
+                    entry.is_well_formed = source.load(i, position);
+                    if (!entry.is_well_formed) continue;
+                    tables[id]->clear();
+                    workers[id]->reset(position, limits);
+                    entry.result = workers[id]->iterative_deepening(nullptr);
+                }
+            };
+            std::vector<std::thread> helper_threads;
+            for (unsigned id = 1; id < thread_count && id < record_count; ++id) {
+                helper_threads.emplace_back(run_thread, id);
+            }
+            run_thread(0);
+            for (std::thread& thread : helper_threads) thread.join();
+
+            output_buffer.clear();
+            for (std::size_t i = 0; i < record_count; ++i) {
+                source.append_position(output_buffer, i, entries[i].is_well_formed);
+                if (entries[i].is_well_formed) {
+                    append_epd_operations(output_buffer, entries[i].result);
+                } else {
+                    output_buffer += '\n';
+                }
+                ++statistics.positions;
+                statistics.malformed += !entries[i].is_well_formed;
+                if (entries[i].is_well_formed) statistics.nodes += entries[i].result.nodes;
+            }
+            output.write(output_buffer.data(), static_cast<std::streamsize>(output_buffer.size()));
+        } while (record_count == batch_size);
+        output.flush();
+    });
+    return statistics;
+}
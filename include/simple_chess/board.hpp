@@ -0,0 +1,229 @@
+#pragma once
+
+/**
+ * <h2>Board Representation</h2>
+ * <p>Squares, bitboards, pieces and moves, and the choice of sliding attack backend.</p>
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+
+enum piece_color: bool { white = true, black = false };
+constexpr piece_color operator!(piece_color original) { return static_cast<piece_color>(!static_cast<bool>(original)); }
+
+/**
+ * A color fixed at compile time. Functions taking a color as a template argument of type <code>color_type</code>
+ * accept either a <code>piece_color</code>, read at runtime, or a <code>color_constant</code>, which makes the color
+ * a constant of the instantiation so that every color dependent branch and index folds away.
+ */
+template<piece_color color>
+using color_constant = std::integral_constant<piece_color, color>;
+
+/**
+ * A bitboard is a low resolution chess board. That is, a bitboard has the structure of a chess board (8x8 squares)
+ * but does not posses the capability of storing exact piece type and color. Instead, a square on a bitboard is
+ * considered either "marked" or "unmarked", based on the value of the bit (0 or 1) corresponding to the square.
+ *
+ * <pre>\n
+ * _         Black         \n
+ * Queenside      Kingside \n
+ * 56 57 58 59 60 61 62 63 \n
+ * 48 49 50 51 52 53 54 55 \n
+ * 40 41 42 45 44 45 46 47 \n
+ * 32 33 34 35 36 37 38 39 \n
+ * 24 25 26 27 28 29 30 31 \n
+ * 16 17 18 19 20 21 22 23 \n
+ * 8  9  10 11 12 13 14 15 \n
+ * 0  1  2  3  4  5  6  7  \n
+ * Queenside      Kingside \n
+ * _         White         \n
+ * </pre>\n
+ *
+ * The square labeled with <i>n</i> is marked by setting the <nobr>(<i>n</i> + 1)th</nobr> least significant bit in
+ * the bitboard. \n\n
+ *
+ * The clearest way to mark a square in a bitboard is using bitwise OR in conjunction with the <code>singleton</code>
+ * function.
+ */
+using bitboard = std::uint64_t;
+
+/**
+ * A bitlane represents 8 consecutive bits of a bitboard.\n\n
+ * On a <b>standard bitboard</b>, a bitlane typically describes the occupancy of a rank. The <nobr>(<i>n</i> + 1)th</nobr>
+ * least significant bit corresponds to the <nobr>(<i>n</i> + 1)th</nobr> queenside-most square of a rank. \n\n
+ * On a <b>rotated bitboard</b>, a bitlane typically describes the occupancy of a file.
+ */
+using bitlane = std::uint8_t;
+
+/**
+ * Creates a singleton bitlane. That is, a bitlane where only a single square is marked.
+ * In the context of <b>standard bitboards</b> this returns a bitlane with the <nobr>(<i>n</i> + 1)th</nobr>
+ * queenside-most square is marked.
+ */
+[[nodiscard]] constexpr bitlane sbitlane(const std::uint8_t n) { return ((bitlane) 1) << n; }
+
+/**
+ * Converts a rank-file coordinate the index of the bit corresponding to that coordinate within a bitboard.  \n\n
+ * Ranks are indexed [0, 7] beginning with the white edge of the board. \n\n
+ * Files are indexed [0, 7] beginning with the queenside edge of the board.\n\n
+ */
+[[nodiscard]] constexpr uint8_t coords_to_sindex(const std::uint8_t rank, const std::uint8_t file) { return rank * 8 + file; }
+
+/** Converts a standard sindex to a rotated sindex and vice versa.  */
+[[nodiscard]] constexpr std::uint8_t rotate_sindex(std::uint8_t original) {
+    const uint8_t a = original >> 3;
+    const uint8_t b = original & 0b111;
+    return (b * 8) + a;
+}
+
+/**
+ * Converts a standard bitboard into a rotated bitboard and vice versa, by transposing the board across the a1-h8
+ * diagonal. This is the bitboard counterpart of <code>rotate_sindex</code>.
+ */
+[[nodiscard]] constexpr std::uint64_t rotate_bitboard(std::uint64_t board) {
+    std::uint64_t t = 0x0F0F0F0F00000000 & (board ^ (board << 28));
+    board ^= t ^ (t >> 28);
+    t = 0x3333000033330000 & (board ^ (board << 14));
+    board ^= t ^ (t >> 14);
+    t = 0x5500550055005500 & (board ^ (board << 7));
+    board ^= t ^ (t >> 7);
+    return board;
+}
+
+[[nodiscard]] consteval bitlane rank_literal(bool f0, bool f1, bool f2, bool f3, bool f4, bool f5, bool f6, bool f7) {
+    bitlane rank = 0;
+    if (f0) rank |= sbitlane(0);
+    if (f1) rank |= sbitlane(1);
+    if (f2) rank |= sbitlane(2);
+    if (f3) rank |= sbitlane(3);
+    if (f4) rank |= sbitlane(4);
+    if (f5) rank |= sbitlane(5);
+    if (f6) rank |= sbitlane(6);
+    if (f7) rank |= sbitlane(7);
+    return rank;
+}
+
+/** Creates a singleton bitboard. That is, a bitboard where only a single square is marked. */
+[[nodiscard]] constexpr bitboard sbitboard(const std::uint8_t square_index) { return static_cast<bitboard>(1) << square_index; }
+
+inline void print_bitboard(const bitboard board) {
+    for (std::uint8_t rank = 8; rank > 0; --rank) {
+        const uint8_t rank_begin_sindex = (rank - 1) * 8;
+        const uint8_t rank_end_sindex = rank_begin_sindex + 8;
+        for (std::uint8_t sindex = rank_begin_sindex; sindex < rank_end_sindex; ++sindex) {
+            std::cout << ((board & sbitboard(sindex)) ? '1' : '0');
+            std::cout << "  ";
+        }
+        std::cout << std::endl;
+    }
+}
+
+inline void print_rank(const bitlane lane) {
+    for (std::uint8_t file = 0; file < 8; file++) {
+        std::cout << ((sbitlane(file) & lane) ? "1" : "0");
+    }
+    std::cout << "\n";
+}
+
+enum piece_type: uint8_t { rook = 0, knight = 1, bishop = 2, queen = 3, king = 4, pawn = 5, none = 6 };
+
+/**
+ * <h2>Space-Efficient, Forward, Chess Move Representation</h2>
+ * <h3>Origin & Destination Squares</h3>
+ * <p>There are 64 squares on a chess board, which means for every move there are 64 possible
+ * origin squares, and 63 possible destination squares. log2(64) = 6, therefore 6 bits are sufficient for
+ * describing the origin square. Similarly, ceil(log2(63)) = 6, so six bits must be reserved for describing
+ * the destination square.</p>
+ *
+ * <h3>Promotion</h3>
+ * <p>It is possible for a piece to transform in type after it has been moved.
+ * Specifically, when a pawn which reaches the opposite end of the board it becomes a major/minor piece
+ * of the player's choosing. A pawn may be promoted to a [Rook, Knight, Bishop, Queen].
+ * Therefore, 3 bits are necessary to describe the desired promotion.</p>
+ *
+ * <h3>Memory Layout</h3>
+ * <p>The following table illustrates the layout of the move data over <code>std::uint16_t</code>.
+ * <pre>\n
+ * n  | 16 15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 \n
+ * v  | () (promot) (destination) (origin    )
+ * \n\n</pre>
+ * Where <i>v</i> describes the value occupying the <i>n</i>th least significant bit.</p>\n\n
+ */
+class bitmove {
+    private:
+        std::uint16_t data;
+    public:
+        bitmove() = default;
+
+        /** Reconstitutes a move from the value returned by <code>pack</code>. */
+        [[nodiscard]] static constexpr bitmove from_packed(const std::uint16_t data) {
+            bitmove move;
+            move.data = data;
+            return move;
+        }
+
+        /**
+         * The null move, which moves nothing. Its packed value is zero, a move from the first square to itself, which
+         * no real move can be.
+         */
+        [[nodiscard]] static constexpr bitmove null() { return from_packed(0); }
+
+        constexpr bitmove(const uint8_t origin, const uint8_t destination, const piece_type promote_to) {
+            assert(origin < 64 && destination < 64 && origin != destination);
+
+            data = (static_cast<uint16_t>(promote_to) << 12) |
+                   (static_cast<uint16_t>(destination) << 6) |
+                   static_cast<uint16_t>(origin);
+        }
+        [[nodiscard]] constexpr uint8_t unpack_origin() const { return data & 0b111111; }
+        [[nodiscard]] constexpr uint8_t unpack_destination() const { return (data >> 6) & 0b111111; }
+        [[nodiscard]] constexpr piece_type unpack_promotion() const { return static_cast<piece_type>((data >> 12) & 0b111); }
+
+        [[nodiscard]] constexpr std::tuple<uint8_t, uint8_t, piece_type> unpack_all() const {
+            return std::make_tuple(unpack_origin(), unpack_destination(), unpack_promotion());
+        }
+
+        [[nodiscard]] constexpr std::uint16_t pack() const { return data; }
+        [[nodiscard]] constexpr bool is_null() const { return data == 0; }
+
+        [[nodiscard]] constexpr bool operator==(const bitmove&) const = default;
+};
+
+/**
+ * <h2>Sliding Attack Backends</h2>
+ * <p>The attacks of a sliding piece depend upon the occupancy of the squares it slides over. Three interchangeable
+ * strategies for computing them are provided.</p>
+ * <ul>
+ * <li><b>rotated</b> resolves ranks through <code>rooklike_move_table</code>, files through the same table applied to
+ * the rotated occupancy, and diagonals by scanning <code>diagonal_ray_table</code> for the nearest blocker. It
+ * requires <code>make_move</code> to keep <code>color_bitboard_rotated</code> in sync.</li>
+ * <li><b>magic</b> maps the relevant occupancy of the slider onto a dense index with a multiplication by a
+ * precomputed magic number and a shift, and reads the attacks from a table in a single lookup.</li>
+ * <li><b>pext</b> shares the magic attack tables, but computes the index with the BMI2 <code>_pext_u64</code>
+ * instruction instead of the multiplication.</li>
+ * </ul>
+ * <p>The backend is chosen at build time with <code>SIMPLE_CHESS_SLIDING_BACKEND</code>. It defaults to
+ * <b>pext</b> when compiling for a target with BMI2, and to <b>magic</b> otherwise.</p>
+ */
+enum class sliding_attack_backend { rotated, magic, pext };
+
+#if !defined(SIMPLE_CHESS_SLIDING_BACKEND)
+#if defined(__BMI2__)
+#define SIMPLE_CHESS_SLIDING_BACKEND pext
+#else
+#define SIMPLE_CHESS_SLIDING_BACKEND magic
+#endif
+#endif
+
+constexpr sliding_attack_backend active_sliding_backend = sliding_attack_backend::SIMPLE_CHESS_SLIDING_BACKEND;
+
+/** When false, <code>color_bitboard_rotated</code> is not maintained by <code>make_move</code> and must not be read. */
+constexpr bool maintains_rotated_bitboards = active_sliding_backend == sliding_attack_backend::rotated;
+
+#if !defined(__BMI2__)
+static_assert(active_sliding_backend != sliding_attack_backend::pext,
+              "The pext sliding attack backend requires a BMI2 target, for example -mbmi2 or -march=native.");
+#endif
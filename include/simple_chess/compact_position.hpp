@@ -0,0 +1,221 @@
+#pragma once
+
+/**
+ * <h2>Compact Position</h2>
+ * <p>A 64 byte position for copy-make, whose board is four bitboards.</p>
+ */
+
+#include "move_generation.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Compact Position
+
+/** The number of bit planes which encode the type of the piece on each square, see <code>compact_piece_code</code>. */
+constexpr std::size_t compact_type_plane_count = 3;
+
+/** The index of the plane marking the white pieces. */
+constexpr std::size_t compact_white_plane = 3;
+
+/**
+ * The 3-bit code of a piece type in the type planes of <code>compact_chess_position</code>, the piece type plus one,
+ * so that an empty square is zero in every plane.
+ */
+[[nodiscard]] constexpr uint8_t compact_piece_code(const piece_type type) {
+    return type == piece_type::none ? 0 : type + 1;
+}
+
+/** The piece type of each 3-bit code, the inverse of <code>compact_piece_code</code>. Code 7 is never stored. */
+constexpr std::array<piece_type, 8> compact_code_piece_types = {
+    piece_type::none, piece_type::rook, piece_type::knight, piece_type::bishop, piece_type::queen, piece_type::king,
+    piece_type::pawn, piece_type::none
+};
+
+/**
+ * <h2>Compact Position</h2>
+ * <p>A position occupying a single cache line, for copy-make: a move is made by copying the parent into the next
+ * entry of a per-ply array and updating the copy, and unmade by returning to the parent. There is no undo log, no
+ * square lookup table and no rotated bitboards, so making a move writes one line rather than the dozen or so bitboards,
+ * lookup table entries and log entry written by <code>make_move</code> and read back by <code>unmake_move</code>.</p>
+ * <p>The board is four bitboards. Bit <i>n</i> of the code of the piece on a square, see
+ * <code>compact_piece_code</code>, is stored in plane <i>n</i>, and the fourth plane marks the white pieces. The
+ * bitboards of a piece type are recovered by intersecting the three type planes, or their complements, so the
+ * accessors below compute what <code>basic_chess_position</code> stores. Move generation reads the board through
+ * those accessors and so works on either layout.</p>
+ * <p>The remainder is the same state <code>basic_chess_position</code> keeps besides its board and its move log.</p>
+ */
+struct alignas(64) compact_chess_position {
+    std::array<bitboard, 4> planes;
+    zobrist_key hash;
+    zobrist_key pawn_hash;
+    packed_score piece_square_score;
+    piece_color whos_turn;
+    uint8_t castling_rights;
+    uint8_t enpassant_file;
+    uint8_t game_phase;
+};
+static_assert(sizeof(compact_chess_position) == 64);
+static_assert(std::is_trivially_copyable_v<compact_chess_position>);
+
+[[nodiscard]] inline bitboard compact_occupancy(const compact_chess_position& position) {
+    return position.planes[0] | position.planes[1] | position.planes[2];
+}
+
+[[nodiscard]] inline std::array<bitboard, 2> color_bitboards(const compact_chess_position& position) {
+    const bitboard white = position.planes[compact_white_plane];
+    return { compact_occupancy(position) & ~white, white };
+}
+
+[[nodiscard]] inline std::array<bitboard, 7> piece_bitboards(const compact_chess_position& position) {
+    const bitboard p0 = position.planes[0];
+    const bitboard p1 = position.planes[1];
+    const bitboard p2 = position.planes[2];
+    std::array<bitboard, 7> types;
+    types[piece_type::rook] = p0 & ~p1 & ~p2;
+    types[piece_type::knight] = ~p0 & p1 & ~p2;
+    types[piece_type::bishop] = p0 & p1 & ~p2;
+    types[piece_type::queen] = ~p0 & ~p1 & p2;
+    types[piece_type::king] = p0 & ~p1 & p2;
+    types[piece_type::pawn] = ~p0 & p1 & p2;
+    types[piece_type::none] = ~(p0 | p1 | p2);
+    return types;
+}
+
+[[nodiscard]] inline piece_type piece_type_on(const compact_chess_position& position, const uint8_t sindex) {
+    const uint8_t code = ((position.planes[0] >> sindex) & 1) | ((position.planes[1] >> sindex) & 1) << 1 |
+                         ((position.planes[2] >> sindex) & 1) << 2;
+    return compact_code_piece_types[code];
+}
+
+/** The compact position keeps no rotated bitboards, so the rotated backend rotates the occupancy itself. */
+[[nodiscard]] inline bitboard total_rotated_occupancy(const compact_chess_position& position) {
+    return maintains_rotated_bitboards ? rotate_bitboard(compact_occupancy(position)) : 0;
+}
+
+/** Places a piece on the given square, replacing whatever occupied it, or empties it given <code>none</code>. */
+inline void set_compact_square(compact_chess_position& position, const uint8_t sindex, const piece_color color,
+                               const piece_type type) {
+    const bitboard square = sbitboard(sindex);
+    const uint8_t code = compact_piece_code(type);
+    for (std::size_t plane = 0; plane < compact_type_plane_count; ++plane)
+        position.planes[plane] = (position.planes[plane] & ~square) | (square * ((code >> plane) & 1));
+    const bool is_white = type != piece_type::none && color == piece_color::white;
+    position.planes[compact_white_plane] = (position.planes[compact_white_plane] & ~square) | (square * is_white);
+}
+
+/** Converts a position of any other layout, dropping its move log. */
+template<typename position_type>
+[[nodiscard]] compact_chess_position to_compact_position(const position_type& position) {
+    compact_chess_position compact {};
+    for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+        const piece_color color = (color_bitboards(position)[piece_color::white] & sbitboard(sindex))
+                                  ? piece_color::white : piece_color::black;
+        set_compact_square(compact, sindex, color, piece_type_on(position, sindex));
+    }
+    compact.hash = position.hash;
+    compact.pawn_hash = position.pawn_hash;
+    compact.piece_square_score = position.piece_square_score;
+    compact.whos_turn = position.whos_turn;
+    compact.castling_rights = position.castling_rights;
+    compact.enpassant_file = position.enpassant_file;
+    compact.game_phase = position.game_phase;
+    return compact;
+}
+
+/**
+ * <p>Writes the position reached by making the given move in <code>parent</code> on behalf of <code>mover</code> to
+ * <code>child</code>, leaving the parent untouched. The keys, score and phase are updated exactly as
+ * <code>make_move_as</code> updates them.</p>
+ */
+template<typename color_type>
+void copy_make_move_as(const bitmove move, const compact_chess_position& parent, compact_chess_position& child,
+                       const color_type mover) {
+    count_event(instrumented_counter::made_moves);
+    const piece_color us = mover;
+    const piece_color opponent_color = !us;
+    assert(parent.whos_turn == us);
+    const auto [origin, destination, promote_to] = move.unpack_all();
+    const bool is_promotion = promote_to != piece_type::none;
+    const piece_type moved_piece_type = piece_type_on(parent, origin);
+    const piece_type placed_piece_type = is_promotion ? promote_to : moved_piece_type;
+    const uint8_t target = lookup_target(origin, destination, moved_piece_type, piece_type_on(parent, destination),
+                                         us);
+    const piece_type target_piece_type = piece_type_on(parent, target);
+
+    child = parent;
+    set_compact_square(child, origin, us, piece_type::none);
+    set_compact_square(child, target, opponent_color, piece_type::none);
+    set_compact_square(child, destination, us, placed_piece_type);
+
+    zobrist_key hash = zobrist_tables.piece[us][moved_piece_type][origin] ^
+                       zobrist_tables.piece[opponent_color][target_piece_type][target] ^
+                       zobrist_tables.piece[us][placed_piece_type][destination];
+    packed_score score = piece_square_table[us][placed_piece_type][destination] -
+                         piece_square_table[us][moved_piece_type][origin] -
+                         piece_square_table[opponent_color][target_piece_type][target];
+    if (is_castle(origin, destination, moved_piece_type)) {
+        const uint8_t rook_origin = castle_rook_origin(origin, destination);
+        const uint8_t rook_destination = castle_rook_destination(origin, destination);
+        set_compact_square(child, rook_origin, us, piece_type::none);
+        set_compact_square(child, rook_destination, us, piece_type::rook);
+        hash ^= zobrist_tables.piece[us][piece_type::rook][rook_origin] ^
+                zobrist_tables.piece[us][piece_type::rook][rook_destination];
+        score += piece_square_table[us][piece_type::rook][rook_destination] -
+                 piece_square_table[us][piece_type::rook][rook_origin];
+    }
+
+    const uint8_t castling_rights = parent.castling_rights &
+                                    castling_rights_mask_table[origin] & castling_rights_mask_table[destination];
+    const bool is_double_push = (moved_piece_type == piece_type::pawn) &
+                                ((origin > destination ? origin - destination : destination - origin) == 16);
+    const uint8_t enpassant_file = is_double_push ? (origin & 0b111) : no_enpassant;
+    child.hash = parent.hash ^ hash ^
+                 zobrist_tables.castling[parent.castling_rights] ^ zobrist_tables.castling[castling_rights] ^
+                 zobrist_tables.enpassant[parent.enpassant_file] ^ zobrist_tables.enpassant[enpassant_file] ^
+                 zobrist_tables.black_to_move;
+    if (moved_piece_type == piece_type::pawn || target_piece_type == piece_type::pawn) {
+        child.pawn_hash ^= zobrist_tables.piece[opponent_color][piece_type::pawn][target] *
+                           (target_piece_type == piece_type::pawn);
+        if (moved_piece_type == piece_type::pawn) {
+            child.pawn_hash ^= zobrist_tables.piece[us][piece_type::pawn][origin] ^
+                               (zobrist_tables.piece[us][piece_type::pawn][destination] * !is_promotion);
+        }
+    }
+    child.piece_square_score = parent.piece_square_score + score;
+    child.game_phase = parent.game_phase + game_phase_values[placed_piece_type] -
+                       game_phase_values[moved_piece_type] - game_phase_values[target_piece_type];
+    child.castling_rights = castling_rights;
+    child.enpassant_file = enpassant_file;
+    child.whos_turn = opponent_color;
+    assert(child.hash == compute_zobrist_key(child));
+    assert(child.pawn_hash == compute_pawn_key(child));
+    assert(std::make_pair(child.piece_square_score, child.game_phase) == compute_piece_square_score(child));
+}
+
+/** Makes the given move on behalf of the player whose turn it is in <code>parent</code>. */
+inline void copy_make_move(const bitmove move, const compact_chess_position& parent, compact_chess_position& child) {
+    copy_make_move_as(move, parent, child, parent.whos_turn);
+}
+
+/** Makes the given move on behalf of <code>us</code>, known at compile time to be the player whose turn it is. */
+template<piece_color us>
+void copy_make_move(const bitmove move, const compact_chess_position& parent, compact_chess_position& child) {
+    copy_make_move_as(move, parent, child, color_constant<us> {});
+}
+
+/**
+ * The number of plies a <code>compact_position_stack</code> holds, the root included. It matches the deepest line the
+ * search may reach.
+ */
+constexpr std::size_t compact_position_stack_capacity = 128;
+
+/**
+ * The positions along the current line, indexed by ply, in one contiguous and cache-aligned block. Making a move
+ * writes the entry following that of its parent, and unmaking it is merely returning to the parent. At 8 KiB, the
+ * whole stack fits in the L1 data cache.
+ */
+using compact_position_stack = std::array<compact_chess_position, compact_position_stack_capacity>;
@@ -0,0 +1,169 @@
+#pragma once
+
+/**
+ * <h2>Evaluation</h2>
+ * <p>Pawn structure, the pawn hash table and the static evaluation.</p>
+ */
+
+#include "move_generation.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// Evaluation
+
+/**
+ * A table of the squares a pawn must pass on its way to promotion, together with the squares on the adjacent files
+ * from which an enemy pawn could stop it, indexed first by the pawn's color and then by its square.
+ */
+consteval std::array<std::array<bitboard, 64>, 2> generate_passed_pawn_mask_table() {
+    std::array<std::array<bitboard, 64>, 2> table {};
+    for (uint8_t rank = 0; rank < 8; ++rank) {
+        for (uint8_t file = 0; file < 8; ++file) {
+            bitboard white_span = 0;
+            bitboard black_span = 0;
+            for (uint8_t ahead = rank + 1; ahead < 8; ++ahead) white_span |= sbitboard(coords_to_sindex(ahead, file));
+            for (uint8_t behind = 0; behind < rank; ++behind) black_span |= sbitboard(coords_to_sindex(behind, file));
+            const auto widen = [](const bitboard span) {
+                return span | (span & ~file_bitboard(7)) << 1 | (span & ~file_bitboard(0)) >> 1;
+            };
+            table[piece_color::white][coords_to_sindex(rank, file)] = widen(white_span);
+            table[piece_color::black][coords_to_sindex(rank, file)] = widen(black_span);
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<std::array<bitboard, 64>, 2> passed_pawn_mask_table = generate_passed_pawn_mask_table();
+
+[[nodiscard]] constexpr bitboard adjacent_files_bitboard(const uint8_t file) {
+    return (file > 0 ? file_bitboard(file - 1) : 0) | (file < 7 ? file_bitboard(file + 1) : 0);
+}
+
+/** Bonuses for a passed pawn, indexed by its rank counted from its own side of the board. */
+constexpr std::array<packed_score, 8> passed_pawn_bonuses = {
+    0, pack_score(2, 8), pack_score(5, 14), pack_score(12, 26), pack_score(28, 48), pack_score(52, 90),
+    pack_score(90, 140), 0
+};
+
+/** The penalty for each pawn with a friendly pawn ahead of it on the same file. */
+constexpr packed_score doubled_pawn_penalty = pack_score(-10, -24);
+
+/** The penalty for a pawn with no friendly pawns on either adjacent file. */
+constexpr packed_score isolated_pawn_penalty = pack_score(-8, -14);
+
+/**
+ * The penalty for a pawn which no friendly pawn can defend, because those on the adjacent files have all advanced
+ * beyond it, and whose advance is stopped by an enemy pawn guarding the square in front of it.
+ */
+constexpr packed_score backward_pawn_penalty = pack_score(-9, -11);
+
+/** Scores the structure of the pawns of the given color, using the pawn bitboards alone. */
+template<piece_color us>
+[[nodiscard]] packed_score evaluate_pawns_of(const bitboard own_pawns, const bitboard enemy_pawns) {
+    packed_score score = 0;
+    for (bitboard remaining = own_pawns; remaining; remaining &= remaining - 1) {
+        const uint8_t sindex = std::countr_zero(remaining);
+        const uint8_t file = sindex & 0b111;
+        const uint8_t relative_rank = us == piece_color::white ? sindex / 8 : 7 - sindex / 8;
+        const bitboard ahead = passed_pawn_mask_table[us][sindex];
+        const bitboard adjacent_files = adjacent_files_bitboard(file);
+
+        if (own_pawns & ahead & file_bitboard(file)) score += doubled_pawn_penalty;
+        else if (!(enemy_pawns & ahead)) score += passed_pawn_bonuses[relative_rank];
+
+        if (!(own_pawns & adjacent_files)) {
+            score += isolated_pawn_penalty;
+        } else if (!(own_pawns & adjacent_files & ~ahead)) {
+            const uint8_t stop_square = us == piece_color::white ? sindex + 8 : sindex - 8;
+            if (pawn_attack_table[us][stop_square] & enemy_pawns) score += backward_pawn_penalty;
+        }
+    }
+    return score;
+}
+
+/**
+ * <h2>Pawn Structure</h2>
+ * <p>Scores the passed, doubled, isolated and backward pawns of the given position from white's perspective. The
+ * score is a function of the pawns alone, so it may be cached under the position's pawn key, see
+ * <code>pawn_hash_table</code>.</p>
+ * <p>Doubled pawns are penalized once for each pawn with another behind it, and only the frontmost pawn of a file
+ * may be passed.</p>
+ */
+template<typename position_type>
+[[nodiscard]] packed_score evaluate_pawn_structure(const position_type& position) {
+    const bitboard pawns = position.type_specific_bitboard[piece_type::pawn];
+    const bitboard white_pawns = pawns & position.color_bitboard[piece_color::white];
+    const bitboard black_pawns = pawns & position.color_bitboard[piece_color::black];
+    return evaluate_pawns_of<piece_color::white>(white_pawns, black_pawns) -
+           evaluate_pawns_of<piece_color::black>(black_pawns, white_pawns);
+}
+
+/**
+ * <h2>Pawn Hash Table</h2>
+ * <p>A small direct-mapped cache of pawn structure scores keyed by pawn key. The pawn structure changes only on pawn
+ * moves and captures of pawns, so most positions visited by a search share their pawns with one evaluated shortly
+ * before, and the table lets them skip <code>evaluate_pawn_structure</code>.</p>
+ * <p>Each search thread owns its own table, so it is read and written without synchronization. A vacant entry has the
+ * key zero and the score zero, which is also the correct entry for a position without pawns.</p>
+ */
+class pawn_hash_table {
+    private:
+        struct entry {
+            zobrist_key key;
+            packed_score score;
+        };
+
+        static constexpr std::size_t entry_count = 1 << 14;
+        std::array<entry, entry_count> entries {};
+    public:
+        /** Returns the pawn structure score of the given position, computing and caching it on a miss. */
+        template<typename position_type>
+        [[nodiscard]] packed_score probe(const position_type& position) {
+            entry& slot = entries[position.pawn_hash & (entry_count - 1)];
+            if (slot.key != position.pawn_hash) {
+                slot.key = position.pawn_hash;
+                slot.score = evaluate_pawn_structure(position);
+            }
+            return slot.score;
+        }
+
+        void clear() { entries.fill(entry {}); }
+};
+
+/** Blends the midgame and endgame halves of a white-relative score into centipawns for the player to move. */
+template<typename position_type>
+[[nodiscard]] int taper_score(const position_type& position, const packed_score packed) {
+    const int phase = std::min<int>(position.game_phase, max_game_phase);
+    const int score = (midgame_of(packed) * phase + endgame_of(packed) * (max_game_phase - phase)) / max_game_phase;
+    return position.whos_turn == piece_color::white ? score : -score;
+}
+
+/**
+ * Scores the given position in centipawns, from the perspective of the player whose turn it is. The midgame and endgame
+ * piece-square scores maintained by <code>make_move</code> and the pawn structure score are blended according to the
+ * game phase.
+ */
+template<typename position_type>
+[[nodiscard]] int evaluate(const position_type& position) {
+    const scoped_cycle_timer timer(instrumented_timer::evaluation);
+    return taper_score(position, position.piece_square_score + evaluate_pawn_structure(position));
+}
+
+/**
+ * Equivalent to <code>evaluate</code>, but looks the pawn structure score up in the given pawn hash table. When the
+ * position maintains network accumulators and a network is loaded, the network evaluates the position instead.
+ */
+template<typename position_type>
+[[nodiscard]] int evaluate(const position_type& position, pawn_hash_table& pawn_table) {
+    const scoped_cycle_timer timer(instrumented_timer::evaluation);
+    if constexpr (maintains_accumulators<position_type>) {
+        if (active_network) {
+            return nnue_evaluate(*active_network, position.accumulators.at(position.move_log.size()),
+                                 position.whos_turn);
+        }
+    }
+    return taper_score(position, position.piece_square_score + pawn_table.probe(position));
+}
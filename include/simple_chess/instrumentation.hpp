@@ -0,0 +1,222 @@
+#pragma once
+
+/**
+ * <h2>Instrumentation</h2>
+ * <p>Compile-time optional counters and cycle timers of the hot paths.</p>
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Instrumentation
+
+#if !defined(SIMPLE_CHESS_INSTRUMENTATION)
+#define SIMPLE_CHESS_INSTRUMENTATION 0
+#endif
+
+/** When false, the counters and timers below compile to nothing, and the hot paths are exactly as without them. */
+constexpr bool instrumentation_enabled = SIMPLE_CHESS_INSTRUMENTATION;
+
+enum class instrumented_counter: uint8_t {
+    nodes,
+    quiescence_nodes,
+    tt_probes,
+    tt_hits,
+    tt_cutoffs,
+    beta_cutoffs,
+    first_move_beta_cutoffs,
+    move_generations,
+    made_moves,
+    unmade_moves,
+    tablebase_hits,
+    null_move_cutoffs,
+    late_move_reductions,
+    futility_prunes,
+    razoring_cutoffs,
+    draws,
+    upcoming_repetitions
+};
+constexpr std::size_t instrumented_counter_count = 17;
+
+enum class instrumented_timer: uint8_t { move_generation, evaluation, transposition_table };
+constexpr std::size_t instrumented_timer_count = 3;
+
+/**
+ * The counters and timers of one thread. Each thread owns one, aligned to a cache line so that no two threads' counters
+ * share a line, and increments it without synchronization.
+ */
+struct alignas(64) instrumentation_counters {
+    std::array<std::uint64_t, instrumented_counter_count> counts {};
+    std::array<std::uint64_t, instrumented_timer_count> cycles {};
+    std::array<std::uint64_t, instrumented_timer_count> timings {};
+
+    instrumentation_counters& operator+=(const instrumentation_counters& other) {
+        for (std::size_t i = 0; i < instrumented_counter_count; ++i) counts[i] += other.counts[i];
+        for (std::size_t i = 0; i < instrumented_timer_count; ++i) cycles[i] += other.cycles[i];
+        for (std::size_t i = 0; i < instrumented_timer_count; ++i) timings[i] += other.timings[i];
+        return *this;
+    }
+};
+
+/** Reads the processor's timestamp counter, or a nanosecond clock on processors without one. */
+[[nodiscard]] inline std::uint64_t read_cycle_counter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+#if SIMPLE_CHESS_INSTRUMENTATION
+/**
+ * Knows the counters of every running thread, and keeps the sum of those of the threads which have exited, so that
+ * the search threads started and joined for each search contribute to the report after they are gone.
+ */
+class instrumentation_registry {
+    private:
+        std::mutex mutex;
+        std::vector<const instrumentation_counters*> live;
+        instrumentation_counters retired;
+        std::uint64_t start_cycle = read_cycle_counter();
+    public:
+        void enroll(const instrumentation_counters* const counters) {
+            const std::lock_guard lock(mutex);
+            live.push_back(counters);
+        }
+
+        void retire(const instrumentation_counters* const counters) {
+            const std::lock_guard lock(mutex);
+            retired += *counters;
+            live.erase(std::find(live.begin(), live.end(), counters));
+        }
+
+        /** Zeroes every counter. No other instrumented thread may be running. */
+        void reset() {
+            const std::lock_guard lock(mutex);
+            retired = {};
+            for (const instrumentation_counters* counters : live) *const_cast<instrumentation_counters*>(counters) = {};
+            start_cycle = read_cycle_counter();
+        }
+
+        /** The sum of every thread's counters, and the cycles elapsed since the last reset. */
+        [[nodiscard]] std::pair<instrumentation_counters, std::uint64_t> total() {
+            const std::lock_guard lock(mutex);
+            instrumentation_counters sum = retired;
+            for (const instrumentation_counters* counters : live) sum += *counters;
+            return { sum, read_cycle_counter() - start_cycle };
+        }
+};
+
+inline instrumentation_registry instrumentation;
+
+struct thread_instrumentation : instrumentation_counters {
+    thread_instrumentation() { instrumentation.enroll(this); }
+    ~thread_instrumentation() { instrumentation.retire(this); }
+};
+
+inline thread_local thread_instrumentation this_thread_instrumentation;
+#endif
+
+/** Increments the given counter of the calling thread. */
+inline void count_event([[maybe_unused]] const instrumented_counter counter) {
+#if SIMPLE_CHESS_INSTRUMENTATION
+    ++this_thread_instrumentation.counts[static_cast<std::size_t>(counter)];
+#endif
+}
+
+/** Adds the cycles between its construction and destruction to the given timer of the calling thread. */
+class scoped_cycle_timer {
+#if SIMPLE_CHESS_INSTRUMENTATION
+    private:
+        instrumented_timer timer;
+        std::uint64_t begin;
+    public:
+        explicit scoped_cycle_timer(const instrumented_timer timer) : timer(timer), begin(read_cycle_counter()) {}
+
+        ~scoped_cycle_timer() {
+            const auto index = static_cast<std::size_t>(timer);
+            this_thread_instrumentation.cycles[index] += read_cycle_counter() - begin;
+            ++this_thread_instrumentation.timings[index];
+        }
+#else
+    public:
+        explicit scoped_cycle_timer(instrumented_timer) {}
+#endif
+        scoped_cycle_timer(const scoped_cycle_timer&) = delete;
+        scoped_cycle_timer& operator=(const scoped_cycle_timer&) = delete;
+};
+
+/** Zeroes the counters of every thread. Call before a perft or search, while no other thread is counting. */
+inline void reset_instrumentation() {
+#if SIMPLE_CHESS_INSTRUMENTATION
+    instrumentation.reset();
+#endif
+}
+
+/**
+ * Describes the counters summed over every thread since the last reset, one line per group, or returns no lines if
+ * instrumentation is disabled. Timer shares are of the cycles elapsed since the reset, so with several threads they
+ * may add up to more than 100%.
+ */
+[[nodiscard]] inline std::vector<std::string> instrumentation_report() {
+    std::vector<std::string> lines;
+#if SIMPLE_CHESS_INSTRUMENTATION
+    const auto [sum, elapsed_cycles] = instrumentation.total();
+    const auto count = [&sum](const instrumented_counter counter) {
+        return sum.counts[static_cast<std::size_t>(counter)];
+    };
+    const auto percent = [](const std::uint64_t part, const std::uint64_t whole) {
+        return std::to_string(whole ? part * 100 / whole : 0) + "%";
+    };
+    const std::uint64_t nodes = count(instrumented_counter::nodes);
+    const std::uint64_t quiescence_nodes = count(instrumented_counter::quiescence_nodes);
+    const std::uint64_t probes = count(instrumented_counter::tt_probes);
+    const std::uint64_t cutoffs = count(instrumented_counter::beta_cutoffs);
+    lines.push_back("nodes " + std::to_string(nodes) + " qnodes " + std::to_string(quiescence_nodes) + " (" +
+                    percent(quiescence_nodes, nodes + quiescence_nodes) + " of all)");
+    lines.push_back("tt probes " + std::to_string(probes) + " hits " +
+                    std::to_string(count(instrumented_counter::tt_hits)) + " (" +
+                    percent(count(instrumented_counter::tt_hits), probes) + ") cutoffs " +
+                    std::to_string(count(instrumented_counter::tt_cutoffs)) + " (" +
+                    percent(count(instrumented_counter::tt_cutoffs), probes) + ")");
+    lines.push_back("tablebase hits " + std::to_string(count(instrumented_counter::tablebase_hits)));
+    lines.push_back("draws " + std::to_string(count(instrumented_counter::draws)) + " upcoming repetitions " +
+                    std::to_string(count(instrumented_counter::upcoming_repetitions)));
+    lines.push_back("null move cutoffs " + std::to_string(count(instrumented_counter::null_move_cutoffs)) +
+                    " late move reductions " + std::to_string(count(instrumented_counter::late_move_reductions)) +
+                    " futility prunes " + std::to_string(count(instrumented_counter::futility_prunes)) +
+                    " razoring cutoffs " + std::to_string(count(instrumented_counter::razoring_cutoffs)));
+    lines.push_back("beta cutoffs " + std::to_string(cutoffs) + " on the first move " +
+                    std::to_string(count(instrumented_counter::first_move_beta_cutoffs)) + " (" +
+                    percent(count(instrumented_counter::first_move_beta_cutoffs), cutoffs) + ")");
+    lines.push_back("movegen calls " + std::to_string(count(instrumented_counter::move_generations)) +
+                    " make_move " + std::to_string(count(instrumented_counter::made_moves)) + " unmake_move " +
+                    std::to_string(count(instrumented_counter::unmade_moves)));
+    constexpr std::array<std::string_view, instrumented_timer_count> timer_names = { "movegen", "eval", "tt" };
+    for (std::size_t i = 0; i < instrumented_timer_count; ++i) {
+        const std::uint64_t cycles = sum.cycles[i];
+        const std::uint64_t timings = sum.timings[i];
+        lines.push_back(std::string(timer_names[i]) + " " + std::to_string(cycles / 1000000) + " Mcycles, " +
+                        std::to_string(timings ? cycles / timings : 0) + " cycles per call, " +
+                        percent(cycles, elapsed_cycles) + " of elapsed");
+    }
+#endif
+    return lines;
+}
+
+/** Prints the instrumentation report, each line preceded by the given prefix. */
+inline void print_instrumentation_report(std::ostream& stream, const std::string_view prefix) {
+    for (const std::string& line : instrumentation_report()) stream << prefix << line << "\n";
+}
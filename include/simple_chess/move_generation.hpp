@@ -0,0 +1,1013 @@
+#pragma once
+
+/**
+ * <h2>Move Generation</h2>
+ * <p>Attack tables, the sliding attack backends, and pseudo-legal and legal move generation.</p>
+ */
+
+#include "position.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// Knights
+
+consteval std::array<bitboard, 64> generate_knight_move_table() {
+    std::array<bitboard, 64> table {};
+
+    for (std::uint8_t knight_file = 0; knight_file < 8; ++knight_file) {
+        for (std::uint8_t knight_rank = 0; knight_rank < 8; ++knight_rank) {
+            bitboard moves = 0;
+
+            // The following comments refer to knight moves using the format "towards x-y" where
+            // x = the direction which the knight moves two spaces.
+            // y = the direction which the knight moves one space.
+            // x, y are both in [black, kingside, white, queenside], the set of chess board cardinal directions.
+            // Also, recall that the rank approaches the black-side border as it increases.
+            // And the file approaches the kingside of the board as it increases.
+            // The origin is (rank = 0, file = 0) and it refers to the furthest white queenside space.
+
+            // There exists a towards black-queenside knight move.
+            if (knight_file > 0 && knight_rank < 6)
+                moves |= sbitboard(coords_to_sindex(knight_rank + 2, knight_file - 1));
+
+            // There exists a towards black-kingside knight move.
+            if (knight_file < 7 && knight_rank < 6)
+                moves |= sbitboard(coords_to_sindex(knight_rank + 2, knight_file + 1));
+
+            // There exists a towards queenside-black knight move.
+            if (knight_file < 6 && knight_rank < 7)
+                moves |= sbitboard(coords_to_sindex(knight_rank + 1, knight_file + 2));
+
+            // There exists a towards kingside-black knight move.
+            if (knight_file > 1 && knight_rank < 7)
+                moves |= sbitboard(coords_to_sindex(knight_rank + 1, knight_file - 2));
+
+            // There exists a towards white-queenside knight move.
+            if (knight_file > 0 && knight_rank > 1)
+                moves |= sbitboard(coords_to_sindex(knight_rank - 2, knight_file - 1));
+
+            // There exists a towards white-kingside knight move.
+            if (knight_file < 7 && knight_rank > 1)
+                moves |= sbitboard(coords_to_sindex(knight_rank - 2, knight_file + 1));
+
+            // There exists a towards queenside-white knight move.
+            if (knight_file > 1 && knight_rank > 0)
+                moves |= sbitboard(coords_to_sindex(knight_rank - 1, knight_file - 2));
+
+            // There exists a towards kingside-white knight move.
+            if (knight_file < 6 && knight_rank > 0)
+                moves |= sbitboard(coords_to_sindex(knight_rank - 1, knight_file + 2));
+
+            table[coords_to_sindex(knight_rank, knight_file)] = moves;
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<bitboard, 64> knight_move_table = generate_knight_move_table();
+
+// Rooks
+
+[[nodiscard]] consteval std::array<std::array<bitlane, 256>, 8> generate_rooklike_move_table() {
+    std::array<std::array<bitlane, 256>, 8> table {};
+
+    for (uint8_t origin = 0; origin < 8; ++origin) {
+        for (bitlane occupancy = 255; occupancy > 0; --occupancy) {
+            bitlane destinations = 0;
+            // Towards Queenside
+            for (uint8_t towards_queenside = 1; towards_queenside <= origin; ++towards_queenside) {
+                const bitlane mark = sbitlane(origin - towards_queenside);
+                const bool is_square_occupied = mark & occupancy;
+                destinations |= mark;
+                if (is_square_occupied) break;
+            }
+
+            // Towards Kingside
+            for (uint8_t kingside_square = origin + 1; kingside_square < 8; ++kingside_square) {
+                const bitlane mark = sbitlane(kingside_square);
+                const bool is_square_occupied = mark & occupancy;
+                destinations |= mark;
+                if (is_square_occupied) break;
+            }
+            table[origin][occupancy] = destinations;
+        }
+    }
+
+    return table;
+}
+
+inline constinit std::array<std::array<bitlane, 256>, 8> rooklike_move_table = generate_rooklike_move_table();
+
+/**
+ * Converts a bitlane of a <b>rotated bitboard</b> into the equivalent marks on the queenside-most file of a
+ * <b>standard bitboard</b>. Shifting the result left by <i>n</i> places the marks on the <nobr>(<i>n</i> + 1)th</nobr>
+ * queenside-most file.
+ */
+[[nodiscard]] consteval std::array<bitboard, 256> generate_file_unrotation_table() {
+    std::array<bitboard, 256> table {};
+    for (uint16_t lane = 0; lane < 256; ++lane) {
+        bitboard file = 0;
+        for (uint8_t rank = 0; rank < 8; ++rank) {
+            if (lane & sbitlane(rank)) file |= sbitboard(coords_to_sindex(rank, 0));
+        }
+        table[lane] = file;
+    }
+    return table;
+}
+
+inline constinit std::array<bitboard, 256> file_unrotation_table = generate_file_unrotation_table();
+
+/** Computes the squares attacked along the rank of the given square by a rooklike piece. */
+[[nodiscard]] inline bitboard rank_attacks(const uint8_t sindex, const bitboard occupancy) {
+    const uint8_t rank = sindex >> 3;
+    const uint8_t file = sindex & 0b111;
+    const bitlane lane = static_cast<bitlane>(occupancy >> (rank * 8));
+    return static_cast<bitboard>(rooklike_move_table[file][lane]) << (rank * 8);
+}
+
+/**
+ * Computes the squares attacked along the file of the given square by a rooklike piece. Unlike
+ * <code>rank_attacks</code>, this function expects the occupancy as a <b>rotated bitboard</b>, so that the file
+ * occupancy is a single bitlane.
+ */
+[[nodiscard]] inline bitboard file_attacks(const uint8_t sindex, const bitboard rotated_occupancy) {
+    const uint8_t rank = sindex >> 3;
+    const uint8_t file = sindex & 0b111;
+    const bitlane lane = static_cast<bitlane>(rotated_occupancy >> (file * 8));
+    return file_unrotation_table[rooklike_move_table[rank][lane]] << file;
+}
+
+// Bishops
+
+enum diagonal_direction: uint8_t { towards_black_kingside = 0, towards_black_queenside = 1,
+                                   towards_white_kingside = 2, towards_white_queenside = 3 };
+
+/**
+ * A table of the squares which lie on each diagonal ray emanating from each square, the origin square excluded.
+ * Rays towards black increase in square index and rays towards white decrease in square index, which
+ * <code>diagonal_attacks</code> relies upon to find the nearest blocker with a single bit scan.
+ */
+[[nodiscard]] consteval std::array<std::array<bitboard, 64>, 4> generate_diagonal_ray_table() {
+    std::array<std::array<bitboard, 64>, 4> table {};
+    constexpr std::array<int8_t, 4> rank_steps = { 1, 1, -1, -1 };
+    constexpr std::array<int8_t, 4> file_steps = { 1, -1, 1, -1 };
+    for (uint8_t direction = 0; direction < 4; ++direction) {
+        for (int8_t rank = 0; rank < 8; ++rank) {
+            for (int8_t file = 0; file < 8; ++file) {
+                bitboard ray = 0;
+                int8_t r = rank + rank_steps[direction];
+                int8_t f = file + file_steps[direction];
+                while (r >= 0 && r < 8 && f >= 0 && f < 8) {
+                    ray |= sbitboard(coords_to_sindex(r, f));
+                    r += rank_steps[direction];
+                    f += file_steps[direction];
+                }
+                table[direction][coords_to_sindex(rank, file)] = ray;
+            }
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<std::array<bitboard, 64>, 4> diagonal_ray_table = generate_diagonal_ray_table();
+
+/** Computes the squares attacked from the given square by a bishoplike piece. */
+[[nodiscard]] inline bitboard diagonal_attacks(const uint8_t sindex, const bitboard occupancy) {
+    bitboard attacks = 0;
+    for (uint8_t direction = towards_black_kingside; direction <= towards_black_queenside; ++direction) {
+        bitboard ray = diagonal_ray_table[direction][sindex];
+        const bitboard blockers = ray & occupancy;
+        if (blockers) ray ^= diagonal_ray_table[direction][std::countr_zero(blockers)];
+        attacks |= ray;
+    }
+    for (uint8_t direction = towards_white_kingside; direction <= towards_white_queenside; ++direction) {
+        bitboard ray = diagonal_ray_table[direction][sindex];
+        const bitboard blockers = ray & occupancy;
+        if (blockers) ray ^= diagonal_ray_table[direction][63 - std::countl_zero(blockers)];
+        attacks |= ray;
+    }
+    return attacks;
+}
+
+// Sliding Attack Backends
+
+/**
+ * Computes the attacks of a sliding piece the slow way, by walking each of the given directions until a piece is
+ * met. Only used to fill the magic attack tables.
+ */
+[[nodiscard]] constexpr bitboard walk_slider_attacks(const uint8_t sindex, const bitboard occupancy,
+                                                     const std::array<std::array<int8_t, 2>, 4>& directions,
+                                                     const bool include_edges) {
+    bitboard attacks = 0;
+    for (const auto& [rank_step, file_step] : directions) {
+        int8_t rank = (sindex >> 3) + rank_step;
+        int8_t file = (sindex & 0b111) + file_step;
+        while (rank >= 0 && rank < 8 && file >= 0 && file < 8) {
+            const int8_t next_rank = rank + rank_step;
+            const int8_t next_file = file + file_step;
+            const bool is_edge = next_rank < 0 || next_rank > 7 || next_file < 0 || next_file > 7;
+            if (is_edge && !include_edges) break;
+            attacks |= sbitboard(coords_to_sindex(rank, file));
+            if (occupancy & sbitboard(coords_to_sindex(rank, file))) break;
+            rank = next_rank;
+            file = next_file;
+        }
+    }
+    return attacks;
+}
+
+constexpr std::array<std::array<int8_t, 2>, 4> rooklike_directions = {{ { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } }};
+constexpr std::array<std::array<int8_t, 2>, 4> bishoplike_directions = {{ { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } }};
+
+/**
+ * Magic multipliers for rooklike pieces, indexed by square. Each maps every relevant occupancy of the square onto a
+ * distinct index of <code>popcount(mask)</code> bits, or onto an index shared only with occupancies having identical
+ * attacks. They were found once by a random search and are fixed so that startup stays cheap.
+ */
+constexpr std::array<bitboard, 64> rooklike_magics = {
+    0x1080004008801020ull, 0x0840092002C03000ull, 0x1900200010400900ull, 0x0880100008000480ull,
+    0x4200100420080200ull, 0x8100020100080400ull, 0x0200040110886200ull, 0x0200008040220411ull,
+    0x0404800084400220ull, 0x0000401000402000ull, 0x0086001081220440ull, 0x0408800800100280ull,
+    0x000A001201040820ull, 0x8848800200840080ull, 0x4001000100040200ull, 0x0442000102105084ull,
+    0x9080010020804100ull, 0x0040404000201009ull, 0x0000808010002009ull, 0x2200090021D00100ull,
+    0x0008008008040080ull, 0x0004004002010040ull, 0x0011040008015042ull, 0x00000A0001768104ull,
+    0x0000800080204009ull, 0x2010004140002001ull, 0x9800200280100080ull, 0x1000100080080080ull,
+    0x0442000A00049020ull, 0x2100040080020080ull, 0x0800120400900148ull, 0x0010040A00128541ull,
+    0x2800804000800030ull, 0x1010002000400041ull, 0x4000200011004100ull, 0x0610008410800800ull,
+    0x0400802402800800ull, 0xC100020080800400ull, 0x0002000802000401ull, 0x0182085882000401ull,
+    0x0220204000808000ull, 0x2860100040024022ull, 0x0001002004110040ull, 0x99101042000A0020ull,
+    0x0004080004008080ull, 0x0010040002008080ull, 0x2012004881020004ull, 0x8300842444820011ull,
+    0x0088403882010200ull, 0x0820400080210100ull, 0x0110910040A00300ull, 0x0801100280080480ull,
+    0x0242009008200600ull, 0x1002000489500200ull, 0x0040800200010080ull, 0x0091800041000080ull,
+    0x0000209300488001ull, 0x04C1002414824001ull, 0x020020000B001041ull, 0x7000100004200901ull,
+    0x8002002004100802ull, 0x30010002084C0007ull, 0x0888221800813004ull, 0x4000002840840112ull
+};
+
+/** Magic multipliers for bishoplike pieces, indexed by square. See <code>rooklike_magics</code>. */
+constexpr std::array<bitboard, 64> bishoplike_magics = {
+    0xA010041108003100ull, 0x006082020A002900ull, 0x6810010619200000ull, 0x08281A0520000408ull,
+    0x0001104001000400ull, 0x0018901008048400ull, 0x00040A0210245280ull, 0x000200210808A402ull,
+    0x9140048410821200ull, 0x0800091010820041ull, 0x20504804832202C0ull, 0x0100091401081000ull,
+    0x8021011140000012ull, 0x0810020804450400ull, 0x208B0542109008A2ull, 0x0080084A08040204ull,
+    0x0040E2A80811244Cull, 0x2505022008008108ull, 0x0430220100420040ull, 0x010A040420220040ull,
+    0x1105000290400000ull, 0x0093001200822120ull, 0x4000A62048043004ull, 0x280120048A015004ull,
+    0x006090002A020814ull, 0x44042000240800D0ull, 0x01102800040A4400ull, 0x1004080080220040ull,
+    0x0001001011004024ull, 0x0010044000805040ull, 0x0914041200820100ull, 0x0004821012821480ull,
+    0x0024040500C05021ull, 0x0088611002080200ull, 0x0116080A00040020ull, 0x4000020080080080ull,
+    0x2450450140840040ull, 0x0000880201484100ull, 0x0222020404020092ull, 0x8081110600002E00ull,
+    0x2842101105000801ull, 0x1100809008001025ull, 0x00020202221C0400ull, 0x0422014022009020ull,
+    0x0210046102100C00ull, 0xC004008082029102ull, 0x00AA461801101200ull, 0x0404080080201108ull,
+    0x020542108C205002ull, 0x0410544804100100ull, 0x0040910841100000ull, 0x0400200042021100ull,
+    0x00004204850400C0ull, 0x0200100410A42102ull, 0x1040020801210102ull, 0x0805040410420000ull,
+    0x2884804130100200ull, 0x800C262201242000ull, 0x1058000194108800ull, 0x0014221054420204ull,
+    0x0104000012A02200ull, 0x0200881003300100ull, 0x0140400202840100ull, 0x0402020801010201ull
+};
+
+struct magic_entry {
+    /** The squares whose occupancy affects the attacks. Squares on the edge of the board never do. */
+    bitboard mask;
+    bitboard magic;
+    uint8_t shift;
+
+    /** The offset of the first attack set of this square within the shared attack table. */
+    uint32_t offset;
+};
+
+constexpr std::size_t rooklike_attack_table_size = 102400;
+constexpr std::size_t bishoplike_attack_table_size = 5248;
+
+inline std::array<magic_entry, 64> rooklike_magic_entries {};
+inline std::array<magic_entry, 64> bishoplike_magic_entries {};
+inline std::array<bitboard, rooklike_attack_table_size> rooklike_attack_table {};
+inline std::array<bitboard, bishoplike_attack_table_size> bishoplike_attack_table {};
+
+[[nodiscard]] inline uint32_t magic_index(const magic_entry& entry, const bitboard occupancy) {
+    return entry.offset + static_cast<uint32_t>(((occupancy & entry.mask) * entry.magic) >> entry.shift);
+}
+
+#if defined(__BMI2__)
+[[nodiscard]] inline uint32_t pext_index(const magic_entry& entry, const bitboard occupancy) {
+    return entry.offset + static_cast<uint32_t>(_pext_u64(occupancy, entry.mask));
+}
+#endif
+
+/**
+ * Fills the magic entries and attack table of one piece kind. The table is indexed with the magic index when
+ * <code>use_pext</code> is false and with the PEXT index otherwise, so the layout matches the active backend.
+ */
+template<std::size_t table_size>
+void fill_magic_table(std::array<magic_entry, 64>& entries, std::array<bitboard, table_size>& table,
+                      const std::array<bitboard, 64>& magics,
+                      const std::array<std::array<int8_t, 2>, 4>& directions, [[maybe_unused]] const bool use_pext) {
+    uint32_t offset = 0;
+    for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+        magic_entry& entry = entries[sindex];
+        entry.mask = walk_slider_attacks(sindex, 0, directions, false);
+        entry.magic = magics[sindex];
+        entry.shift = 64 - std::popcount(entry.mask);
+        entry.offset = offset;
+        // Enumerate every subset of the mask with the Carry-Rippler trick.
+        bitboard occupancy = 0;
+        do {
+            uint32_t index = magic_index(entry, occupancy);
+#if defined(__BMI2__)
+            if (use_pext) index = pext_index(entry, occupancy);
+#endif
+            table[index] = walk_slider_attacks(sindex, occupancy, directions, true);
+            occupancy = (occupancy - entry.mask) & entry.mask;
+        } while (occupancy);
+        offset += static_cast<uint32_t>(1) << std::popcount(entry.mask);
+    }
+    assert(offset == table_size);
+}
+
+/**
+ * The magic attack tables are too large to be produced by constant evaluation in reasonable time, so unlike the
+ * other tables they are filled once during static initialization.
+ */
+inline bool initialize_magic_tables() {
+    constexpr bool use_pext = active_sliding_backend == sliding_attack_backend::pext;
+    fill_magic_table(rooklike_magic_entries, rooklike_attack_table, rooklike_magics, rooklike_directions, use_pext);
+    fill_magic_table(bishoplike_magic_entries, bishoplike_attack_table, bishoplike_magics, bishoplike_directions,
+                     use_pext);
+    return true;
+}
+
+[[maybe_unused]] inline const bool are_magic_tables_initialized = initialize_magic_tables();
+
+/** Computes the squares attacked from the given square by a rooklike piece, using the active backend. */
+[[nodiscard]] inline bitboard rooklike_attacks(const uint8_t sindex, const bitboard occupancy,
+                                               [[maybe_unused]] const bitboard rotated_occupancy) {
+    if constexpr (active_sliding_backend == sliding_attack_backend::rotated) {
+        return rank_attacks(sindex, occupancy) | file_attacks(sindex, rotated_occupancy);
+    } else if constexpr (active_sliding_backend == sliding_attack_backend::magic) {
+        return rooklike_attack_table[magic_index(rooklike_magic_entries[sindex], occupancy)];
+    } else {
+#if defined(__BMI2__)
+        return rooklike_attack_table[pext_index(rooklike_magic_entries[sindex], occupancy)];
+#endif
+    }
+}
+
+/**
+ * Computes the squares attacked from the given square by a rooklike piece, assuming an occupancy which need not be
+ * that of any position. The rotated backend rotates the occupancy itself, whereas the position provides it in
+ * <code>rooklike_attacks(sindex, occupancy, rotated_occupancy)</code>.
+ */
+[[nodiscard]] inline bitboard rooklike_attacks(const uint8_t sindex, const bitboard occupancy) {
+    return rooklike_attacks(sindex, occupancy, maintains_rotated_bitboards ? rotate_bitboard(occupancy) : 0);
+}
+
+/** Computes the squares attacked from the given square by a bishoplike piece, using the active backend. */
+[[nodiscard]] inline bitboard bishoplike_attacks(const uint8_t sindex, const bitboard occupancy) {
+    if constexpr (active_sliding_backend == sliding_attack_backend::rotated) {
+        return diagonal_attacks(sindex, occupancy);
+    } else if constexpr (active_sliding_backend == sliding_attack_backend::magic) {
+        return bishoplike_attack_table[magic_index(bishoplike_magic_entries[sindex], occupancy)];
+    } else {
+#if defined(__BMI2__)
+        return bishoplike_attack_table[pext_index(bishoplike_magic_entries[sindex], occupancy)];
+#endif
+    }
+}
+
+/**
+ * The rotated occupancy of both colors, for the rotated backend. It is zero with the other backends, which do not
+ * maintain rotated bitboards and ignore the argument.
+ */
+template<typename position_type>
+[[nodiscard]] inline bitboard total_rotated_occupancy(const position_type& position) {
+    if constexpr (maintains_rotated_bitboards) {
+        return position.color_bitboard_rotated[piece_color::white] | position.color_bitboard_rotated[piece_color::black];
+    } else {
+        return 0;
+    }
+}
+
+// Kings
+
+consteval std::array<bitboard, 64> generate_king_move_table() {
+    std::array<bitboard, 64> table {};
+    for (int8_t king_rank = 0; king_rank < 8; ++king_rank) {
+        for (int8_t king_file = 0; king_file < 8; ++king_file) {
+            bitboard moves = 0;
+            for (int8_t rank = king_rank - 1; rank <= king_rank + 1; ++rank) {
+                for (int8_t file = king_file - 1; file <= king_file + 1; ++file) {
+                    if (rank < 0 || rank > 7 || file < 0 || file > 7) continue;
+                    if (rank == king_rank && file == king_file) continue;
+                    moves |= sbitboard(coords_to_sindex(rank, file));
+                }
+            }
+            table[coords_to_sindex(king_rank, king_file)] = moves;
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<bitboard, 64> king_move_table = generate_king_move_table();
+
+// Pawns
+
+/** A table of the squares attacked by a pawn, indexed first by the pawn's color and then by its square. */
+consteval std::array<std::array<bitboard, 64>, 2> generate_pawn_attack_table() {
+    std::array<std::array<bitboard, 64>, 2> table {};
+    for (uint8_t rank = 0; rank < 8; ++rank) {
+        for (uint8_t file = 0; file < 8; ++file) {
+            // Entries for squares a pawn can never stand on are still populated, because the table is also read in
+            // reverse to find the pawns which attack a square.
+            bitboard white_attacks = 0;
+            bitboard black_attacks = 0;
+            if (file > 0 && rank < 7) white_attacks |= sbitboard(coords_to_sindex(rank + 1, file - 1));
+            if (file < 7 && rank < 7) white_attacks |= sbitboard(coords_to_sindex(rank + 1, file + 1));
+            if (file > 0 && rank > 0) black_attacks |= sbitboard(coords_to_sindex(rank - 1, file - 1));
+            if (file < 7 && rank > 0) black_attacks |= sbitboard(coords_to_sindex(rank - 1, file + 1));
+            table[piece_color::white][coords_to_sindex(rank, file)] = white_attacks;
+            table[piece_color::black][coords_to_sindex(rank, file)] = black_attacks;
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<std::array<bitboard, 64>, 2> pawn_attack_table = generate_pawn_attack_table();
+
+// Attacks
+
+/** Determines whether any piece of the given color attacks the given square. */
+template<typename position_type>
+[[nodiscard]] bool is_square_attacked(const position_type& position, const uint8_t sindex,
+                                      const piece_color attacker_color) {
+    const std::array<bitboard, 2>& colors = color_bitboards(position);
+    const bitboard attackers = colors[attacker_color];
+    const bitboard occupancy = colors[piece_color::white] | colors[piece_color::black];
+    const bitboard rotated_occupancy = total_rotated_occupancy(position);
+    const std::array<bitboard, 7>& types = piece_bitboards(position);
+
+    if (pawn_attack_table[!attacker_color][sindex] & types[piece_type::pawn] & attackers) return true;
+    if (knight_move_table[sindex] & types[piece_type::knight] & attackers) return true;
+    if (king_move_table[sindex] & types[piece_type::king] & attackers) return true;
+    const bitboard rooklike = (types[piece_type::rook] | types[piece_type::queen]) & attackers;
+    if (rooklike_attacks(sindex, occupancy, rotated_occupancy) & rooklike) return true;
+    const bitboard bishoplike = (types[piece_type::bishop] | types[piece_type::queen]) & attackers;
+    return bishoplike_attacks(sindex, occupancy) & bishoplike;
+}
+
+/** Determines whether the king of the given color is currently attacked by the opponent. */
+template<typename position_type>
+[[nodiscard]] bool is_king_attacked(const position_type& position, const piece_color king_color) {
+    const bitboard king = piece_bitboards(position)[piece_type::king] & color_bitboards(position)[king_color];
+    return is_square_attacked(position, std::countr_zero(king), !king_color);
+}
+
+// Move Generation
+
+/**
+ * The maximum number of moves any reachable chess position is known to have is 218, so a buffer of 256 moves can never
+ * overflow.
+ */
+constexpr std::size_t max_moves = 256;
+
+/**
+ * <p>A fixed-capacity list of moves, intended to live on the stack of the function which generates the moves, so that
+ * move generation never allocates.</p>
+ */
+struct move_buffer {
+    std::array<bitmove, max_moves> moves;
+    std::uint16_t size = 0;
+
+    void push(const bitmove move) {
+        assert(size < max_moves);
+        moves[size++] = move;
+    }
+
+    [[nodiscard]] const bitmove* begin() const { return moves.data(); }
+    [[nodiscard]] const bitmove* end() const { return moves.data() + size; }
+    [[nodiscard]] bitmove* begin() { return moves.data(); }
+    [[nodiscard]] bitmove* end() { return moves.data() + size; }
+};
+
+/**
+ * <p>Selects which subset of the pseudo-legal moves a generator emits.</p>
+ * <p><code>captures</code> emits every move which removes a piece from the board, including en-passant, along with
+ * every promotion (capturing or not). <code>quiets</code> emits all remaining moves, castling included. The two sets
+ * are disjoint and together form all pseudo-legal moves, so a search may generate them lazily one after the other.</p>
+ */
+enum move_generation_kind: uint8_t { captures = 0b01, quiets = 0b10, all_moves = 0b11 };
+
+constexpr bitboard rank_bitboard(const uint8_t rank) { return static_cast<bitboard>(0xFF) << (rank * 8); }
+constexpr bitboard file_bitboard(const uint8_t file) { return static_cast<bitboard>(0x0101010101010101) << file; }
+
+/** Shifts every mark on the bitboard one rank towards the opponent of the given color. */
+[[nodiscard]] constexpr bitboard shift_forward(const bitboard board, const piece_color color) {
+    return color == piece_color::white ? board << 8 : board >> 8;
+}
+
+/**
+ * Emits a move for each marked destination, computing the origin by undoing the given shift. When
+ * <code>promote_to</code> is not <code>piece_type::none</code>, each destination yields one move per promotion piece.
+ */
+inline void push_pawn_moves(bitboard destinations, const int8_t origin_offset, const piece_type promote_to,
+                            move_buffer& buffer) {
+    for (; destinations; destinations &= destinations - 1) {
+        const uint8_t destination = std::countr_zero(destinations);
+        const uint8_t origin = destination + origin_offset;
+        if (promote_to == piece_type::none) {
+            buffer.push(bitmove(origin, destination, piece_type::none));
+        } else {
+            buffer.push(bitmove(origin, destination, piece_type::queen));
+            buffer.push(bitmove(origin, destination, piece_type::rook));
+            buffer.push(bitmove(origin, destination, piece_type::bishop));
+            buffer.push(bitmove(origin, destination, piece_type::knight));
+        }
+    }
+}
+
+inline void push_moves(const uint8_t origin, bitboard destinations, move_buffer& buffer) {
+    for (; destinations; destinations &= destinations - 1)
+        buffer.push(bitmove(origin, std::countr_zero(destinations), piece_type::none));
+}
+
+/**
+ * Generates the moves of the given pawns set-wise. Every pawn is advanced at once with a single shift of the pawn
+ * bitboard, and the origin of each resulting move is recovered from the destination by undoing the shift. Only moves
+ * whose destination lies within <code>target_mask</code> are emitted. En-passant captures are left to the caller.
+ */
+template<move_generation_kind kind, typename color_type>
+void generate_pawn_moves(const bitboard pawns, const bitboard empty, const bitboard enemy, const bitboard target_mask,
+                         move_buffer& buffer, const color_type mover) {
+    const piece_color us = mover;
+    const bitboard promotion_rank = rank_bitboard(us == piece_color::white ? 7 : 0);
+    const bitboard double_push_rank = rank_bitboard(us == piece_color::white ? 3 : 4);
+    const int8_t backward = us == piece_color::white ? -8 : 8;
+
+    // A double push must pass over an empty square, regardless of whether that square is a target itself.
+    const bitboard single_pushes = shift_forward(pawns, us) & empty;
+    const bitboard double_pushes = shift_forward(single_pushes, us) & empty & double_push_rank & target_mask;
+    // Capturing towards the kingside moves a pawn one file up, so pawns on the kingside-most file are excluded, and
+    // similarly for the queenside.
+    const bitboard kingside_captures = shift_forward(pawns & ~file_bitboard(7), us) << 1 & enemy & target_mask;
+    const bitboard queenside_captures = shift_forward(pawns & ~file_bitboard(0), us) >> 1 & enemy & target_mask;
+    const bitboard pushes = single_pushes & target_mask;
+
+    if constexpr (kind & move_generation_kind::captures) {
+        push_pawn_moves(kingside_captures & ~promotion_rank, backward - 1, piece_type::none, buffer);
+        push_pawn_moves(queenside_captures & ~promotion_rank, backward + 1, piece_type::none, buffer);
+        push_pawn_moves(kingside_captures & promotion_rank, backward - 1, piece_type::queen, buffer);
+        push_pawn_moves(queenside_captures & promotion_rank, backward + 1, piece_type::queen, buffer);
+        push_pawn_moves(pushes & promotion_rank, backward, piece_type::queen, buffer);
+    }
+
+    if constexpr (kind & move_generation_kind::quiets) {
+        push_pawn_moves(pushes & ~promotion_rank, backward, piece_type::none, buffer);
+        push_pawn_moves(double_pushes, 2 * backward, piece_type::none, buffer);
+    }
+}
+
+/** The square a pawn of the given color lands on when capturing en-passant on the given file. */
+[[nodiscard]] constexpr uint8_t enpassant_destination(const piece_color us, const uint8_t file) {
+    return coords_to_sindex(us == piece_color::white ? 5 : 2, file);
+}
+
+/**
+ * <h2>Pseudo-Legal Move Generation</h2>
+ * <p>Emits the pseudo-legal moves of the requested kind available to <code>mover</code>, the player whose turn it is,
+ * into <code>buffer</code>. As with <code>make_move_as</code>, the mover may be known at runtime or at compile time.
+ * </p>
+ * <p>A move is pseudo-legal if it obeys the movement rules of the piece, but possibly leaves the mover's own king in
+ * check. Castling is the exception, it is only generated when the king does not start on, or pass over, an attacked
+ * square.</p>
+ */
+template<move_generation_kind kind, typename position_type, typename color_type>
+void generate_moves_as(const position_type& position, move_buffer& buffer, const color_type mover) {
+    count_event(instrumented_counter::move_generations);
+    const scoped_cycle_timer timer(instrumented_timer::move_generation);
+    const piece_color us = mover;
+    assert(position.whos_turn == us);
+    const bitboard own = color_bitboards(position)[us];
+    const bitboard enemy = color_bitboards(position)[!us];
+    const bitboard occupancy = own | enemy;
+    const bitboard rotated_occupancy = total_rotated_occupancy(position);
+    const std::array<bitboard, 7>& types = piece_bitboards(position);
+
+    bitboard destination_mask = 0;
+    if constexpr (kind & move_generation_kind::captures) destination_mask |= enemy;
+    if constexpr (kind & move_generation_kind::quiets) destination_mask |= ~occupancy;
+
+    const bitboard pawns = types[piece_type::pawn] & own;
+    generate_pawn_moves<kind>(pawns, ~occupancy, enemy, ~static_cast<bitboard>(0), buffer, mover);
+    if constexpr (kind & move_generation_kind::captures) {
+        if (position.enpassant_file != no_enpassant) {
+            const uint8_t destination = enpassant_destination(us, position.enpassant_file);
+            for (bitboard attackers = pawn_attack_table[!us][destination] & pawns; attackers;
+                 attackers &= attackers - 1) {
+                buffer.push(bitmove(std::countr_zero(attackers), destination, piece_type::none));
+            }
+        }
+    }
+
+    for (bitboard knights = types[piece_type::knight] & own; knights; knights &= knights - 1) {
+        const uint8_t origin = std::countr_zero(knights);
+        push_moves(origin, knight_move_table[origin] & destination_mask, buffer);
+    }
+    for (bitboard bishoplike = (types[piece_type::bishop] | types[piece_type::queen]) & own; bishoplike;
+         bishoplike &= bishoplike - 1) {
+        const uint8_t origin = std::countr_zero(bishoplike);
+        push_moves(origin, bishoplike_attacks(origin, occupancy) & destination_mask, buffer);
+    }
+    for (bitboard rooklike = (types[piece_type::rook] | types[piece_type::queen]) & own; rooklike;
+         rooklike &= rooklike - 1) {
+        const uint8_t origin = std::countr_zero(rooklike);
+        push_moves(origin, rooklike_attacks(origin, occupancy, rotated_occupancy) & destination_mask, buffer);
+    }
+
+    const uint8_t king_origin = std::countr_zero(types[piece_type::king] & own);
+    push_moves(king_origin, king_move_table[king_origin] & destination_mask, buffer);
+
+    if constexpr (kind & move_generation_kind::quiets) {
+        const uint8_t home_rank = us == piece_color::white ? 0 : 7;
+        const uint8_t kingside = us == piece_color::white ? castling_right::white_kingside
+                                                          : castling_right::black_kingside;
+        const uint8_t queenside = us == piece_color::white ? castling_right::white_queenside
+                                                           : castling_right::black_queenside;
+        if (!(position.castling_rights & (kingside | queenside))) return;
+        if (is_square_attacked(position, king_origin, !us)) return;
+        const bitboard kingside_path = sbitboard(coords_to_sindex(home_rank, 5)) |
+                                       sbitboard(coords_to_sindex(home_rank, 6));
+        const bitboard queenside_path = sbitboard(coords_to_sindex(home_rank, 1)) |
+                                        sbitboard(coords_to_sindex(home_rank, 2)) |
+                                        sbitboard(coords_to_sindex(home_rank, 3));
+        if ((position.castling_rights & kingside) && !(occupancy & kingside_path)
+            && !is_square_attacked(position, coords_to_sindex(home_rank, 5), !us)) {
+            buffer.push(bitmove(king_origin, coords_to_sindex(home_rank, 6), piece_type::none));
+        }
+        if ((position.castling_rights & queenside) && !(occupancy & queenside_path)
+            && !is_square_attacked(position, coords_to_sindex(home_rank, 3), !us)) {
+            buffer.push(bitmove(king_origin, coords_to_sindex(home_rank, 2), piece_type::none));
+        }
+    }
+}
+
+template<move_generation_kind kind, typename position_type>
+void generate_moves(const position_type& position, move_buffer& buffer) {
+    generate_moves_as<kind>(position, buffer, position.whos_turn);
+}
+
+template<move_generation_kind kind, piece_color us, typename position_type>
+void generate_moves(const position_type& position, move_buffer& buffer) {
+    generate_moves_as<kind>(position, buffer, color_constant<us> {});
+}
+
+/** Emits every pseudo-legal move which captures a piece or promotes a pawn. */
+template<typename position_type>
+void generate_captures(const position_type& position, move_buffer& buffer) {
+    generate_moves<move_generation_kind::captures>(position, buffer);
+}
+
+template<piece_color us, typename position_type>
+void generate_captures(const position_type& position, move_buffer& buffer) {
+    generate_moves<move_generation_kind::captures, us>(position, buffer);
+}
+
+/** Emits every pseudo-legal move which neither captures a piece nor promotes a pawn. */
+template<typename position_type>
+void generate_quiets(const position_type& position, move_buffer& buffer) {
+    generate_moves<move_generation_kind::quiets>(position, buffer);
+}
+
+template<piece_color us, typename position_type>
+void generate_quiets(const position_type& position, move_buffer& buffer) {
+    generate_moves<move_generation_kind::quiets, us>(position, buffer);
+}
+
+template<typename position_type>
+void generate_pseudo_legal_moves(const position_type& position, move_buffer& buffer) {
+    generate_moves<move_generation_kind::all_moves>(position, buffer);
+}
+
+template<piece_color us, typename position_type>
+void generate_pseudo_legal_moves(const position_type& position, move_buffer& buffer) {
+    generate_moves<move_generation_kind::all_moves, us>(position, buffer);
+}
+
+// Legal Move Generation
+
+/**
+ * A table of the squares lying strictly between two squares which share a rank, file or diagonal, indexed by the two
+ * squares. The entry of two unaligned squares is empty.
+ */
+consteval std::array<std::array<bitboard, 64>, 64> generate_between_table() {
+    std::array<std::array<bitboard, 64>, 64> table {};
+    constexpr std::array<std::array<int8_t, 2>, 8> directions = {{
+        { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 }
+    }};
+    for (uint8_t from = 0; from < 64; ++from) {
+        for (const auto& [rank_step, file_step] : directions) {
+            bitboard between = 0;
+            int8_t rank = (from >> 3) + rank_step;
+            int8_t file = (from & 0b111) + file_step;
+            while (rank >= 0 && rank < 8 && file >= 0 && file < 8) {
+                const uint8_t to = coords_to_sindex(rank, file);
+                table[from][to] = between;
+                between |= sbitboard(to);
+                rank += rank_step;
+                file += file_step;
+            }
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<std::array<bitboard, 64>, 64> between_table = generate_between_table();
+
+/**
+ * A table of the entire rank, file or diagonal shared by two squares, edge to edge, indexed by the two squares. The
+ * entry of two unaligned squares is empty. A piece pinned to its king may only move along the line through both.
+ */
+consteval std::array<std::array<bitboard, 64>, 64> generate_line_table() {
+    std::array<std::array<bitboard, 64>, 64> table {};
+    constexpr std::array<std::array<int8_t, 2>, 4> directions = {{ { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } }};
+    for (uint8_t from = 0; from < 64; ++from) {
+        for (const auto& [rank_step, file_step] : directions) {
+            bitboard line = sbitboard(from);
+            for (const int8_t sign : { 1, -1 }) {
+                int8_t rank = (from >> 3) + sign * rank_step;
+                int8_t file = (from & 0b111) + sign * file_step;
+                while (rank >= 0 && rank < 8 && file >= 0 && file < 8) {
+                    line |= sbitboard(coords_to_sindex(rank, file));
+                    rank += sign * rank_step;
+                    file += sign * file_step;
+                }
+            }
+            for (bitboard squares = line ^ sbitboard(from); squares; squares &= squares - 1)
+                table[from][std::countr_zero(squares)] = line;
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<std::array<bitboard, 64>, 64> line_table = generate_line_table();
+
+/** Computes every square attacked by the pieces of the given color, assuming the given occupancy. */
+template<typename position_type>
+[[nodiscard]] bitboard attacked_squares(const position_type& position, const piece_color attacker_color,
+                                        const bitboard occupancy) {
+    const bitboard attackers = color_bitboards(position)[attacker_color];
+    const std::array<bitboard, 7>& types = piece_bitboards(position);
+    const bitboard pawns = types[piece_type::pawn] & attackers;
+    const bitboard advanced_pawns = shift_forward(pawns, attacker_color);
+    bitboard attacked = (advanced_pawns & ~file_bitboard(7)) << 1 | (advanced_pawns & ~file_bitboard(0)) >> 1;
+    for (bitboard knights = types[piece_type::knight] & attackers; knights; knights &= knights - 1)
+        attacked |= knight_move_table[std::countr_zero(knights)];
+    for (bitboard bishoplike = (types[piece_type::bishop] | types[piece_type::queen]) & attackers; bishoplike;
+         bishoplike &= bishoplike - 1) {
+        attacked |= bishoplike_attacks(std::countr_zero(bishoplike), occupancy);
+    }
+    for (bitboard rooklike = (types[piece_type::rook] | types[piece_type::queen]) & attackers; rooklike;
+         rooklike &= rooklike - 1) {
+        attacked |= rooklike_attacks(std::countr_zero(rooklike), occupancy);
+    }
+    attacked |= king_move_table[std::countr_zero(types[piece_type::king] & attackers)];
+    return attacked;
+}
+
+/**
+ * <h2>Legal Move Generation</h2>
+ * <p>Emits exactly the legal moves of the requested kind available to <code>mover</code>, the player whose turn it
+ * is, so that no move needs to be made and unmade to establish that it does not leave the king in check.</p>
+ * <p>Three facts about the position are established once, up front.</p>
+ * <ul>
+ * <li>The <b>danger</b> squares, attacked by the opponent with the king lifted off the board. The king may not move
+ * onto them. Lifting the king prevents it from retreating along the line of a slider checking it.</li>
+ * <li>The <b>checkers</b>. In double check only the king may move. In single check every other move must land on
+ * the <b>evasion mask</b>, the checker and the squares between it and the king.</li>
+ * <li>The <b>pinned</b> pieces, which may only move along the line through their king and their pinner.</li>
+ * </ul>
+ * <p>En-passant is the one move which removes two pieces from a line through the king, so it is verified by testing
+ * for slider attacks against the resulting occupancy.</p>
+ */
+template<move_generation_kind kind, typename position_type, typename color_type>
+void generate_legal_moves_as(const position_type& position, move_buffer& buffer, const color_type mover) {
+    count_event(instrumented_counter::move_generations);
+    const scoped_cycle_timer timer(instrumented_timer::move_generation);
+    const piece_color us = mover;
+    const piece_color them = !us;
+    assert(position.whos_turn == us);
+    const bitboard own = color_bitboards(position)[us];
+    const bitboard enemy = color_bitboards(position)[them];
+    const bitboard occupancy = own | enemy;
+    const std::array<bitboard, 7>& types = piece_bitboards(position);
+    const bitboard enemy_bishoplike = (types[piece_type::bishop] | types[piece_type::queen]) & enemy;
+    const bitboard enemy_rooklike = (types[piece_type::rook] | types[piece_type::queen]) & enemy;
+    const uint8_t king = std::countr_zero(types[piece_type::king] & own);
+
+    bitboard destination_mask = 0;
+    if constexpr (kind & move_generation_kind::captures) destination_mask |= enemy;
+    if constexpr (kind & move_generation_kind::quiets) destination_mask |= ~occupancy;
+
+    const bitboard danger = attacked_squares(position, them, occupancy ^ sbitboard(king));
+    push_moves(king, king_move_table[king] & ~danger & destination_mask, buffer);
+
+    const bitboard checkers = (pawn_attack_table[us][king] & types[piece_type::pawn] & enemy) |
+                              (knight_move_table[king] & types[piece_type::knight] & enemy) |
+                              (bishoplike_attacks(king, occupancy) & enemy_bishoplike) |
+                              (rooklike_attacks(king, occupancy) & enemy_rooklike);
+    if (checkers & (checkers - 1)) return;
+    const bitboard evasion_mask = checkers ? between_table[king][std::countr_zero(checkers)] | checkers
+                                           : ~static_cast<bitboard>(0);
+
+    // A sniper is an enemy slider which would attack the king were it not for the pieces in between. If exactly one
+    // piece stands in between and it is ours, it is pinned.
+    bitboard pinned = 0;
+    const bitboard snipers = (bishoplike_attacks(king, enemy) & enemy_bishoplike) |
+                             (rooklike_attacks(king, enemy) & enemy_rooklike);
+    for (bitboard remaining = snipers; remaining; remaining &= remaining - 1) {
+        const bitboard blockers = between_table[king][std::countr_zero(remaining)] & occupancy;
+        if (std::popcount(blockers) == 1) pinned |= blockers & own;
+    }
+
+    const bitboard target_mask = destination_mask & evasion_mask;
+
+    const bitboard pawns = types[piece_type::pawn] & own;
+    generate_pawn_moves<kind>(pawns & ~pinned, ~occupancy, enemy, evasion_mask, buffer, mover);
+    for (bitboard pinned_pawns = pawns & pinned; pinned_pawns; pinned_pawns &= pinned_pawns - 1) {
+        const uint8_t origin = std::countr_zero(pinned_pawns);
+        generate_pawn_moves<kind>(sbitboard(origin), ~occupancy, enemy, evasion_mask & line_table[king][origin],
+                                  buffer, mover);
+    }
+    if constexpr (kind & move_generation_kind::captures) {
+        if (position.enpassant_file != no_enpassant) {
+            const uint8_t destination = enpassant_destination(us, position.enpassant_file);
+            const uint8_t captured = destination + (us == piece_color::white ? -8 : 8);
+            if (evasion_mask & (sbitboard(destination) | sbitboard(captured))) {
+                for (bitboard attackers = pawn_attack_table[them][destination] & pawns; attackers;
+                     attackers &= attackers - 1) {
+                    const uint8_t origin = std::countr_zero(attackers);
+                    const bitboard after = (occupancy ^ sbitboard(origin) ^ sbitboard(captured)) | sbitboard(destination);
+                    if (bishoplike_attacks(king, after) & enemy_bishoplike) continue;
+                    if (rooklike_attacks(king, after) & enemy_rooklike) continue;
+                    buffer.push(bitmove(origin, destination, piece_type::none));
+                }
+            }
+        }
+    }
+
+    // A pinned knight can never stay on the line of its pin.
+    for (bitboard knights = types[piece_type::knight] & own & ~pinned; knights; knights &= knights - 1) {
+        const uint8_t origin = std::countr_zero(knights);
+        push_moves(origin, knight_move_table[origin] & target_mask, buffer);
+    }
+    for (bitboard bishoplike = (types[piece_type::bishop] | types[piece_type::queen]) & own; bishoplike;
+         bishoplike &= bishoplike - 1) {
+        const uint8_t origin = std::countr_zero(bishoplike);
+        const bitboard pin_mask = (pinned & sbitboard(origin)) ? line_table[king][origin] : ~static_cast<bitboard>(0);
+        push_moves(origin, bishoplike_attacks(origin, occupancy) & target_mask & pin_mask, buffer);
+    }
+    for (bitboard rooklike = (types[piece_type::rook] | types[piece_type::queen]) & own; rooklike;
+         rooklike &= rooklike - 1) {
+        const uint8_t origin = std::countr_zero(rooklike);
+        const bitboard pin_mask = (pinned & sbitboard(origin)) ? line_table[king][origin] : ~static_cast<bitboard>(0);
+        push_moves(origin, rooklike_attacks(origin, occupancy) & target_mask & pin_mask, buffer);
+    }
+
+    if constexpr (kind & move_generation_kind::quiets) {
+        if (checkers) return;
+        const uint8_t home_rank = us == piece_color::white ? 0 : 7;
+        const uint8_t kingside = us == piece_color::white ? castling_right::white_kingside
+                                                          : castling_right::black_kingside;
+        const uint8_t queenside = us == piece_color::white ? castling_right::white_queenside
+                                                           : castling_right::black_queenside;
+        const bitboard kingside_path = sbitboard(coords_to_sindex(home_rank, 5)) |
+                                       sbitboard(coords_to_sindex(home_rank, 6));
+        const bitboard queenside_path = sbitboard(coords_to_sindex(home_rank, 1)) |
+                                        sbitboard(coords_to_sindex(home_rank, 2)) |
+                                        sbitboard(coords_to_sindex(home_rank, 3));
+        const bitboard queenside_king_path = sbitboard(coords_to_sindex(home_rank, 2)) |
+                                             sbitboard(coords_to_sindex(home_rank, 3));
+        if ((position.castling_rights & kingside) && !(occupancy & kingside_path) && !(danger & kingside_path)) {
+            buffer.push(bitmove(king, coords_to_sindex(home_rank, 6), piece_type::none));
+        }
+        if ((position.castling_rights & queenside) && !(occupancy & queenside_path)
+            && !(danger & queenside_king_path)) {
+            buffer.push(bitmove(king, coords_to_sindex(home_rank, 2), piece_type::none));
+        }
+    }
+}
+
+/** Emits every legal move available to the player whose turn it is. */
+template<typename position_type>
+void generate_legal_moves(const position_type& position, move_buffer& buffer) {
+    generate_legal_moves_as<move_generation_kind::all_moves>(position, buffer, position.whos_turn);
+}
+
+template<piece_color us, typename position_type>
+void generate_legal_moves(const position_type& position, move_buffer& buffer) {
+    generate_legal_moves_as<move_generation_kind::all_moves>(position, buffer, color_constant<us> {});
+}
+
+/** Emits every legal move which captures a piece or promotes a pawn. */
+template<piece_color us, typename position_type>
+void generate_legal_captures(const position_type& position, move_buffer& buffer) {
+    generate_legal_moves_as<move_generation_kind::captures>(position, buffer, color_constant<us> {});
+}
+
+/** Emits every legal move which neither captures a piece nor promotes a pawn. */
+template<piece_color us, typename position_type>
+void generate_legal_quiets(const position_type& position, move_buffer& buffer) {
+    generate_legal_moves_as<move_generation_kind::quiets>(position, buffer, color_constant<us> {});
+}
+
+/**
+ * Determines whether the given move captures a piece or promotes a pawn, that is, whether the legal move generator
+ * would emit it among the captures rather than among the quiets.
+ */
+template<typename position_type>
+[[nodiscard]] bool is_capture_or_promotion(const position_type& position, const bitmove move) {
+    const auto [origin, destination, promote_to] = move.unpack_all();
+    if (promote_to != piece_type::none) return true;
+    if (piece_type_on(position, destination) != piece_type::none) return true;
+    return piece_type_on(position, origin) == piece_type::pawn
+           && (origin & 0b111) != (destination & 0b111);
+}
+
+/**
+ * <p>Determines whether the given move is legal for <code>us</code>, the player whose turn it is, without generating
+ * any other move. The search uses this to try a move remembered from elsewhere in the tree, such as the move of a
+ * transposition table entry or a killer move, before paying for move generation. Such a move may not even be
+ * pseudo-legal if it was recorded for another position, for example when two keys collide.</p>
+ * <p>The king's safety is tested against the occupancy the move leaves behind, so the move is never made.</p>
+ */
+template<piece_color us, typename position_type>
+[[nodiscard]] bool is_legal_move(const position_type& position, const bitmove move) {
+    if (move.is_null()) return false;
+    const auto [origin, destination, promote_to] = move.unpack_all();
+    const bitboard own = color_bitboards(position)[us];
+    const bitboard enemy = color_bitboards(position)[!us];
+    const bitboard occupancy = own | enemy;
+    if (!(own & sbitboard(origin)) || (own & sbitboard(destination))) return false;
+    const std::array<bitboard, 7>& types = piece_bitboards(position);
+    const piece_type type = piece_type_on(position, origin);
+    const uint8_t king = std::countr_zero(types[piece_type::king] & own);
+    bitboard captured = enemy & sbitboard(destination);
+
+    if (type == piece_type::pawn) {
+        const bool reaches_last_rank = (destination >> 3) == (us == piece_color::white ? 7 : 0);
+        if (reaches_last_rank != (promote_to != piece_type::none)) return false;
+        if (promote_to == piece_type::king || promote_to == piece_type::pawn) return false;
+        const int8_t forward = us == piece_color::white ? 8 : -8;
+        const uint8_t start_rank = us == piece_color::white ? 1 : 6;
+        if (destination == origin + forward) {
+            if (captured) return false;
+        } else if (destination == origin + 2 * forward) {
+            if ((origin >> 3) != start_rank || (occupancy & (sbitboard(origin + forward) | sbitboard(destination))))
+                return false;
+        } else if (pawn_attack_table[us][origin] & sbitboard(destination)) {
+            if (!captured) {
+                if (position.enpassant_file == no_enpassant
+                    || destination != enpassant_destination(us, position.enpassant_file)) {
+                    return false;
+                }
+                captured = sbitboard(destination - forward);
+            }
+        } else {
+            return false;
+        }
+    } else {
+        if (promote_to != piece_type::none) return false;
+        bitboard reachable;
+        switch (type) {
+            case piece_type::knight: reachable = knight_move_table[origin]; break;
+            case piece_type::bishop: reachable = bishoplike_attacks(origin, occupancy); break;
+            case piece_type::rook: reachable = rooklike_attacks(origin, occupancy); break;
+            case piece_type::queen:
+                reachable = bishoplike_attacks(origin, occupancy) | rooklike_attacks(origin, occupancy);
+                break;
+            case piece_type::king: reachable = king_move_table[origin]; break;
+            default: return false;
+        }
+        if (type == piece_type::king && !(reachable & sbitboard(destination))) {
+            // The only other move of a king is castling, which is legal exactly when the generator would emit it.
+            if (captured || (origin & 0b111) != 4 || (destination >> 3) != (origin >> 3)) return false;
+            move_buffer castles;
+            generate_legal_moves_as<move_generation_kind::quiets>(position, castles, color_constant<us> {});
+            return std::find(castles.begin(), castles.end(), move) != castles.end();
+        }
+        if (!(reachable & sbitboard(destination))) return false;
+    }
+
+    const bitboard after = (occupancy ^ sbitboard(origin) ^ captured) | sbitboard(destination);
+    const uint8_t king_after = type == piece_type::king ? destination : king;
+    const bitboard attackers = enemy & ~captured;
+    if (pawn_attack_table[us][king_after] & types[piece_type::pawn] & attackers) return false;
+    if (knight_move_table[king_after] & types[piece_type::knight] & attackers) return false;
+    if (king_move_table[king_after] & types[piece_type::king] & attackers) return false;
+    if (bishoplike_attacks(king_after, after) & (types[piece_type::bishop] | types[piece_type::queen]) & attackers)
+        return false;
+    return !(rooklike_attacks(king_after, after) & (types[piece_type::rook] | types[piece_type::queen]) & attackers);
+}
@@ -0,0 +1,418 @@
+#pragma once
+
+/**
+ * <h2>Efficiently Updatable Neural Network</h2>
+ * <p>The network file, its SIMD kernels and the incrementally updated accumulators.</p>
+ */
+
+#include "board.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Efficiently Updatable Neural Network
+
+/**
+ * The instruction set used by the network kernels. Like the sliding attack backend, it defaults to the widest one the
+ * compiler targets, and may be overridden by defining <code>SIMPLE_CHESS_NNUE_KERNEL</code>.
+ */
+enum class nnue_kernel { scalar, neon, avx2, avx512 };
+
+#if !defined(SIMPLE_CHESS_NNUE_KERNEL)
+#if defined(__AVX512BW__)
+#define SIMPLE_CHESS_NNUE_KERNEL avx512
+#elif defined(__AVX2__)
+#define SIMPLE_CHESS_NNUE_KERNEL avx2
+#elif defined(__ARM_NEON)
+#define SIMPLE_CHESS_NNUE_KERNEL neon
+#else
+#define SIMPLE_CHESS_NNUE_KERNEL scalar
+#endif
+#endif
+
+constexpr nnue_kernel active_nnue_kernel = nnue_kernel::SIMPLE_CHESS_NNUE_KERNEL;
+
+#if !defined(__AVX512BW__)
+static_assert(active_nnue_kernel != nnue_kernel::avx512,
+              "The avx512 network kernel requires an AVX-512BW target, for example -mavx512bw or -march=native.");
+#endif
+#if !defined(__AVX2__)
+static_assert(active_nnue_kernel != nnue_kernel::avx2,
+              "The avx2 network kernel requires an AVX2 target, for example -mavx2 or -march=native.");
+#endif
+#if !defined(__ARM_NEON)
+static_assert(active_nnue_kernel != nnue_kernel::neon, "The neon network kernel requires an ARM target with NEON.");
+#endif
+
+/** One input per piece type, color and square, seen from either player's perspective. */
+constexpr std::size_t nnue_feature_count = 768;
+constexpr std::size_t nnue_hidden_size = 256;
+
+/** The hidden activations are clipped to [0, <code>nnue_activation_limit</code>], which represents 1.0. */
+constexpr int nnue_activation_limit = 255;
+
+/** The quantization of the output weights, which is the integer representing a weight of 1.0. */
+constexpr int nnue_output_quantization = 64;
+
+/** The bound on the network's evaluation, which keeps it clear of the scores reserved for mate. */
+constexpr int nnue_max_score = 20000;
+
+/**
+ * Returns the input which the given piece activates in the accumulator of the given perspective. Each player sees
+ * the board from its own side, so its own pieces come first and the board is mirrored vertically for black.
+ */
+[[nodiscard]] constexpr std::size_t nnue_feature_index(const piece_color perspective, const piece_color color,
+                                                       const piece_type type, const uint8_t sindex) {
+    const uint8_t relative_sindex = perspective == piece_color::white ? sindex : sindex ^ 0b111000;
+    return (color != perspective) * 384 + type * 64 + relative_sindex;
+}
+
+/**
+ * <h2>Network File</h2>
+ * <p>A network file begins with this 64 byte header, followed by the quantized parameters as little-endian integers
+ * in the order below. Every array is a multiple of 64 bytes long, so each begins on a cache line of the mapping.
+ * <pre>\n
+ * int16 feature_weights[nnue_feature_count][nnue_hidden_size] \n
+ * int16 feature_biases[nnue_hidden_size] \n
+ * int16 output_weights[2 * nnue_hidden_size]  (the player to move's half first) \n
+ * int32 output_bias
+ * \n\n</pre></p>
+ * <p>The evaluation in centipawns is the output times <code>output_scale</code>, divided by
+ * <code>nnue_activation_limit * nnue_output_quantization</code>.</p>
+ */
+struct nnue_file_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t feature_count;
+    std::uint32_t hidden_size;
+    std::int32_t output_scale;
+    std::array<std::uint8_t, 40> reserved;
+};
+static_assert(sizeof(nnue_file_header) == 64);
+
+constexpr std::array<char, 8> nnue_file_magic = { 'S', 'C', 'C', 'N', 'N', 'U', 'E', '\0' };
+constexpr std::uint32_t nnue_file_version = 1;
+
+/**
+ * <h2>Network</h2>
+ * <p>Maps a network file into memory read-only, and reads its parameters in place. The weights for all threads are
+ * shared through the page cache, and the operating system pages them in as they are first used.</p>
+ */
+class nnue_network {
+    private:
+        void* mapping = nullptr;
+        std::size_t mapping_size = 0;
+        const int16_t* feature_weights = nullptr;
+        const int16_t* feature_biases = nullptr;
+        const int16_t* output_weights = nullptr;
+        std::int32_t output_bias = 0;
+        std::int32_t output_scale = 0;
+    public:
+        static constexpr std::size_t file_size = sizeof(nnue_file_header) +
+            sizeof(int16_t) * (nnue_feature_count * nnue_hidden_size + 3 * nnue_hidden_size) + sizeof(std::int32_t);
+
+        /** Maps the given file. If it cannot be mapped, or is not a network, <code>is_open</code> returns false. */
+        explicit nnue_network(const std::string& path) {
+            const int descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0) return;
+            struct stat status {};
+            if (::fstat(descriptor, &status) == 0 && static_cast<std::size_t>(status.st_size) == file_size) {
+                mapping_size = file_size;
+                mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapping == MAP_FAILED) mapping = nullptr;
+            }
+            ::close(descriptor);
+            if (!mapping) return;
+            const auto* header = static_cast<const nnue_file_header*>(mapping);
+            if (header->magic != nnue_file_magic || header->version != nnue_file_version
+                || header->feature_count != nnue_feature_count || header->hidden_size != nnue_hidden_size) {
+                return;
+            }
+            feature_weights = reinterpret_cast<const int16_t*>(header + 1);
+            feature_biases = feature_weights + nnue_feature_count * nnue_hidden_size;
+            output_weights = feature_biases + nnue_hidden_size;
+            std::memcpy(&output_bias, output_weights + 2 * nnue_hidden_size, sizeof(output_bias));
+            output_scale = header->output_scale;
+        }
+
+        nnue_network(const nnue_network&) = delete;
+        nnue_network& operator=(const nnue_network&) = delete;
+
+        ~nnue_network() {
+            if (mapping) ::munmap(mapping, mapping_size);
+        }
+
+        [[nodiscard]] bool is_open() const { return feature_weights != nullptr; }
+
+        /** The column of first layer weights added to the accumulator while the given input is active. */
+        [[nodiscard]] const int16_t* feature_row(const std::size_t feature) const {
+            return feature_weights + feature * nnue_hidden_size;
+        }
+
+        [[nodiscard]] const int16_t* biases() const { return feature_biases; }
+
+        /** The output weights of the given half of the hidden layer, zero being the player to move's. */
+        [[nodiscard]] const int16_t* output_row(const std::size_t half) const {
+            return output_weights + half * nnue_hidden_size;
+        }
+
+        [[nodiscard]] std::int32_t bias() const { return output_bias; }
+        [[nodiscard]] std::int32_t scale() const { return output_scale; }
+};
+
+/**
+ * The network used by every evaluation, or null when none was loaded, in which case the hand-written evaluation is
+ * used. It is set once at startup, before any position is created, and never changes afterwards.
+ */
+inline const nnue_network* active_network = nullptr;
+
+/** The first layer activations, one set for each perspective, indexed by <code>piece_color</code>. */
+struct alignas(64) nnue_accumulator {
+    std::array<std::array<int16_t, nnue_hidden_size>, 2> values;
+};
+
+/**
+ * <h2>Accumulator Update Kernel</h2>
+ * <p>Writes <code>from</code> plus the sum of the <code>added</code> rows, less the sum of the <code>removed</code>
+ * rows, to <code>to</code>. Each lane is read and written once, whatever the number of rows. The arithmetic wraps,
+ * so a well-formed network never overflows in the final sum despite intermediate overflow.</p>
+ */
+inline void nnue_update_accumulator(const int16_t* const from, int16_t* const to,
+                                    const std::span<const int16_t* const> added,
+                                    const std::span<const int16_t* const> removed) {
+#if defined(__AVX512BW__)
+    if constexpr (active_nnue_kernel == nnue_kernel::avx512) {
+        for (std::size_t i = 0; i < nnue_hidden_size; i += 32) {
+            __m512i lanes = _mm512_loadu_si512(from + i);
+            for (const int16_t* row : added) lanes = _mm512_add_epi16(lanes, _mm512_loadu_si512(row + i));
+            for (const int16_t* row : removed) lanes = _mm512_sub_epi16(lanes, _mm512_loadu_si512(row + i));
+            _mm512_storeu_si512(to + i, lanes);
+        }
+        return;
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (active_nnue_kernel == nnue_kernel::avx2) {
+        for (std::size_t i = 0; i < nnue_hidden_size; i += 16) {
+            __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+            for (const int16_t* row : added) {
+                lanes = _mm256_add_epi16(lanes, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+            }
+            for (const int16_t* row : removed) {
+                lanes = _mm256_sub_epi16(lanes, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(to + i), lanes);
+        }
+        return;
+    }
+#endif
+#if defined(__ARM_NEON)
+    if constexpr (active_nnue_kernel == nnue_kernel::neon) {
+        for (std::size_t i = 0; i < nnue_hidden_size; i += 8) {
+            int16x8_t lanes = vld1q_s16(from + i);
+            for (const int16_t* row : added) lanes = vaddq_s16(lanes, vld1q_s16(row + i));
+            for (const int16_t* row : removed) lanes = vsubq_s16(lanes, vld1q_s16(row + i));
+            vst1q_s16(to + i, lanes);
+        }
+        return;
+    }
+#endif
+    // One row at a time, which the compiler vectorizes for whatever target it has.
+    if (to != from) std::copy_n(from, nnue_hidden_size, to);
+    for (const int16_t* row : added) {
+        for (std::size_t i = 0; i < nnue_hidden_size; ++i) to[i] = static_cast<int16_t>(to[i] + row[i]);
+    }
+    for (const int16_t* row : removed) {
+        for (std::size_t i = 0; i < nnue_hidden_size; ++i) to[i] = static_cast<int16_t>(to[i] - row[i]);
+    }
+}
+
+/**
+ * <h2>Output Kernel</h2>
+ * <p>Returns the dot product of the given accumulator half, clipped to [0, <code>nnue_activation_limit</code>], with
+ * the given output weights. Pairs of 16-bit products are summed into 32-bit lanes as they are formed.</p>
+ */
+[[nodiscard]] inline std::int32_t nnue_clipped_dot(const int16_t* const activations, const int16_t* const weights) {
+#if defined(__AVX512BW__)
+    if constexpr (active_nnue_kernel == nnue_kernel::avx512) {
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i limit = _mm512_set1_epi16(nnue_activation_limit);
+        __m512i sum = zero;
+        for (std::size_t i = 0; i < nnue_hidden_size; i += 32) {
+            const __m512i clipped = _mm512_min_epi16(_mm512_max_epi16(_mm512_loadu_si512(activations + i), zero), limit);
+            sum = _mm512_add_epi32(sum, _mm512_madd_epi16(clipped, _mm512_loadu_si512(weights + i)));
+        }
+        return _mm512_reduce_add_epi32(sum);
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (active_nnue_kernel == nnue_kernel::avx2) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i limit = _mm256_set1_epi16(nnue_activation_limit);
+        __m256i sum = zero;
+        for (std::size_t i = 0; i < nnue_hidden_size; i += 16) {
+            const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(activations + i));
+            const __m256i clipped = _mm256_min_epi16(_mm256_max_epi16(lanes, zero), limit);
+            const __m256i row = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(clipped, row));
+        }
+        const __m128i halves = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        const __m128i pairs = _mm_add_epi32(halves, _mm_shuffle_epi32(halves, 0b01001110));
+        return _mm_cvtsi128_si32(_mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, 0b10110001)));
+    }
+#endif
+#if defined(__ARM_NEON)
+    if constexpr (active_nnue_kernel == nnue_kernel::neon) {
+        const int16x8_t zero = vdupq_n_s16(0);
+        const int16x8_t limit = vdupq_n_s16(nnue_activation_limit);
+        int32x4_t sum = vdupq_n_s32(0);
+        for (std::size_t i = 0; i < nnue_hidden_size; i += 8) {
+            const int16x8_t clipped = vminq_s16(vmaxq_s16(vld1q_s16(activations + i), zero), limit);
+            const int16x8_t row = vld1q_s16(weights + i);
+            sum = vmlal_s16(sum, vget_low_s16(clipped), vget_low_s16(row));
+            sum = vmlal_s16(sum, vget_high_s16(clipped), vget_high_s16(row));
+        }
+        return vaddvq_s32(sum);
+    }
+#endif
+    std::int32_t sum = 0;
+    for (std::size_t i = 0; i < nnue_hidden_size; ++i) {
+        sum += std::clamp<std::int32_t>(activations[i], 0, nnue_activation_limit) * weights[i];
+    }
+    return sum;
+}
+
+/** A piece entering or leaving a square, which toggles one input in each perspective. */
+struct nnue_piece {
+    piece_color color;
+    piece_type type;
+    uint8_t sindex;
+};
+
+/** The pieces which a move places and removes. No move places or removes more than two. */
+struct nnue_delta {
+    std::array<nnue_piece, 2> added;
+    std::array<nnue_piece, 2> removed;
+    uint8_t added_count = 0;
+    uint8_t removed_count = 0;
+
+    void add(const piece_color color, const piece_type type, const uint8_t sindex) {
+        added[added_count++] = { color, type, sindex };
+    }
+
+    void remove(const piece_color color, const piece_type type, const uint8_t sindex) {
+        removed[removed_count++] = { color, type, sindex };
+    }
+};
+
+/** Computes the accumulator reached from <code>from</code> by the given delta, for both perspectives. */
+inline void apply_accumulator_delta(const nnue_network& network, const nnue_accumulator& from, nnue_accumulator& to,
+                                    const nnue_delta& delta) {
+    for (const piece_color perspective : { piece_color::white, piece_color::black }) {
+        std::array<const int16_t*, 2> added_rows {};
+        std::array<const int16_t*, 2> removed_rows {};
+        for (uint8_t i = 0; i < delta.added_count; ++i) {
+            const nnue_piece& piece = delta.added[i];
+            added_rows[i] = network.feature_row(nnue_feature_index(perspective, piece.color, piece.type, piece.sindex));
+        }
+        for (uint8_t i = 0; i < delta.removed_count; ++i) {
+            const nnue_piece& piece = delta.removed[i];
+            removed_rows[i] = network.feature_row(nnue_feature_index(perspective, piece.color, piece.type,
+                                                                     piece.sindex));
+        }
+        nnue_update_accumulator(from.values[perspective].data(), to.values[perspective].data(),
+                                { added_rows.data(), delta.added_count },
+                                { removed_rows.data(), delta.removed_count });
+    }
+}
+
+/** Computes the accumulator of the given position from scratch, by summing the rows of every piece on the board. */
+template<typename position_type>
+void compute_accumulator(const nnue_network& network, const position_type& position, nnue_accumulator& accumulator) {
+    for (const piece_color perspective : { piece_color::white, piece_color::black }) {
+        int16_t* const values = accumulator.values[perspective].data();
+        std::copy_n(network.biases(), nnue_hidden_size, values);
+        const bitboard occupied = ~position.type_specific_bitboard[piece_type::none];
+        for (bitboard remaining = occupied; remaining; remaining &= remaining - 1) {
+            const uint8_t sindex = std::countr_zero(remaining);
+            const piece_color color = static_cast<piece_color>(
+                    (position.color_bitboard[piece_color::white] >> sindex) & 1);
+            const int16_t* const row = network.feature_row(
+                    nnue_feature_index(perspective, color, position.occupier_type_lookup_table[sindex], sindex));
+            nnue_update_accumulator(values, values, { &row, 1 }, {});
+        }
+    }
+}
+
+/** Evaluates the accumulator in centipawns for the given player to move. */
+[[nodiscard]] inline int nnue_evaluate(const nnue_network& network, const nnue_accumulator& accumulator,
+                                       const piece_color to_move) {
+    const std::int64_t output = static_cast<std::int64_t>(network.bias()) +
+                                nnue_clipped_dot(accumulator.values[to_move].data(), network.output_row(0)) +
+                                nnue_clipped_dot(accumulator.values[!to_move].data(), network.output_row(1));
+    const std::int64_t score = output * network.scale() / (nnue_activation_limit * nnue_output_quantization);
+    return static_cast<int>(std::clamp<std::int64_t>(score, -nnue_max_score, nnue_max_score));
+}
+
+/** The placeholder for the accumulators of a position type which does not maintain them. */
+struct no_accumulators {};
+
+/**
+ * <p>The accumulators of the positions along the current line, in a ring indexed by the length of the move log.
+ * <code>make_move</code> computes the entry of the position it reaches from the entry of the position it left, and
+ * <code>unmake_move</code> has nothing to do, because the entry of the position it returns to is still in place.</p>
+ * <p>The ring holds the last <code>capacity</code> positions, which is the deepest a search may descend from its
+ * root. Unmaking further back than that requires the position to be loaded afresh.</p>
+ */
+struct nnue_accumulator_stack {
+    static constexpr std::size_t capacity = 128;
+    std::array<nnue_accumulator, capacity> entries;
+
+    [[nodiscard]] nnue_accumulator& at(const std::size_t ply) { return entries[ply % capacity]; }
+    [[nodiscard]] const nnue_accumulator& at(const std::size_t ply) const { return entries[ply % capacity]; }
+};
+
+/** True if the position type maintains network accumulators in <code>make_move</code>. */
+template<typename position_type>
+constexpr bool maintains_accumulators = !std::is_same_v<decltype(position_type::accumulators), no_accumulators>;
+
+/** Computes the current accumulator of the given position from scratch, if it maintains them and a network is loaded. */
+template<typename position_type>
+void refresh_accumulator(position_type& position) {
+    if constexpr (maintains_accumulators<position_type>) {
+        if (active_network) {
+            compute_accumulator(*active_network, position, position.accumulators.at(position.move_log.size()));
+        }
+    }
+}
+
+/** Determines whether the incrementally updated accumulator of the position matches one computed from scratch. */
+template<typename position_type>
+[[nodiscard]] bool accumulator_is_consistent(const position_type& position) {
+    if constexpr (maintains_accumulators<position_type>) {
+        if (active_network) {
+            nnue_accumulator expected;
+            compute_accumulator(*active_network, position, expected);
+            return expected.values == position.accumulators.at(position.move_log.size()).values;
+        }
+    }
+    return true;
+}
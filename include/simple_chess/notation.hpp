@@ -0,0 +1,300 @@
+#pragma once
+
+/**
+ * <h2>Notation</h2>
+ * <p>Long algebraic notation and FEN.</p>
+ */
+
+#include "move_generation.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Notation
+
+/** Writes the given move in the long algebraic notation used by UCI, for example <code>e2e4</code> or <code>e7e8q</code>. */
+inline std::string to_long_algebraic(const bitmove move) {
+    const auto [origin, destination, promote_to] = move.unpack_all();
+    std::string notation;
+    notation += static_cast<char>('a' + (origin & 0b111));
+    notation += static_cast<char>('1' + (origin >> 3));
+    notation += static_cast<char>('a' + (destination & 0b111));
+    notation += static_cast<char>('1' + (destination >> 3));
+    constexpr std::array<char, 7> promotion_symbols = { 'r', 'n', 'b', 'q', 'k', 'p', '\0' };
+    if (promote_to != piece_type::none) notation += promotion_symbols[promote_to];
+    return notation;
+}
+
+/** Finds the legal move written in long algebraic notation, or returns the null move if there is none. */
+template<typename position_type>
+[[nodiscard]] bitmove parse_long_algebraic(const position_type& position, const std::string_view notation) {
+    move_buffer moves;
+    generate_legal_moves(position, moves);
+    for (const bitmove move : moves) {
+        if (to_long_algebraic(move) == notation) return move;
+    }
+    return bitmove::null();
+}
+
+/**
+ * Removes the leading whitespace-delimited field from the given text and returns it. Returns an empty view once the
+ * text holds nothing but whitespace.
+ */
+inline std::string_view take_field(std::string_view& text) {
+    const std::size_t begin = std::min(text.find_first_not_of(" \t\r\n"), text.size());
+    const std::size_t end = std::min(text.find_first_of(" \t\r\n", begin), text.size());
+    const std::string_view field = text.substr(begin, end - begin);
+    text.remove_prefix(end);
+    return field;
+}
+
+/** The FEN symbols of the pieces, indexed by color and type. */
+constexpr std::array<std::array<char, 7>, 2> fen_piece_symbols = {{
+    { 'r', 'n', 'b', 'q', 'k', 'p', '\0' },
+    { 'R', 'N', 'B', 'Q', 'K', 'P', '\0' }
+}};
+
+constexpr uint8_t invalid_fen_symbol = 0xFF;
+
+/**
+ * Maps each character to the piece it stands for in the placement field of a FEN string, packed as the color in
+ * bit three above the type, or to <code>invalid_fen_symbol</code>.
+ */
+consteval std::array<uint8_t, 256> generate_fen_symbol_table() {
+    std::array<uint8_t, 256> table {};
+    table.fill(invalid_fen_symbol);
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        for (uint8_t type = piece_type::rook; type < piece_type::none; ++type) {
+            table[static_cast<unsigned char>(fen_piece_symbols[color][type])] = color << 3 | type;
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<uint8_t, 256> fen_symbol_table = generate_fen_symbol_table();
+
+/**
+ * The castling rights of the given set which the board bears out, each needing its king and its rook on their home
+ * squares. A right without them would have <code>make_move</code> castle with a piece which is not there.
+ */
+template<typename position_type>
+[[nodiscard]] uint8_t castling_rights_on_board(const position_type& position, uint8_t castling_rights) {
+    constexpr std::array<std::pair<uint8_t, piece_type>, 3> homes = { {
+        { 4, piece_type::king }, { 7, piece_type::rook }, { 0, piece_type::rook }
+    } };
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        for (const auto& [file, type] : homes) {
+            const uint8_t sindex = coords_to_sindex(color == piece_color::white ? 0 : 7, file);
+            const bool is_home = position.occupier_type_lookup_table[sindex] == type
+                                 && (position.color_bitboard[color] & sbitboard(sindex));
+            if (!is_home) castling_rights &= castling_rights_mask_table[sindex];
+        }
+    }
+    return castling_rights;
+}
+
+/**
+ * The given en-passant file if the board bears it out, with a pawn of the player who just moved standing where a
+ * double push onto the file would have put it, and the two squares it passed over empty, or else
+ * <code>no_enpassant</code>. A file without that pawn would set the key apart from that of the same position
+ * reached by <code>make_move</code>.
+ */
+template<typename position_type>
+[[nodiscard]] uint8_t enpassant_file_on_board(const position_type& position, const uint8_t enpassant_file) {
+    if (enpassant_file == no_enpassant) return no_enpassant;
+    const piece_color pusher = !position.whos_turn;
+    const int forward = pusher == piece_color::white ? 1 : -1;
+    const uint8_t destination = coords_to_sindex(pusher == piece_color::white ? 3 : 4, enpassant_file);
+    const bitboard passed = sbitboard(destination - 8 * forward) | sbitboard(destination - 16 * forward);
+    const bool is_pushed = position.occupier_type_lookup_table[destination] == piece_type::pawn
+                           && (position.color_bitboard[pusher] & sbitboard(destination));
+    return is_pushed && (position.type_specific_bitboard[piece_type::none] & passed) == passed ? enpassant_file
+                                                                                                : no_enpassant;
+}
+
+/**
+ * <h2>FEN Parser</h2>
+ * <p>Resets the given position to the one described by the given Forsyth–Edwards Notation string. The halfmove
+ * clock is read if present, and taken to be zero otherwise, as in an EPD record. Anything after it, such as the
+ * fullmove number or the operations of an EPD record, is ignored.</p>
+ * <p>The string is parsed in place, in a single pass, and without allocating. Each piece of the placement field is
+ * decoded with one lookup in <code>fen_symbol_table</code>, and is entered into the bitboards, the occupier table,
+ * the Zobrist key and the piece-square score at once, so none of them need be computed from scratch afterwards.</p>
+ * <p>Castling rights and an en-passant file which the board does not bear out are dropped, see
+ * <code>castling_rights_on_board</code> and <code>enpassant_file_on_board</code>.</p>
+ * <p>Returns false if the string is not well-formed FEN, in which case the position is left in an unspecified
+ * state.</p>
+ */
+template<typename position_type>
+[[nodiscard]] bool load_fen(std::string_view fen, position_type& position) {
+    const std::string_view placement = take_field(fen);
+    const std::string_view turn = take_field(fen);
+    const std::string_view castling = take_field(fen);
+    const std::string_view enpassant = take_field(fen);
+    const std::string_view halfmove_clock = take_field(fen);
+    if (enpassant.empty()) return false;
+
+    position.color_bitboard = {};
+    position.color_bitboard_rotated = {};
+    position.type_specific_bitboard = {};
+    position.occupier_type_lookup_table.fill(piece_type::none);
+    // Popping rather than assigning an empty log spares the ply-indexed log from zeroing every entry.
+    while (!position.move_log.empty()) position.move_log.pop();
+    zobrist_key hash = 0;
+    zobrist_key pawn_hash = 0;
+    packed_score piece_square_score = 0;
+    uint8_t game_phase = 0;
+
+    // The placement field lists the ranks from the eighth down, so the square index counts down a rank at a time
+    // and up a file at a time.
+    int8_t rank = 7;
+    int8_t file = 0;
+    for (const char symbol : placement) {
+        if (symbol == '/') {
+            if (file != 8 || rank == 0) return false;
+            --rank;
+            file = 0;
+            continue;
+        }
+        if (symbol >= '1' && symbol <= '8') {
+            file += symbol - '0';
+            if (file > 8) return false;
+            continue;
+        }
+        const uint8_t code = fen_symbol_table[static_cast<unsigned char>(symbol)];
+        if (code == invalid_fen_symbol || file > 7) return false;
+        const auto color = static_cast<piece_color>(code >> 3);
+        const auto type = static_cast<piece_type>(code & 0b111);
+        const uint8_t sindex = coords_to_sindex(rank, file);
+        position.occupier_type_lookup_table[sindex] = type;
+        position.color_bitboard[color] |= sbitboard(sindex);
+        position.color_bitboard_rotated[color] |= sbitboard(rotate_sindex(sindex));
+        position.type_specific_bitboard[type] |= sbitboard(sindex);
+        hash ^= zobrist_tables.piece[color][type][sindex];
+        if (type == piece_type::pawn) pawn_hash ^= zobrist_tables.piece[color][type][sindex];
+        piece_square_score += piece_square_table[color][type][sindex];
+        game_phase += game_phase_values[type];
+        ++file;
+    }
+    if (rank != 0 || file != 8) return false;
+    position.type_specific_bitboard[piece_type::none] = ~(position.color_bitboard[piece_color::white] |
+                                                          position.color_bitboard[piece_color::black]);
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        if (std::popcount(position.type_specific_bitboard[piece_type::king] & position.color_bitboard[color]) != 1)
+            return false;
+    }
+
+    if (turn != "w" && turn != "b") return false;
+    position.whos_turn = turn == "w" ? piece_color::white : piece_color::black;
+
+    position.castling_rights = 0;
+    if (castling != "-") {
+        for (const char symbol : castling) {
+            switch (symbol) {
+                case 'K': position.castling_rights |= castling_right::white_kingside; break;
+                case 'Q': position.castling_rights |= castling_right::white_queenside; break;
+                case 'k': position.castling_rights |= castling_right::black_kingside; break;
+                case 'q': position.castling_rights |= castling_right::black_queenside; break;
+                default: return false;
+            }
+        }
+    }
+    position.castling_rights = castling_rights_on_board(position, position.castling_rights);
+
+    position.enpassant_file = no_enpassant;
+    if (enpassant != "-") {
+        if (enpassant.size() != 2 || enpassant[0] < 'a' || enpassant[0] > 'h') return false;
+        if (enpassant[1] != (position.whos_turn == piece_color::white ? '6' : '3')) return false;
+        position.enpassant_file = enpassant_file_on_board(position, static_cast<uint8_t>(enpassant[0] - 'a'));
+    }
+
+    // A field which is not a number is the first operation of an EPD record. A clock too large to be stored is
+    // long past the point at which the game may be claimed drawn, and so is saturated.
+    unsigned clock = 0;
+    const char* const clock_end = halfmove_clock.data() + halfmove_clock.size();
+    if (std::from_chars(halfmove_clock.data(), clock_end, clock).ptr != clock_end) clock = 0;
+    position.halfmove_clock = static_cast<uint8_t>(std::min(clock, 255u));
+
+    if (position.whos_turn == piece_color::black) hash ^= zobrist_tables.black_to_move;
+    hash ^= zobrist_tables.castling[position.castling_rights];
+    hash ^= zobrist_tables.enpassant[position.enpassant_file];
+    position.hash = hash;
+    position.pawn_hash = pawn_hash;
+    position.piece_square_score = piece_square_score;
+    position.game_phase = game_phase;
+    refresh_accumulator(position);
+    assert(position.hash == compute_zobrist_key(position));
+    assert(position.pawn_hash == compute_pawn_key(position));
+    assert(std::make_pair(position.piece_square_score, position.game_phase) == compute_piece_square_score(position));
+    return true;
+}
+
+/**
+ * The length of the longest FEN string <code>write_fen</code> can produce: a placement field of 64 pieces and 7
+ * separators, the other three fields at their longest, the two move counters and the spaces between.
+ */
+constexpr std::size_t max_fen_length = 71 + 1 + 4 + 2 + 2 + 5 + 5;
+
+/**
+ * <h2>FEN Serializer</h2>
+ * <p>Writes the given position in Forsyth–Edwards Notation into the given buffer, and returns the number of
+ * characters written. No terminator is written, and nothing is allocated.</p>
+ * <p>The position does not track the fullmove number, so it is always written as <code>1</code>.</p>
+ */
+template<typename position_type>
+std::size_t write_fen(const position_type& position, std::span<char, max_fen_length> buffer) {
+    char* out = buffer.data();
+    for (int8_t rank = 7; rank >= 0; --rank) {
+        uint8_t empty_squares = 0;
+        for (uint8_t file = 0; file < 8; ++file) {
+            const uint8_t sindex = coords_to_sindex(rank, file);
+            const piece_type type = position.occupier_type_lookup_table[sindex];
+            if (type == piece_type::none) {
+                ++empty_squares;
+                continue;
+            }
+            if (empty_squares) *out++ = static_cast<char>('0' + empty_squares);
+            empty_squares = 0;
+            const bool is_white = position.color_bitboard[piece_color::white] & sbitboard(sindex);
+            *out++ = fen_piece_symbols[is_white][type];
+        }
+        if (empty_squares) *out++ = static_cast<char>('0' + empty_squares);
+        if (rank) *out++ = '/';
+    }
+    *out++ = ' ';
+    *out++ = position.whos_turn == piece_color::white ? 'w' : 'b';
+    *out++ = ' ';
+    if (position.castling_rights == 0) *out++ = '-';
+    if (position.castling_rights & castling_right::white_kingside) *out++ = 'K';
+    if (position.castling_rights & castling_right::white_queenside) *out++ = 'Q';
+    if (position.castling_rights & castling_right::black_kingside) *out++ = 'k';
+    if (position.castling_rights & castling_right::black_queenside) *out++ = 'q';
+    *out++ = ' ';
+    if (position.enpassant_file == no_enpassant) {
+        *out++ = '-';
+    } else {
+        *out++ = static_cast<char>('a' + position.enpassant_file);
+        *out++ = position.whos_turn == piece_color::white ? '6' : '3';
+    }
+    *out++ = ' ';
+    out = std::to_chars(out, buffer.data() + buffer.size(), position.halfmove_clock).ptr;
+    for (const char symbol : std::string_view(" 1")) *out++ = symbol;
+    return static_cast<std::size_t>(out - buffer.data());
+}
+
+/** Writes the given position in Forsyth–Edwards Notation. */
+template<typename position_type>
+std::string to_fen(const position_type& position) {
+    std::array<char, max_fen_length> buffer;
+    return { buffer.data(), write_fen(position, buffer) };
+}
+
+constexpr std::string_view starting_position_fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
@@ -0,0 +1,235 @@
+#pragma once
+
+/**
+ * <h2>Packed Positions</h2>
+ * <p>The 32 byte position record and the dataset files made of them.</p>
+ */
+
+#include "notation.hpp"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Packed Positions
+
+/**
+ * <h2>Packed Position</h2>
+ * <p>A 32 byte encoding of a position, for datasets of millions of positions which are to be read without parsing.
+ * </p>
+ * <p><code>occupancy</code> marks the occupied squares. <code>pieces</code> holds one 4-bit code per occupied square,
+ * two to a byte, low nibble first, in order of increasing square index. As in <code>fen_symbol_table</code>, a code
+ * packs the color in bit three above the type. The flags are laid out as follows.
+ * <pre>\n
+ * bits | 7..5 4..1      0     \n
+ * v    | ()   (castle) (turn)
+ * \n\n</pre></p>
+ * <p>A record is a plain array of bytes, with no padding and no pointers, so a file of them can be mapped into memory
+ * and read in place.</p>
+ */
+struct packed_position {
+    bitboard occupancy;
+    std::array<uint8_t, 16> pieces;
+    uint8_t flags;
+    uint8_t enpassant_file;
+    uint8_t halfmove_clock;
+    std::array<uint8_t, 5> reserved;
+};
+static_assert(sizeof(packed_position) == 32);
+static_assert(std::is_trivially_copyable_v<packed_position>);
+
+/** Encodes the given position. Returns false if it has more than the 32 pieces a record can hold. */
+template<typename position_type>
+[[nodiscard]] bool pack_position(const position_type& position, packed_position& packed) {
+    packed = {};
+    packed.occupancy = position.color_bitboard[piece_color::white] | position.color_bitboard[piece_color::black];
+    if (std::popcount(packed.occupancy) > 32) return false;
+    uint8_t nibble = 0;
+    for (bitboard remaining = packed.occupancy; remaining; remaining &= remaining - 1, ++nibble) {
+        const uint8_t sindex = std::countr_zero(remaining);
+        const bool is_white = position.color_bitboard[piece_color::white] & sbitboard(sindex);
+        const uint8_t code = is_white << 3 | position.occupier_type_lookup_table[sindex];
+        packed.pieces[nibble >> 1] |= code << ((nibble & 1) * 4);
+    }
+    packed.flags = (position.whos_turn == piece_color::white) | position.castling_rights << 1;
+    packed.enpassant_file = position.enpassant_file;
+    packed.halfmove_clock = position.halfmove_clock;
+    return true;
+}
+
+/**
+ * Resets the given position to the one the given record encodes, like <code>load_fen</code> does for a FEN string,
+ * and in a single pass over the occupied squares. As there, castling rights and an en-passant file which the board
+ * does not bear out are dropped. Returns false if the record is malformed.
+ */
+template<typename position_type>
+[[nodiscard]] bool unpack_position(const packed_position& packed, position_type& position) {
+    if (std::popcount(packed.occupancy) > 32 || packed.enpassant_file > no_enpassant) return false;
+    position.color_bitboard = {};
+    position.color_bitboard_rotated = {};
+    position.type_specific_bitboard = {};
+    position.occupier_type_lookup_table.fill(piece_type::none);
+    while (!position.move_log.empty()) position.move_log.pop();
+    zobrist_key hash = 0;
+    zobrist_key pawn_hash = 0;
+    packed_score piece_square_score = 0;
+    uint8_t game_phase = 0;
+
+    uint8_t nibble = 0;
+    for (bitboard remaining = packed.occupancy; remaining; remaining &= remaining - 1, ++nibble) {
+        const uint8_t sindex = std::countr_zero(remaining);
+        const uint8_t code = (packed.pieces[nibble >> 1] >> ((nibble & 1) * 4)) & 0b1111;
+        const auto color = static_cast<piece_color>(code >> 3);
+        const auto type = static_cast<piece_type>(code & 0b111);
+        if (type >= piece_type::none) return false;
+        position.occupier_type_lookup_table[sindex] = type;
+        position.color_bitboard[color] |= sbitboard(sindex);
+        position.color_bitboard_rotated[color] |= sbitboard(rotate_sindex(sindex));
+        position.type_specific_bitboard[type] |= sbitboard(sindex);
+        hash ^= zobrist_tables.piece[color][type][sindex];
+        if (type == piece_type::pawn) pawn_hash ^= zobrist_tables.piece[color][type][sindex];
+        piece_square_score += piece_square_table[color][type][sindex];
+        game_phase += game_phase_values[type];
+    }
+    position.type_specific_bitboard[piece_type::none] = ~packed.occupancy;
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        if (std::popcount(position.type_specific_bitboard[piece_type::king] & position.color_bitboard[color]) != 1)
+            return false;
+    }
+
+    position.whos_turn = static_cast<piece_color>(packed.flags & 1);
+    position.castling_rights = castling_rights_on_board(position, (packed.flags >> 1) & 0b1111);
+    position.enpassant_file = enpassant_file_on_board(position, packed.enpassant_file);
+    position.halfmove_clock = packed.halfmove_clock;
+    if (position.whos_turn == piece_color::black) hash ^= zobrist_tables.black_to_move;
+    hash ^= zobrist_tables.castling[position.castling_rights];
+    hash ^= zobrist_tables.enpassant[position.enpassant_file];
+    position.hash = hash;
+    position.pawn_hash = pawn_hash;
+    position.piece_square_score = piece_square_score;
+    position.game_phase = game_phase;
+    refresh_accumulator(position);
+    assert(position.hash == compute_zobrist_key(position));
+    return true;
+}
+
+/**
+ * The header of a dataset file of packed positions, which is followed immediately by the records. It is padded to
+ * the size of a record, so that the records stay aligned when the file is mapped.
+ */
+struct packed_dataset_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint64_t record_count;
+    std::uint64_t reserved;
+};
+static_assert(sizeof(packed_dataset_header) == sizeof(packed_position));
+
+constexpr std::array<char, 8> packed_dataset_magic = { 'S', 'C', 'C', 'P', 'O', 'S', '\0', '\0' };
+constexpr std::uint32_t packed_dataset_version = 1;
+
+/**
+ * <h2>Packed Dataset Reader</h2>
+ * <p>Maps a dataset file of packed positions into memory read-only, and exposes its records as a span, so that they
+ * are read in place rather than copied. The operating system pages the file in on demand, and the reader advises it
+ * that the file will be read sequentially.</p>
+ */
+class packed_dataset_reader {
+    private:
+        void* mapping = nullptr;
+        std::size_t mapping_size = 0;
+        std::span<const packed_position> records;
+    public:
+        /** Maps the given file. If it cannot be mapped, or is not a dataset, <code>is_open</code> returns false. */
+        explicit packed_dataset_reader(const std::string& path) {
+            const int descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0) return;
+            struct stat status {};
+            if (::fstat(descriptor, &status) == 0 && static_cast<std::size_t>(status.st_size) >= sizeof(packed_position)) {
+                mapping_size = static_cast<std::size_t>(status.st_size);
+                mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapping == MAP_FAILED) mapping = nullptr;
+            }
+            ::close(descriptor);
+            if (!mapping) return;
+            ::madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+            const auto* header = static_cast<const packed_dataset_header*>(mapping);
+            const std::size_t capacity = mapping_size / sizeof(packed_position) - 1;
+            if (header->magic != packed_dataset_magic || header->version != packed_dataset_version
+                || header->record_size != sizeof(packed_position) || header->record_count > capacity) {
+                return;
+            }
+            records = { reinterpret_cast<const packed_position*>(header + 1), header->record_count };
+        }
+
+        packed_dataset_reader(const packed_dataset_reader&) = delete;
+        packed_dataset_reader& operator=(const packed_dataset_reader&) = delete;
+
+        ~packed_dataset_reader() {
+            if (mapping) ::munmap(mapping, mapping_size);
+        }
+
+        [[nodiscard]] bool is_open() const { return records.data() != nullptr; }
+
+        [[nodiscard]] std::span<const packed_position> positions() const { return records; }
+};
+
+/** Returns true if the given file begins with the header of a dataset of packed positions. */
+[[nodiscard]] inline bool is_packed_dataset(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, 8> magic {};
+    return file.read(magic.data(), magic.size()) && magic == packed_dataset_magic;
+}
+
+/**
+ * <h2>Packed Dataset Writer</h2>
+ * <p>Appends packed positions to a new dataset file through a buffered stream. The record count in the header is
+ * written when the writer is closed, so a dataset whose writer was never closed is rejected by the reader.</p>
+ */
+class packed_dataset_writer {
+    private:
+        std::ofstream file;
+        std::uint64_t record_count = 0;
+    public:
+        explicit packed_dataset_writer(const std::string& path) : file(path, std::ios::binary | std::ios::trunc) {
+            const packed_dataset_header header {};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+
+        ~packed_dataset_writer() { close(); }
+
+        [[nodiscard]] bool is_open() const { return file.is_open() && file.good(); }
+
+        void write(const packed_position& packed) {
+            file.write(reinterpret_cast<const char*>(&packed), sizeof(packed));
+            ++record_count;
+        }
+
+        /** Completes the header. Returns false if any write failed. */
+        bool close() {
+            if (!file.is_open()) return true;
+            const packed_dataset_header header {
+                .magic = packed_dataset_magic,
+                .version = packed_dataset_version,
+                .record_size = sizeof(packed_position),
+                .record_count = record_count,
+                .reserved = 0
+            };
+            file.seekp(0);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            const bool succeeded = file.good();
+            file.close();
+            return succeeded;
+        }
+};
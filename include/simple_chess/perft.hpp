@@ -0,0 +1,540 @@
+#pragma once
+
+/**
+ * <h2>Perft</h2>
+ * <p>Sequential and parallel perft, and the perft suite.</p>
+ */
+
+#include "compact_position.hpp"
+#include "notation.hpp"
+#include "transposition_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stack>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Perft
+
+/**
+ * <h2>Perft Table</h2>
+ * <p>A hash table of subtree leaf counts keyed by Zobrist key and depth, so that perft counts each transposition
+ * once. It reuses the buckets of the transposition table, and so is likewise safe to share between threads without
+ * locks. The data word of each entry is laid out as follows.
+ * <pre>\n
+ * bits | 63..8   7..0 \n
+ * v    | (nodes) (dpth)
+ * \n\n</pre></p>
+ * <p>A depth of zero marks a vacant entry, which is why subtrees of depth zero are never stored. Subtrees of depth one
+ * are not worth storing either, since bulk counting costs no more than the probe. When a bucket is full the shallowest
+ * entry is evicted, since it saves the least work.</p>
+ */
+class perft_table {
+    private:
+        std::size_t bucket_count = 0;
+        std::unique_ptr<tt_bucket[]> buckets;
+
+        [[nodiscard]] tt_bucket& bucket_of(const zobrist_key key) const {
+            const auto index = static_cast<std::size_t>((static_cast<unsigned __int128>(key) * bucket_count) >> 64);
+            return buckets[index];
+        }
+    public:
+        explicit perft_table(const std::size_t megabytes)
+            : bucket_count(std::max<std::size_t>(1, megabytes * 1024 * 1024 / sizeof(tt_bucket))),
+              buckets(std::make_unique<tt_bucket[]>(bucket_count)) {}
+
+        /** Looks up the leaf count of the subtree of the given depth. Returns true and fills <code>nodes</code> if so. */
+        [[nodiscard]] bool probe(const zobrist_key key, const unsigned depth, std::uint64_t& nodes) const {
+            for (const tt_entry& entry : bucket_of(key).entries) {
+                const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+                const std::uint64_t key_xor_data = entry.key_xor_data.load(std::memory_order_relaxed);
+                if ((key_xor_data ^ data) != key || (data & 0xFF) != depth) continue;
+                nodes = data >> 8;
+                return true;
+            }
+            return false;
+        }
+
+        void store(const zobrist_key key, const unsigned depth, const std::uint64_t nodes) {
+            tt_entry* victim = nullptr;
+            std::uint64_t victim_depth = std::numeric_limits<std::uint64_t>::max();
+            for (tt_entry& entry : bucket_of(key).entries) {
+                const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+                if ((data & 0xFF) < victim_depth) {
+                    victim = &entry;
+                    victim_depth = data & 0xFF;
+                }
+            }
+            const std::uint64_t data = nodes << 8 | depth;
+            victim->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+            victim->data.store(data, std::memory_order_relaxed);
+        }
+};
+
+/**
+ * <h2>Performance Test</h2>
+ * <p>Counts the leaf nodes of the legal move tree of the given depth rooted at the given position. The position is
+ * restored before this function returns.</p>
+ * <p>Only legal moves are generated, so the leaves need not be visited at all. With <code>bulk_counting</code>, the
+ * count beneath a node of depth one is simply the number of moves generated there. Without it, every leaf is played
+ * out with <code>make_move</code> and <code>unmake_move</code>, which measures them rather than move generation.</p>
+ * <p>When a <code>perft_table</code> is given, the count of each subtree of depth two or more is looked up before its
+ * moves are even generated, and recorded after it is searched.</p>
+ * <p>The color of each ply is a template argument, so that move generation, <code>make_move</code> and
+ * <code>unmake_move</code> are all specialized for the mover. Each ply recurses into the instantiation of the
+ * opponent, so the color is dispatched just once, at the root.</p>
+ */
+template<piece_color us, bool bulk_counting = true, typename position_type>
+std::uint64_t perft(position_type& position, const unsigned depth, perft_table* const table = nullptr) {
+    if (depth == 0) return 1;
+    std::uint64_t nodes = 0;
+    if (table && depth >= 2 && table->probe(position.hash, depth, nodes)) return nodes;
+    move_buffer moves;
+    generate_legal_moves<us>(position, moves);
+    if (bulk_counting && depth == 1) return moves.size;
+    for (const bitmove move : moves) {
+        make_move<us>(move, position);
+        nodes += perft<!us, bulk_counting>(position, depth - 1, table);
+        unmake_move<us>(position);
+    }
+    if (table && depth >= 2) table->store(position.hash, depth, nodes);
+    return nodes;
+}
+
+template<typename position_type>
+std::uint64_t perft(position_type& position, const unsigned depth, perft_table* const table = nullptr) {
+    return position.whos_turn == piece_color::white ? perft<piece_color::white>(position, depth, table)
+                                                    : perft<piece_color::black>(position, depth, table);
+}
+
+/**
+ * As <code>perft</code>, but with copy-make over the compact positions of a <code>compact_position_stack</code>. The
+ * position to count is <code>stack[ply]</code>, and each child is written to <code>stack[ply + 1]</code>.
+ */
+template<piece_color us, bool bulk_counting = true>
+std::uint64_t perft_copy_make(compact_position_stack& stack, const std::size_t ply, const unsigned depth) {
+    if (depth == 0) return 1;
+    assert(ply + 1 < stack.size());
+    move_buffer moves;
+    generate_legal_moves<us>(stack[ply], moves);
+    if (bulk_counting && depth == 1) return moves.size;
+    std::uint64_t nodes = 0;
+    for (const bitmove move : moves) {
+        copy_make_move<us>(move, stack[ply], stack[ply + 1]);
+        nodes += perft_copy_make<!us, bulk_counting>(stack, ply + 1, depth - 1);
+    }
+    return nodes;
+}
+
+/**
+ * As <code>perft</code>, but establishing legality by making each pseudo-legal move and testing whether the mover's
+ * king is left in check. This exists to cross-check the legal move generator and to measure its benefit.
+ */
+template<piece_color us, typename position_type>
+std::uint64_t perft_pseudo_legal(position_type& position, const unsigned depth) {
+    if (depth == 0) return 1;
+    move_buffer moves;
+    generate_pseudo_legal_moves<us>(position, moves);
+    std::uint64_t nodes = 0;
+    for (const bitmove move : moves) {
+        make_move<us>(move, position);
+        if (!is_king_attacked(position, us)) nodes += perft_pseudo_legal<!us>(position, depth - 1);
+        unmake_move<us>(position);
+    }
+    return nodes;
+}
+
+/**
+ * As <code>perft_pseudo_legal</code>, but reading the color of the mover from the position at every call. This
+ * exists only to measure the benefit of specializing on color.
+ */
+template<typename position_type>
+std::uint64_t perft_with_runtime_color(position_type& position, const unsigned depth) {
+    if (depth == 0) return 1;
+    move_buffer moves;
+    generate_pseudo_legal_moves(position, moves);
+    std::uint64_t nodes = 0;
+    for (const bitmove move : moves) {
+        make_move(move, position);
+        if (!is_king_attacked(position, !position.whos_turn)) nodes += perft_with_runtime_color(position, depth - 1);
+        unmake_move(position);
+    }
+    return nodes;
+}
+
+/** Measures the wall-clock time taken to evaluate the given callable, in seconds. */
+template<typename F>
+double time_seconds(F&& f) {
+    const auto begin = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+[[nodiscard]] inline std::uint64_t nodes_per_second(const std::uint64_t nodes, const double seconds) {
+    return seconds > 0 ? static_cast<std::uint64_t>(static_cast<double>(nodes) / seconds) : 0;
+}
+
+/** Prints the leaf node count of the subtree beneath each root move, followed by the total and the throughput. */
+template<typename position_type>
+std::uint64_t perft_divide(position_type& position, const unsigned depth, perft_table* const table = nullptr) {
+    move_buffer moves;
+    generate_legal_moves(position, moves);
+    std::uint64_t total = 0;
+    const double seconds = time_seconds([&] {
+        for (const bitmove move : moves) {
+            make_move(move, position);
+            const std::uint64_t nodes = depth > 0 ? perft(position, depth - 1, table) : 1;
+            std::cout << to_long_algebraic(move) << ": " << nodes << "\n";
+            total += nodes;
+            unmake_move(position);
+        }
+    });
+    std::cout << "\nNodes searched: " << total << "\n";
+    std::cout << "Time: " << std::fixed << std::setprecision(3) << seconds << "s\n";
+    std::cout << "Nodes/second: " << nodes_per_second(total, seconds) << std::endl;
+    return total;
+}
+
+// Parallel Perft
+
+/** A subtree to be counted, identified by the one or two moves leading to it from the root. */
+struct perft_task {
+    std::array<bitmove, 2> moves;
+    uint8_t move_count;
+
+    /** The index of the root move this subtree lies beneath, to which its count is credited. */
+    uint16_t root_index;
+};
+
+/**
+ * The tasks owned by one thread. The owner pushes and pops at the back, so that it finishes the subtrees it split
+ * most recently while they are still in cache. Thieves steal from the front, where the largest tasks remain.
+ */
+struct alignas(64) perft_task_deque {
+    std::mutex mutex;
+    std::deque<perft_task> tasks;
+};
+
+/** The throughput of a single thread of a parallel perft, padded so that the threads never share a cache line. */
+struct alignas(64) perft_thread_statistics {
+    std::uint64_t nodes = 0;
+    double busy_seconds = 0;
+    unsigned tasks = 0;
+    unsigned steals = 0;
+};
+
+struct parallel_perft_result {
+    /** The legal moves of the root, in the order in which they were generated. */
+    std::vector<bitmove> root_moves;
+
+    /** The leaf count beneath each move of <code>root_moves</code>. */
+    std::vector<std::uint64_t> root_nodes;
+
+    std::uint64_t total_nodes = 0;
+    double seconds = 0;
+    std::vector<perft_thread_statistics> threads;
+};
+
+/**
+ * <h2>Parallel Perft</h2>
+ * <p>Counts the leaf nodes of the legal move tree of the given depth with the given number of threads, each of which
+ * counts subtrees on its own copy of the root position. The depth must be at least one. The count is exactly that of
+ * <code>perft</code>.</p>
+ * <p>Each root move begins as a task, dealt out to the threads in turn. A thread taking a root task of depth three or
+ * more does not count it, but splits it into one task per reply, so that the subtrees at ply two become the unit of
+ * work. A thread which runs out of tasks steals from the others, so that a single root move whose subtree dwarfs the
+ * rest is shared out among every thread rather than left to the one it was dealt to.</p>
+ * <p>The threads finish when no task remains outstanding. A task is outstanding until it is counted, so a thread
+ * finding every deque empty while another is still splitting waits for the new tasks rather than leaving.</p>
+ */
+template<typename position_type>
+parallel_perft_result parallel_perft(const position_type& root, const unsigned depth, const unsigned thread_count,
+                                     perft_table* const table = nullptr) {
+    parallel_perft_result result;
+    position_type root_position = root;
+    move_buffer moves;
+    generate_legal_moves(root_position, moves);
+    result.root_moves.assign(moves.begin(), moves.end());
+    result.threads.resize(thread_count);
+
+    std::vector<std::atomic<std::uint64_t>> root_nodes(result.root_moves.size());
+    std::vector<perft_task_deque> deques(thread_count);
+    std::atomic<std::size_t> outstanding = result.root_moves.size();
+    for (std::size_t i = 0; i < result.root_moves.size(); ++i) {
+        deques[i % thread_count].tasks.push_back(perft_task {
+            .moves = { result.root_moves[i], bitmove::null() },
+            .move_count = 1,
+            .root_index = static_cast<uint16_t>(i)
+        });
+    }
+
+    const auto take_task = [&](const unsigned id, perft_task& task) {
+        {
+            std::lock_guard lock(deques[id].mutex);
+            if (!deques[id].tasks.empty()) {
+                task = deques[id].tasks.back();
+                deques[id].tasks.pop_back();
+                return true;
+            }
+        }
+        for (unsigned offset = 1; offset < thread_count; ++offset) {
+            perft_task_deque& victim = deques[(id + offset) % thread_count];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                ++result.threads[id].steals;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const auto run_worker = [&](const unsigned id) {
+        position_type position = root;
+        perft_thread_statistics& statistics = result.threads[id];
+        while (outstanding.load(std::memory_order_acquire) > 0) {
+            perft_task task;
+            if (!take_task(id, task)) {
+                std::this_thread::yield();
+                continue;
+            }
+            statistics.busy_seconds += time_seconds([&] {
+                for (uint8_t i = 0; i < task.move_count; ++i) make_move(task.moves[i], position);
+                const unsigned remaining = depth - task.move_count;
+                if (task.move_count == 1 && remaining >= 2) {
+                    move_buffer replies;
+                    generate_legal_moves(position, replies);
+                    std::lock_guard lock(deques[id].mutex);
+                    for (const bitmove reply : replies) {
+                        deques[id].tasks.push_back(perft_task {
+                            .moves = { task.moves[0], reply },
+                            .move_count = 2,
+                            .root_index = task.root_index
+                        });
+                    }
+                    outstanding.fetch_add(replies.size, std::memory_order_relaxed);
+                } else {
+                    const std::uint64_t nodes = perft(position, remaining, table);
+                    root_nodes[task.root_index].fetch_add(nodes, std::memory_order_relaxed);
+                    statistics.nodes += nodes;
+                    ++statistics.tasks;
+                }
+                for (uint8_t i = 0; i < task.move_count; ++i) unmake_move(position);
+            });
+            outstanding.fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    result.seconds = time_seconds([&] {
+        std::vector<std::thread> helper_threads;
+        for (unsigned id = 1; id < thread_count; ++id) helper_threads.emplace_back(run_worker, id);
+        run_worker(0);
+        for (std::thread& thread : helper_threads) thread.join();
+    });
+    for (const std::atomic<std::uint64_t>& nodes : root_nodes) {
+        result.root_nodes.push_back(nodes.load());
+        result.total_nodes += result.root_nodes.back();
+    }
+    return result;
+}
+
+/**
+ * As <code>perft_divide</code>, but counting with <code>parallel_perft</code>, and also printing the throughput of
+ * each thread.
+ */
+template<typename position_type>
+std::uint64_t parallel_perft_divide(const position_type& position, const unsigned depth, const unsigned thread_count,
+                                    perft_table* const table = nullptr) {
+    const parallel_perft_result result = parallel_perft(position, std::max(1u, depth), thread_count, table);
+    for (std::size_t i = 0; i < result.root_moves.size(); ++i) {
+        std::cout << to_long_algebraic(result.root_moves[i]) << ": " << result.root_nodes[i] << "\n";
+    }
+    std::cout << "\nNodes searched: " << result.total_nodes << "\n";
+    std::cout << "Time: " << std::fixed << std::setprecision(3) << result.seconds << "s\n";
+    std::cout << "Nodes/second: " << nodes_per_second(result.total_nodes, result.seconds) << "\n\n";
+    for (std::size_t id = 0; id < result.threads.size(); ++id) {
+        const perft_thread_statistics& statistics = result.threads[id];
+        std::cout << "thread " << std::setw(2) << id << ": " << std::setw(12) << statistics.nodes << " nodes "
+                  << std::setw(6) << statistics.tasks << " tasks " << std::setw(4) << statistics.steals << " steals "
+                  << std::setw(11) << nodes_per_second(statistics.nodes, statistics.busy_seconds) << " nps\n";
+    }
+    std::cout << std::flush;
+    return result.total_nodes;
+}
+
+struct perft_suite_entry {
+    std::string_view name;
+    std::string_view fen;
+
+    /** The expected leaf node counts, indexed by depth - 1. A count of zero means the count is not known. */
+    std::array<std::uint64_t, 8> expected_nodes;
+
+    /** The deepest depth which is run when the suite is run without an explicit depth. */
+    unsigned default_depth;
+};
+
+/** The standard perft positions, as published on the Chess Programming Wiki, with their known node counts. */
+constexpr std::array<perft_suite_entry, 5> perft_suite = {{
+    { "initial", starting_position_fen,
+      { 20, 400, 8902, 197281, 4865609, 119060324, 3195901860, 84998978956 }, 5 },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      { 48, 2039, 97862, 4085603, 193690690, 8031647685, 374190009323, 0 }, 4 },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      { 14, 191, 2812, 43238, 674624, 11030083, 178633661, 3009794393 }, 6 },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      { 6, 264, 9467, 422333, 15833292, 706045033, 0, 0 }, 4 },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      { 44, 1486, 62379, 2103487, 89941194, 0, 0, 0 }, 4 },
+}};
+
+/** The perft implementations the suite can be run with. */
+enum class perft_variant {
+    /** <code>perft</code>, generating legal moves only and counting the moves at depth one in bulk. */
+    bulk_counting,
+
+    /** <code>perft</code>, generating legal moves only and playing out every leaf. */
+    legal,
+
+    /** <code>perft_pseudo_legal</code>, filtering pseudo-legal moves by making them. */
+    pseudo_legal,
+
+    /** <code>perft_with_runtime_color</code>, filtering pseudo-legal moves and not specialized on color. */
+    runtime_color,
+
+    /** <code>perft_copy_make</code>, counting the moves at depth one in bulk. */
+    copy_make_bulk_counting,
+
+    /** <code>perft_copy_make</code>, playing out every leaf. */
+    copy_make_legal
+};
+
+/** Counts the leaf nodes of the given depth using the given implementation of perft. */
+template<typename position_type>
+std::uint64_t run_perft_variant(position_type& position, const unsigned depth, const perft_variant variant,
+                                perft_table* const table) {
+    switch (variant) {
+        case perft_variant::bulk_counting:
+            return perft(position, depth, table);
+        case perft_variant::legal:
+            return position.whos_turn == piece_color::white
+                   ? perft<piece_color::white, false>(position, depth, table)
+                   : perft<piece_color::black, false>(position, depth, table);
+        case perft_variant::pseudo_legal:
+            return position.whos_turn == piece_color::white
+                   ? perft_pseudo_legal<piece_color::white>(position, depth)
+                   : perft_pseudo_legal<piece_color::black>(position, depth);
+        case perft_variant::runtime_color:
+            return perft_with_runtime_color(position, depth);
+        case perft_variant::copy_make_bulk_counting:
+        case perft_variant::copy_make_legal: {
+            if (depth + 1 > compact_position_stack_capacity) return 0;
+            alignas(64) compact_position_stack stack;
+            stack[0] = to_compact_position(position);
+            const bool bulk_counting = variant == perft_variant::copy_make_bulk_counting;
+            if (position.whos_turn == piece_color::white) {
+                return bulk_counting ? perft_copy_make<piece_color::white, true>(stack, 0, depth)
+                                     : perft_copy_make<piece_color::white, false>(stack, 0, depth);
+            }
+            return bulk_counting ? perft_copy_make<piece_color::black, true>(stack, 0, depth)
+                                 : perft_copy_make<piece_color::black, false>(stack, 0, depth);
+        }
+    }
+    return 0;
+}
+
+struct perft_suite_result {
+    bool all_passed = true;
+    std::uint64_t total_nodes = 0;
+    double total_seconds = 0;
+};
+
+/**
+ * Runs every position of the perft suite to its default depth, or to the given depth if it is non-zero, verifying
+ * the node counts against the known values. The table, if any, is only consulted by the variants of
+ * <code>perft</code> itself. More than one thread runs <code>parallel_perft</code> instead, whatever the variant.
+ */
+template<typename position_type>
+perft_suite_result run_perft_suite(const unsigned depth_override,
+                                   const perft_variant variant = perft_variant::bulk_counting,
+                                   perft_table* const table = nullptr, const unsigned thread_count = 1) {
+    perft_suite_result result;
+    for (const perft_suite_entry& entry : perft_suite) {
+        const unsigned depth = std::min<unsigned>(depth_override ? depth_override : entry.default_depth,
+                                                  entry.expected_nodes.size());
+        const std::uint64_t expected = entry.expected_nodes[depth - 1];
+        if (expected == 0) continue;
+        position_type position;
+        if (!load_fen(entry.fen, position)) {
+            std::cout << entry.name << ": malformed FEN\n";
+            result.all_passed = false;
+            continue;
+        }
+        std::uint64_t nodes = 0;
+        const double seconds = time_seconds([&] {
+            nodes = thread_count > 1 ? parallel_perft(position, depth, thread_count, table).total_nodes
+                                     : run_perft_variant(position, depth, variant, table);
+        });
+        const bool passed = nodes == expected;
+        result.all_passed &= passed;
+        result.total_nodes += nodes;
+        result.total_seconds += seconds;
+        std::cout << std::left << std::setw(10) << entry.name << " depth " << depth << "  " << std::right
+                  << std::setw(12) << nodes << (passed ? "  ok   " : "  FAIL ") << std::setw(11)
+                  << nodes_per_second(nodes, seconds) << " nps";
+        if (!passed) std::cout << "  (expected " << expected << ")";
+        std::cout << "\n";
+    }
+    std::cout << "\nTotal nodes: " << result.total_nodes << "\n";
+    std::cout << "Nodes/second: " << nodes_per_second(result.total_nodes, result.total_seconds) << "\n";
+    std::cout << (result.all_passed ? "All perft counts match." : "Perft count mismatch!") << std::endl;
+    return result;
+}
+
+/** Runs the perft suite once per move log layout and compares their throughput. */
+inline bool compare_move_log_layouts(const unsigned depth_override) {
+    std::cout << "== std::stack move log (chess_position) ==\n";
+    const perft_suite_result stack_result = run_perft_suite<chess_position>(depth_override);
+    std::cout << "\n== ply-indexed array move log (flat_chess_position) ==\n";
+    const perft_suite_result flat_result = run_perft_suite<flat_chess_position>(depth_override);
+    const std::uint64_t stack_nps = nodes_per_second(stack_result.total_nodes, stack_result.total_seconds);
+    const std::uint64_t flat_nps = nodes_per_second(flat_result.total_nodes, flat_result.total_seconds);
+    std::cout << "\nstack: " << stack_nps << " nps, flat: " << flat_nps << " nps, speedup " << std::setprecision(3)
+              << (stack_nps ? static_cast<double>(flat_nps) / static_cast<double>(stack_nps) : 0.0) << "x"
+              << std::endl;
+    return stack_result.all_passed && flat_result.all_passed;
+}
+
+/**
+ * Runs the perft suite with each of two implementations of perft and compares their throughput, reporting how much
+ * faster the second is than the first.
+ */
+inline bool compare_perft_variants(const unsigned depth_override, const std::string_view baseline_name,
+                                   const perft_variant baseline, const std::string_view candidate_name,
+                                   const perft_variant candidate) {
+    std::cout << "== " << baseline_name << " ==\n";
+    const perft_suite_result baseline_result = run_perft_suite<flat_chess_position>(depth_override, baseline);
+    std::cout << "\n== " << candidate_name << " ==\n";
+    const perft_suite_result candidate_result = run_perft_suite<flat_chess_position>(depth_override, candidate);
+    const std::uint64_t baseline_nps = nodes_per_second(baseline_result.total_nodes, baseline_result.total_seconds);
+    const std::uint64_t candidate_nps = nodes_per_second(candidate_result.total_nodes,
+                                                         candidate_result.total_seconds);
+    std::cout << "\n" << baseline_name << ": " << baseline_nps << " nps, " << candidate_name << ": " << candidate_nps
+              << " nps, speedup " << std::setprecision(3)
+              << (baseline_nps ? static_cast<double>(candidate_nps) / static_cast<double>(baseline_nps) : 0.0) << "x"
+              << std::endl;
+    return baseline_result.all_passed && candidate_result.all_passed;
+}
@@ -0,0 +1,801 @@
+#pragma once
+
+/**
+ * <h2>Position</h2>
+ * <p>The position, its undo log, Zobrist hashing, the piece-square tables, and <code>make_move</code> and
+ * <code>unmake_move</code>.</p>
+ */
+
+#include "board.hpp"
+#include "instrumentation.hpp"
+#include "nnue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <stack>
+#include <type_traits>
+#include <utility>
+
+/**
+ * <p>The castling privileges which are still available to each player. A privilege is lost permanently once the king
+ * or the rook involved has moved, or once the rook has been captured on its home square.</p>
+ * <p>Castling privileges are stored as a four bit set, one bit per (color, side) pair.</p>
+ */
+enum castling_right: uint8_t {
+    white_kingside = 0b0001,
+    white_queenside = 0b0010,
+    black_kingside = 0b0100,
+    black_queenside = 0b1000
+};
+
+/** The value stored in <code>chess_position::enpassant_file</code> when no en-passant capture is available. */
+constexpr uint8_t no_enpassant = 8;
+
+struct reversible_move {
+    uint8_t origin;
+    uint8_t destination;
+    uint8_t target;
+    piece_type captured_piece_type;
+    bool is_promotion;
+
+    /** The castling privileges which were available immediately before this move was made. */
+    uint8_t castling_rights;
+
+    /** The en-passant file which was available immediately before this move was made. */
+    uint8_t enpassant_file;
+
+    /** The Zobrist key of the position immediately before this move was made. */
+    std::uint64_t hash;
+
+    /** The pawn key of the position immediately before this move was made. */
+    std::uint64_t pawn_hash;
+
+    /** The piece-square score of the position immediately before this move was made. */
+    int32_t piece_square_score;
+
+    /** The game phase of the position immediately before this move was made. */
+    uint8_t game_phase;
+
+    /** The halfmove clock of the position immediately before this move was made. */
+    uint8_t halfmove_clock;
+};
+
+consteval auto generate_target_lookup_table() {
+    std::array<uint8_t, 8 /* files */ * 2 /* colors */ + 64 /* identity targets */> table {};
+    for (uint8_t file = 0; file < 8; file++) {
+        table[8 * piece_color::white + file] = coords_to_sindex(4, file);
+        table[8 * piece_color::black + file] = coords_to_sindex(3, file);
+    }
+    for (uint8_t i = 0; i < 64; i++) table[16 + i] = i;
+    return table;
+}
+inline constinit auto target_lookup_table = generate_target_lookup_table();
+
+/**
+ * <h2>Target Square Calculation Function</h2>
+ * <p>This function calculates the <b>target square</b> of the given move and returns its index.</p>
+ * <p>For <b>capturing moves</b>, the <b>target square</b> is the square containing the piece which is captured once the
+ * move is made.</p>
+ * <p>For <b>non-capture moves</b>, the <b>target square</b> is equivalent to the <b>destination square</b>.</p>
+ * <p>In traditional chess, the only <b>capturing move</b> where the <b>target square</b> differs from the <b>destination
+ * square</b> is enpassant pawn capture.</p>
+ * <h3>Assumptions</h3>
+ * <p>This function assumes that the given input move is legal. Specifically, it assumes that if a pawn is switching
+ * files, and there is no piece on the destination square, then the move is valid enpassant capture, regardless
+ * of the origin and destination ranks. If a non-legal move is given as input, the return value is undefined.</p>
+ */
+inline uint8_t lookup_target(std::uint8_t origin, std::uint8_t destination, piece_type moved_piece_type,
+                             piece_type destination_occupant_type, piece_color aggressor_color) {
+    const bool is_enpassant = (moved_piece_type == piece_type::pawn) & ((origin & 0b111) != (destination & 0b111))
+                              & (destination_occupant_type == piece_type::none);
+    const uint8_t file = destination & 0b111;
+    const uint8_t key = ((8 * aggressor_color + file) * is_enpassant) + (!is_enpassant * (16 + destination));
+    return target_lookup_table[key];
+}
+
+/**
+ * A table indexed by square which contains the castling privileges that survive a move touching the square.
+ * Making a move clears every privilege whose king or rook home square is the origin or the destination of the move.
+ */
+consteval std::array<uint8_t, 64> generate_castling_rights_mask_table() {
+    std::array<uint8_t, 64> table {};
+    table.fill(0b1111);
+    table[coords_to_sindex(0, 4)] &= ~(castling_right::white_kingside | castling_right::white_queenside);
+    table[coords_to_sindex(0, 7)] &= ~castling_right::white_kingside;
+    table[coords_to_sindex(0, 0)] &= ~castling_right::white_queenside;
+    table[coords_to_sindex(7, 4)] &= ~(castling_right::black_kingside | castling_right::black_queenside);
+    table[coords_to_sindex(7, 7)] &= ~castling_right::black_kingside;
+    table[coords_to_sindex(7, 0)] &= ~castling_right::black_queenside;
+    return table;
+}
+inline constinit std::array<uint8_t, 64> castling_rights_mask_table = generate_castling_rights_mask_table();
+
+/**
+ * <p>The board as read by move generation and hashing. Position layouts which do not store these bitboards, such as
+ * <code>compact_chess_position</code>, overload these accessors to compute them instead.</p>
+ * <p>The bitboards of each color, indexed by <code>piece_color</code>.</p>
+ */
+template<typename position_type>
+[[nodiscard]] const std::array<bitboard, 2>& color_bitboards(const position_type& position) {
+    return position.color_bitboard;
+}
+
+/** The bitboards of each piece type of both colors, indexed by <code>piece_type</code>. See above. */
+template<typename position_type>
+[[nodiscard]] const std::array<bitboard, 7>& piece_bitboards(const position_type& position) {
+    return position.type_specific_bitboard;
+}
+
+/** The type of the piece on the given square, or <code>piece_type::none</code>. See above. */
+template<typename position_type>
+[[nodiscard]] piece_type piece_type_on(const position_type& position, const uint8_t sindex) {
+    return position.occupier_type_lookup_table[sindex];
+}
+
+// Zobrist Hashing
+
+/**
+ * <p>A 64-bit key which identifies a position with high probability. It is the XOR of one random number per
+ * (color, piece type, square) triple occupied on the board, plus random numbers describing the side to move, the
+ * castling privileges, and the en-passant file.</p>
+ * <p>Because XOR is its own inverse, the key is maintained incrementally: <code>make_move</code> toggles the numbers of
+ * only the squares and state which change.</p>
+ */
+using zobrist_key = std::uint64_t;
+
+struct zobrist_table_set {
+    /**
+     * Indexed by color, piece type and square. The entries of <code>piece_type::none</code> are zero, so that making
+     * a non-capturing move may toggle the "captured" piece without branching.
+     */
+    std::array<std::array<std::array<zobrist_key, 64>, 7>, 2> piece;
+
+    /** Toggled when black is to move. */
+    zobrist_key black_to_move;
+
+    /** Indexed by the full set of castling privileges, rather than by each privilege individually. */
+    std::array<zobrist_key, 16> castling;
+
+    /** Indexed by en-passant file. The entry of <code>no_enpassant</code> is zero. */
+    std::array<zobrist_key, 9> enpassant;
+};
+
+/** A step of the SplitMix64 generator, which is simple enough to run during constant evaluation. */
+[[nodiscard]] constexpr std::uint64_t splitmix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+consteval zobrist_table_set generate_zobrist_tables() {
+    zobrist_table_set tables {};
+    std::uint64_t state = 0x5EED5EED5EED5EED;
+    for (auto& color : tables.piece) {
+        for (uint8_t type = piece_type::rook; type < piece_type::none; ++type) {
+            for (zobrist_key& key : color[type]) key = splitmix64(state);
+        }
+    }
+    tables.black_to_move = splitmix64(state);
+    for (zobrist_key& key : tables.castling) key = splitmix64(state);
+    for (uint8_t file = 0; file < 8; ++file) tables.enpassant[file] = splitmix64(state);
+    return tables;
+}
+
+inline constinit zobrist_table_set zobrist_tables = generate_zobrist_tables();
+
+/**
+ * Computes the Zobrist key of the given position from scratch, by visiting every square. This is far too slow for the
+ * search, which relies on the key maintained by <code>make_move</code>, but serves to initialize and to verify it.
+ */
+template<typename position_type>
+[[nodiscard]] zobrist_key compute_zobrist_key(const position_type& position) {
+    zobrist_key key = 0;
+    for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+        const piece_type type = piece_type_on(position, sindex);
+        const piece_color color = (color_bitboards(position)[piece_color::white] & sbitboard(sindex))
+                                  ? piece_color::white : piece_color::black;
+        key ^= zobrist_tables.piece[color][type][sindex];
+    }
+    if (position.whos_turn == piece_color::black) key ^= zobrist_tables.black_to_move;
+    key ^= zobrist_tables.castling[position.castling_rights];
+    key ^= zobrist_tables.enpassant[position.enpassant_file];
+    return key;
+}
+
+/**
+ * Computes the pawn key of the given position from scratch. It is the XOR of the Zobrist keys of the pawns of both
+ * colors, so it depends on nothing but the placement of the pawns, and a position without pawns has the key zero.
+ */
+template<typename position_type>
+[[nodiscard]] zobrist_key compute_pawn_key(const position_type& position) {
+    zobrist_key key = 0;
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        const bitboard pawns = piece_bitboards(position)[piece_type::pawn] & color_bitboards(position)[color];
+        for (bitboard remaining = pawns; remaining; remaining &= remaining - 1) {
+            key ^= zobrist_tables.piece[color][piece_type::pawn][std::countr_zero(remaining)];
+        }
+    }
+    return key;
+}
+
+// Piece-Square Tables
+
+/**
+ * <p>A midgame and an endgame score packed into a single 32-bit integer, so that both are updated with one addition.
+ * The endgame score occupies the upper half and the midgame score the lower half, the latter borrowing from the
+ * former when negative. <code>midgame_of</code> and <code>endgame_of</code> undo the packing.</p>
+ */
+using packed_score = int32_t;
+
+[[nodiscard]] constexpr packed_score pack_score(const int midgame, const int endgame) {
+    return static_cast<packed_score>(static_cast<uint32_t>(endgame) << 16) + midgame;
+}
+
+[[nodiscard]] constexpr int midgame_of(const packed_score score) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint32_t>(score)));
+}
+
+[[nodiscard]] constexpr int endgame_of(const packed_score score) {
+    return static_cast<int16_t>(static_cast<uint16_t>((static_cast<uint32_t>(score) + 0x8000) >> 16));
+}
+
+/** Material values in centipawns, indexed by <code>piece_type</code>. */
+constexpr std::array<int16_t, 7> midgame_piece_values = { 477, 337, 365, 1025, 0, 82, 0 };
+constexpr std::array<int16_t, 7> endgame_piece_values = { 512, 281, 297, 936, 0, 94, 0 };
+
+/**
+ * The contribution of each piece type to the game phase, indexed by <code>piece_type</code>. The starting position
+ * has a game phase of <code>max_game_phase</code>, and a board of bare kings and pawns has a game phase of zero.
+ */
+constexpr std::array<uint8_t, 7> game_phase_values = { 2, 1, 1, 4, 0, 0, 0 };
+constexpr int max_game_phase = 24;
+
+using square_bonus_table = std::array<int8_t, 64>;
+
+/**
+ * Positional bonuses in centipawns for a white piece standing on each square, indexed by <code>piece_type</code>.
+ * The tables are written as the board is drawn, with rank 8 on the first row, and are mirrored for black pieces.
+ */
+constexpr std::array<square_bonus_table, 6> midgame_square_bonuses = {{
+    { // Rook
+        0,   0,   0,   0,   0,   0,   0,   0,
+        5,  10,  10,  10,  10,  10,  10,   5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+        0,   0,   0,   5,   5,   0,   0,   0 },
+    { // Knight
+      -50, -40, -30, -30, -30, -30, -40, -50,
+      -40, -20,   0,   0,   0,   0, -20, -40,
+      -30,   0,  10,  15,  15,  10,   0, -30,
+      -30,   5,  15,  20,  20,  15,   5, -30,
+      -30,   0,  15,  20,  20,  15,   0, -30,
+      -30,   5,  10,  15,  15,  10,   5, -30,
+      -40, -20,   0,   5,   5,   0, -20, -40,
+      -50, -40, -30, -30, -30, -30, -40, -50 },
+    { // Bishop
+      -20, -10, -10, -10, -10, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,  10,  10,   5,   0, -10,
+      -10,   5,   5,  10,  10,   5,   5, -10,
+      -10,   0,  10,  10,  10,  10,   0, -10,
+      -10,  10,  10,  10,  10,  10,  10, -10,
+      -10,   5,   0,   0,   0,   0,   5, -10,
+      -20, -10, -10, -10, -10, -10, -10, -20 },
+    { // Queen
+      -20, -10, -10,  -5,  -5, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,   5,   5,   5,   0, -10,
+       -5,   0,   5,   5,   5,   5,   0,  -5,
+        0,   0,   5,   5,   5,   5,   0,  -5,
+      -10,   5,   5,   5,   5,   5,   0, -10,
+      -10,   0,   5,   0,   0,   0,   0, -10,
+      -20, -10, -10,  -5,  -5, -10, -10, -20 },
+    { // King
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -20, -30, -30, -40, -40, -30, -30, -20,
+      -10, -20, -20, -20, -20, -20, -20, -10,
+       20,  20,   0,   0,   0,   0,  20,  20,
+       20,  30,  10,   0,   0,  10,  30,  20 },
+    { // Pawn
+        0,   0,   0,   0,   0,   0,   0,   0,
+       50,  50,  50,  50,  50,  50,  50,  50,
+       10,  10,  20,  30,  30,  20,  10,  10,
+        5,   5,  10,  25,  25,  10,   5,   5,
+        0,   0,   0,  20,  20,   0,   0,   0,
+        5,  -5, -10,   0,   0, -10,  -5,   5,
+        5,  10,  10, -20, -20,  10,  10,   5,
+        0,   0,   0,   0,   0,   0,   0,   0 },
+}};
+
+/** As <code>midgame_square_bonuses</code>, but for the endgame. Only the king and pawn tables differ. */
+constexpr std::array<square_bonus_table, 6> endgame_square_bonuses = {{
+    midgame_square_bonuses[piece_type::rook],
+    midgame_square_bonuses[piece_type::knight],
+    midgame_square_bonuses[piece_type::bishop],
+    midgame_square_bonuses[piece_type::queen],
+    { // King
+      -50, -40, -30, -20, -20, -30, -40, -50,
+      -30, -20, -10,   0,   0, -10, -20, -30,
+      -30, -10,  20,  30,  30,  20, -10, -30,
+      -30, -10,  30,  40,  40,  30, -10, -30,
+      -30, -10,  30,  40,  40,  30, -10, -30,
+      -30, -10,  20,  30,  30,  20, -10, -30,
+      -30, -30,   0,   0,   0,   0, -30, -30,
+      -50, -30, -30, -30, -30, -30, -30, -50 },
+    { // Pawn
+        0,   0,   0,   0,   0,   0,   0,   0,
+       80,  80,  80,  80,  80,  80,  80,  80,
+       50,  50,  50,  50,  50,  50,  50,  50,
+       30,  30,  30,  30,  30,  30,  30,  30,
+       15,  15,  15,  15,  15,  15,  15,  15,
+        5,   5,   5,   5,   5,   5,   5,   5,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0 },
+}};
+
+/**
+ * <p>The packed material plus positional score of a piece, indexed by color, piece type and square. Scores of black
+ * pieces are negated, so that summing over the board gives the score from white's perspective. Entries of
+ * <code>piece_type::none</code> are zero, which lets <code>make_move</code> subtract the captured piece without
+ * branching.</p>
+ */
+consteval std::array<std::array<std::array<packed_score, 64>, 7>, 2> generate_piece_square_table() {
+    std::array<std::array<std::array<packed_score, 64>, 7>, 2> table {};
+    for (uint8_t type = piece_type::rook; type < piece_type::none; ++type) {
+        for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+            // The bonus tables are drawn with rank 8 first. Flipping the rank of the square looks up a white piece,
+            // and looking up the square unchanged mirrors the table for a black piece.
+            const uint8_t white_view = sindex ^ 0b111000;
+            table[piece_color::white][type][sindex] = pack_score(
+                    midgame_piece_values[type] + midgame_square_bonuses[type][white_view],
+                    endgame_piece_values[type] + endgame_square_bonuses[type][white_view]);
+            table[piece_color::black][type][sindex] = -pack_score(
+                    midgame_piece_values[type] + midgame_square_bonuses[type][sindex],
+                    endgame_piece_values[type] + endgame_square_bonuses[type][sindex]);
+        }
+    }
+    return table;
+}
+
+inline constinit std::array<std::array<std::array<packed_score, 64>, 7>, 2> piece_square_table =
+        generate_piece_square_table();
+
+/**
+ * Computes the piece-square score and game phase of the given position from scratch. The search relies on the values
+ * maintained by <code>make_move</code> instead, this serves to initialize and to verify them.
+ */
+template<typename position_type>
+[[nodiscard]] std::pair<packed_score, uint8_t> compute_piece_square_score(const position_type& position) {
+    packed_score score = 0;
+    uint8_t phase = 0;
+    for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+        const piece_type type = piece_type_on(position, sindex);
+        const piece_color color = (color_bitboards(position)[piece_color::white] & sbitboard(sindex))
+                                  ? piece_color::white : piece_color::black;
+        score += piece_square_table[color][type][sindex];
+        phase += game_phase_values[type];
+    }
+    return { score, phase };
+}
+
+/**
+ * The deepest game history, counted in plies, which a <code>ply_indexed_move_log</code> can record. This covers the
+ * longest games played in practice plus the deepest search line beneath them.
+ */
+constexpr std::size_t max_ply = 1024;
+
+/**
+ * <p>A move log backed by a fixed-capacity array and the index of the next free entry. It offers the subset of the
+ * <code>std::stack</code> interface used by <code>make_move</code> and <code>unmake_move</code>, plus indexed access
+ * to the history.</p>
+ * <p>Unlike <code>std::stack</code>, which is backed by <code>std::deque</code>, pushing never allocates, consecutive
+ * plies are adjacent in memory, and the log is trivially copyable.</p>
+ */
+template<std::size_t capacity>
+struct ply_indexed_move_log {
+    std::array<reversible_move, capacity> entries;
+    std::uint16_t ply = 0;
+
+    void push(const reversible_move& move) {
+        assert(ply < capacity);
+        entries[ply++] = move;
+    }
+    [[nodiscard]] const reversible_move& top() const { return entries[ply - 1]; }
+    void pop() { --ply; }
+    [[nodiscard]] std::size_t size() const { return ply; }
+    [[nodiscard]] bool empty() const { return ply == 0; }
+    [[nodiscard]] const reversible_move& operator[](const std::size_t i) const { return entries[i]; }
+
+    /** Forgets all but the latest <code>count</code> entries, which move to the front. They can no longer be popped. */
+    void keep_latest(const std::size_t count) {
+        if (ply <= count) return;
+        std::copy_n(entries.begin() + (ply - count), count, entries.begin());
+        ply = static_cast<std::uint16_t>(count);
+    }
+};
+
+/**
+ * <p>The board, side to move, castling and en-passant state of a game, plus the log of moves needed to undo them.</p>
+ * <p>The position is parameterized by the container holding its move log. Everything which operates on a position is
+ * a template over the position type, so both layouts below share one implementation.</p>
+ */
+template<typename move_log_type, typename accumulator_stack_type = no_accumulators>
+struct basic_chess_position {
+    std::array<bitboard, 2> color_bitboard;
+
+    std::array<bitboard, 2> color_bitboard_rotated;
+
+    /**
+     * <p>An array of bitboards indexed by <code>piece_type</code>. Each bitboard contains a mapping
+     * of all the pieces of the associated type which exist on the board currently.</p>
+     * <p>This array intentionally includes a bitboard associated with <code>piece_type::none</code>. It too
+     * must be kept consistent by <code>make_move</code> and <code>unmake_move</code>.</p>
+     */
+    std::array<bitboard, 7> type_specific_bitboard;
+
+    std::array<piece_type, 64> occupier_type_lookup_table;
+
+    move_log_type move_log;
+
+    /**
+     * The player whose turn it is to move this turn (either white or black). A read from this field is functionally
+     * equivalent to the following computation...
+     * \n<code><pre>
+     *      state.move_log.size() % 2 == 0 ? piece_color::white : piece_color::black;
+     * </pre></code>\n
+     * ...provided the game began with white to move.
+     */
+    piece_color whos_turn;
+
+    /** A set of <code>castling_right</code> flags describing the castling privileges which remain available. */
+    uint8_t castling_rights;
+
+    /**
+     * The file of the pawn which may be captured en-passant this turn, or <code>no_enpassant</code> if the last move
+     * was not a double pawn push.
+     */
+    uint8_t enpassant_file;
+
+    /** The Zobrist key of this position, updated incrementally by <code>make_move</code>. */
+    zobrist_key hash;
+
+    /**
+     * The Zobrist key of the pawns alone, see <code>compute_pawn_key</code>. It changes only when a pawn moves, is
+     * captured or promotes, and so identifies the pawn structure for the pawn hash table.
+     */
+    zobrist_key pawn_hash;
+
+    /**
+     * The sum of <code>piece_square_table</code> over every piece on the board, which is the material and positional
+     * score from white's perspective, updated incrementally by <code>make_move</code>.
+     */
+    packed_score piece_square_score;
+
+    /** The sum of <code>game_phase_values</code> over every piece on the board, updated by <code>make_move</code>. */
+    uint8_t game_phase;
+
+    /**
+     * <p>The number of plies since the last capture or pawn move, for the fifty-move rule. It saturates at 255,
+     * long after the game may be claimed drawn.</p>
+     * <p>No position before the last capture or pawn move can recur, so the clock also bounds how far back through
+     * the move log a repetition need be sought, see <code>is_repetition</code>. A null move resets it for the same
+     * reason, since a repetition across a null move would be no repetition at all.</p>
+     */
+    uint8_t halfmove_clock;
+
+    /**
+     * The network accumulators of the positions along the current line, see <code>nnue_accumulator_stack</code>. They
+     * are maintained only by position types which evaluate with the network, and only once a network is loaded.
+     */
+    [[no_unique_address]] accumulator_stack_type accumulators;
+};
+
+/** The original position layout, whose move log is a <code>std::stack</code> and therefore lives on the heap. */
+using chess_position = basic_chess_position<std::stack<reversible_move>>;
+
+/**
+ * A position whose move log is a fixed array indexed by ply. It occupies one contiguous block of memory, so it can be
+ * copied into another thread with a single <code>memcpy</code>, and making moves never touches the allocator.
+ */
+using flat_chess_position = basic_chess_position<ply_indexed_move_log<max_ply>>;
+static_assert(std::is_trivially_copyable_v<flat_chess_position>);
+
+/**
+ * Moves a piece between two squares without any of the bookkeeping which accompanies a real move. This is used to
+ * relocate the rook during castling.
+ */
+template<typename position_type>
+void relocate_piece(position_type& position, piece_color color, piece_type type, uint8_t from, uint8_t to) {
+    position.occupier_type_lookup_table[from] = piece_type::none;
+    position.occupier_type_lookup_table[to] = type;
+    position.color_bitboard[color] ^= sbitboard(from) | sbitboard(to);
+    if constexpr (maintains_rotated_bitboards)
+        position.color_bitboard_rotated[color] ^= sbitboard(rotate_sindex(from)) | sbitboard(rotate_sindex(to));
+    position.type_specific_bitboard[type] ^= sbitboard(from) | sbitboard(to);
+    position.hash ^= zobrist_tables.piece[color][type][from] ^ zobrist_tables.piece[color][type][to];
+    position.piece_square_score += piece_square_table[color][type][to] - piece_square_table[color][type][from];
+}
+
+/**
+ * Castling is represented as a king move spanning two files. The rook which accompanies the king is found on the
+ * corner square in the direction of travel and lands on the square the king passed over.
+ */
+[[nodiscard]] constexpr bool is_castle(const uint8_t origin, const uint8_t destination, const piece_type king_type) {
+    return king_type == piece_type::king && ((origin > destination ? origin - destination : destination - origin) == 2);
+}
+
+[[nodiscard]] constexpr uint8_t castle_rook_origin(const uint8_t origin, const uint8_t destination) {
+    return destination > origin ? origin + 3 : origin - 4;
+}
+
+[[nodiscard]] constexpr uint8_t castle_rook_destination(const uint8_t origin, const uint8_t destination) {
+    return (origin + destination) / 2;
+}
+
+/**
+ * <p>Makes the given move on behalf of <code>mover</code>, which must be the player whose turn it is.</p>
+ * <p>The mover is either a <code>piece_color</code> read at runtime, or a <code>color_constant</code>, in which case
+ * every color dependent index and offset below is a compile-time constant of the instantiation.</p>
+ */
+template<typename position_type, typename color_type>
+void make_move_as(const bitmove move, position_type& position, const color_type mover) {
+    count_event(instrumented_counter::made_moves);
+    const piece_color us = mover;
+    assert(position.whos_turn == us);
+    const auto [origin, destination, promote_to] = move.unpack_all();
+    const bool is_promotion = promote_to != piece_type::none;
+    const piece_type moved_piece_type = position.occupier_type_lookup_table[origin];
+    const piece_type destination_occupant_type = position.occupier_type_lookup_table[destination];
+    const piece_type placed_piece_type = is_promotion ? promote_to : moved_piece_type;
+    const piece_color opponent_color = !us;
+    const uint8_t origin_rotated = rotate_sindex(origin);
+
+    // The target and destination values are equivalent in all cases except en-passant.
+    const uint8_t target = lookup_target(origin, destination, moved_piece_type, destination_occupant_type,
+                                         us);
+    const piece_type target_piece_type = position.occupier_type_lookup_table[target];
+
+    position.move_log.push(reversible_move {
+        .origin = origin,
+        .destination = destination,
+        .target = target,
+        .captured_piece_type = target_piece_type,
+        .is_promotion = is_promotion,
+        .castling_rights = position.castling_rights,
+        .enpassant_file = position.enpassant_file,
+        .hash = position.hash,
+        .pawn_hash = position.pawn_hash,
+        .piece_square_score = position.piece_square_score,
+        .game_phase = position.game_phase,
+        .halfmove_clock = position.halfmove_clock
+    });
+
+    // Clear the now vacated origin square.
+    position.occupier_type_lookup_table[origin] = piece_type::none;
+    position.color_bitboard[us] &= ~sbitboard(origin);
+    position.type_specific_bitboard[moved_piece_type] &= ~sbitboard(origin);
+    if constexpr (maintains_rotated_bitboards)
+        position.color_bitboard_rotated[us] &= ~sbitboard(origin_rotated);
+
+    // Clear the target square since the piece which resides on it has been captured.
+    position.type_specific_bitboard[target_piece_type] &= ~sbitboard(target);
+    position.occupier_type_lookup_table[target] = piece_type::none;
+    position.color_bitboard[opponent_color] &= ~sbitboard(target);
+    if constexpr (maintains_rotated_bitboards)
+        position.color_bitboard_rotated[opponent_color] &= ~sbitboard(rotate_sindex(target));
+
+    // Fill the destination square with the moved piece.
+    position.occupier_type_lookup_table[destination] = placed_piece_type;
+    position.color_bitboard[us] |= sbitboard(destination);
+    position.type_specific_bitboard[placed_piece_type] |= sbitboard(destination);
+    if constexpr (maintains_rotated_bitboards)
+        position.color_bitboard_rotated[us] |= sbitboard(rotate_sindex(destination));
+
+    if (is_castle(origin, destination, moved_piece_type)) {
+        relocate_piece(position, us, piece_type::rook, castle_rook_origin(origin, destination),
+                       castle_rook_destination(origin, destination));
+    }
+
+    position.type_specific_bitboard[piece_type::none] = ~(position.color_bitboard[piece_color::white] |
+                                                          position.color_bitboard[piece_color::black]);
+    const uint8_t castling_rights = position.castling_rights &
+                                    castling_rights_mask_table[origin] & castling_rights_mask_table[destination];
+    const bool is_double_push = (moved_piece_type == piece_type::pawn) &
+                                ((origin > destination ? origin - destination : destination - origin) == 16);
+    const uint8_t enpassant_file = is_double_push ? (origin & 0b111) : no_enpassant;
+
+    position.hash ^= zobrist_tables.piece[us][moved_piece_type][origin] ^
+                     zobrist_tables.piece[opponent_color][target_piece_type][target] ^
+                     zobrist_tables.piece[us][placed_piece_type][destination] ^
+                     zobrist_tables.castling[position.castling_rights] ^ zobrist_tables.castling[castling_rights] ^
+                     zobrist_tables.enpassant[position.enpassant_file] ^ zobrist_tables.enpassant[enpassant_file] ^
+                     zobrist_tables.black_to_move;
+
+    if (moved_piece_type == piece_type::pawn || target_piece_type == piece_type::pawn) {
+        position.pawn_hash ^= zobrist_tables.piece[opponent_color][piece_type::pawn][target] *
+                              (target_piece_type == piece_type::pawn);
+        if (moved_piece_type == piece_type::pawn) {
+            position.pawn_hash ^= zobrist_tables.piece[us][piece_type::pawn][origin] ^
+                                  (zobrist_tables.piece[us][piece_type::pawn][destination] * !is_promotion);
+        }
+    }
+
+    position.piece_square_score += piece_square_table[us][placed_piece_type][destination] -
+                                   piece_square_table[us][moved_piece_type][origin] -
+                                   piece_square_table[opponent_color][target_piece_type][target];
+    position.game_phase += game_phase_values[placed_piece_type] - game_phase_values[moved_piece_type] -
+                           game_phase_values[target_piece_type];
+
+    position.castling_rights = castling_rights;
+    position.enpassant_file = enpassant_file;
+    const bool is_irreversible = (moved_piece_type == piece_type::pawn) | (target_piece_type != piece_type::none);
+    position.halfmove_clock = is_irreversible ? 0 : position.halfmove_clock + (position.halfmove_clock < 255);
+    position.whos_turn = opponent_color;
+    assert(position.hash == compute_zobrist_key(position));
+    assert(position.pawn_hash == compute_pawn_key(position));
+    assert(std::make_pair(position.piece_square_score, position.game_phase) == compute_piece_square_score(position));
+
+    if constexpr (maintains_accumulators<position_type>) {
+        if (active_network) {
+            nnue_delta delta;
+            delta.remove(us, moved_piece_type, origin);
+            delta.add(us, placed_piece_type, destination);
+            if (target_piece_type != piece_type::none) delta.remove(opponent_color, target_piece_type, target);
+            if (is_castle(origin, destination, moved_piece_type)) {
+                delta.remove(us, piece_type::rook, castle_rook_origin(origin, destination));
+                delta.add(us, piece_type::rook, castle_rook_destination(origin, destination));
+            }
+            const std::size_t ply = position.move_log.size();
+            apply_accumulator_delta(*active_network, position.accumulators.at(ply - 1), position.accumulators.at(ply),
+                                    delta);
+            assert(accumulator_is_consistent(position));
+        }
+    }
+}
+
+/** Makes the given move on behalf of the player whose turn it is. */
+template<typename position_type>
+void make_move(const bitmove move, position_type& position) {
+    make_move_as(move, position, position.whos_turn);
+}
+
+/** Makes the given move on behalf of <code>us</code>, known at compile time to be the player whose turn it is. */
+template<piece_color us, typename position_type>
+void make_move(const bitmove move, position_type& position) {
+    make_move_as(move, position, color_constant<us> {});
+}
+
+/** Unmakes the last move, which must have been made by <code>mover</code>. See <code>make_move_as</code>. */
+template<typename position_type, typename color_type>
+void unmake_move_as(position_type& position, const color_type mover) {
+    count_event(instrumented_counter::unmade_moves);
+    const reversible_move last_move = position.move_log.top();
+    const bool is_capture = last_move.captured_piece_type != piece_type::none;
+    const piece_color last_player_to_move = mover;
+    const piece_color opponent_color = !last_player_to_move;
+    assert(position.whos_turn == opponent_color);
+    const piece_type post_move_piece_type = position.occupier_type_lookup_table[last_move.destination];
+    const piece_type pre_move_piece_type = last_move.is_promotion ? piece_type::pawn : post_move_piece_type;
+    const uint8_t destination_rotated = rotate_sindex(last_move.destination);
+    const uint8_t target_rotated = rotate_sindex(last_move.target);
+    const uint8_t origin_rotated = rotate_sindex(last_move.origin);
+
+    if (is_castle(last_move.origin, last_move.destination, pre_move_piece_type)) {
+        relocate_piece(position, last_player_to_move, piece_type::rook,
+                       castle_rook_destination(last_move.origin, last_move.destination),
+                       castle_rook_origin(last_move.origin, last_move.destination));
+    }
+
+    // Remove the piece from its destination square.
+    position.occupier_type_lookup_table[last_move.destination] = piece_type::none;
+    position.color_bitboard[last_player_to_move] &= ~sbitboard(last_move.destination);
+    if constexpr (maintains_rotated_bitboards)
+        position.color_bitboard_rotated[last_player_to_move] &= ~sbitboard(destination_rotated);
+    position.type_specific_bitboard[post_move_piece_type] &= ~sbitboard(last_move.destination);
+
+    // If a piece was captured as a result of this move, un-capture it.
+    position.occupier_type_lookup_table[last_move.target] = last_move.captured_piece_type;
+    position.color_bitboard[opponent_color] |= (sbitboard(last_move.target) * is_capture);
+    if constexpr (maintains_rotated_bitboards)
+        position.color_bitboard_rotated[opponent_color] |= (sbitboard(target_rotated) * is_capture);
+    position.type_specific_bitboard[last_move.captured_piece_type] |= sbitboard(last_move.target);
+
+    // Put the piece back on its origin square.
+    position.occupier_type_lookup_table[last_move.origin] = pre_move_piece_type;
+    position.color_bitboard[last_player_to_move] |= sbitboard(last_move.origin);
+    if constexpr (maintains_rotated_bitboards)
+        position.color_bitboard_rotated[last_player_to_move] |= sbitboard(origin_rotated);
+    position.type_specific_bitboard[pre_move_piece_type] |= sbitboard(last_move.origin);
+
+    position.type_specific_bitboard[piece_type::none] = ~(position.color_bitboard[piece_color::white] |
+                                                          position.color_bitboard[piece_color::black]);
+    position.castling_rights = last_move.castling_rights;
+    position.enpassant_file = last_move.enpassant_file;
+    // Restoring the recorded key is cheaper than toggling the same numbers make_move toggled.
+    position.hash = last_move.hash;
+    position.pawn_hash = last_move.pawn_hash;
+    position.piece_square_score = last_move.piece_square_score;
+    position.game_phase = last_move.game_phase;
+    position.halfmove_clock = last_move.halfmove_clock;
+    position.move_log.pop();
+    position.whos_turn = last_player_to_move;
+    assert(position.hash == compute_zobrist_key(position));
+    assert(std::make_pair(position.piece_square_score, position.game_phase) == compute_piece_square_score(position));
+    assert(accumulator_is_consistent(position));
+}
+
+/** Unmakes the last move. */
+template<typename position_type>
+void unmake_move(position_type& position) {
+    unmake_move_as(position, !position.whos_turn);
+}
+
+/** Unmakes the last move, known at compile time to have been made by <code>us</code>. */
+template<piece_color us, typename position_type>
+void unmake_move(position_type& position) {
+    unmake_move_as(position, color_constant<us> {});
+}
+
+/**
+ * <p>Passes the turn to the opponent without moving a piece, for null move pruning. The log records the null move
+ * as a move whose origin is its destination, see <code>is_null_move</code>, so that the position may be restored by
+ * <code>unmake_null_move</code> and so that the log keeps one entry per ply, as the network accumulators require.</p>
+ * <p>The player to move must not be in check. Any en-passant capture is forfeited, and the halfmove clock is
+ * reset.</p>
+ */
+template<typename position_type>
+void make_null_move(position_type& position) {
+    position.move_log.push(reversible_move {
+        .origin = 0,
+        .destination = 0,
+        .target = 0,
+        .captured_piece_type = piece_type::none,
+        .is_promotion = false,
+        .castling_rights = position.castling_rights,
+        .enpassant_file = position.enpassant_file,
+        .hash = position.hash,
+        .pawn_hash = position.pawn_hash,
+        .piece_square_score = position.piece_square_score,
+        .game_phase = position.game_phase,
+        .halfmove_clock = position.halfmove_clock
+    });
+    position.hash ^= zobrist_tables.enpassant[position.enpassant_file] ^ zobrist_tables.black_to_move;
+    position.enpassant_file = no_enpassant;
+    position.halfmove_clock = 0;
+    position.whos_turn = !position.whos_turn;
+    assert(position.hash == compute_zobrist_key(position));
+
+    if constexpr (maintains_accumulators<position_type>) {
+        if (active_network) {
+            const std::size_t ply = position.move_log.size();
+            position.accumulators.at(ply) = position.accumulators.at(ply - 1);
+        }
+    }
+}
+
+/** Unmakes the null move made last by <code>make_null_move</code>. */
+template<typename position_type>
+void unmake_null_move(position_type& position) {
+    const reversible_move last_move = position.move_log.top();
+    position.enpassant_file = last_move.enpassant_file;
+    position.hash = last_move.hash;
+    position.halfmove_clock = last_move.halfmove_clock;
+    position.move_log.pop();
+    position.whos_turn = !position.whos_turn;
+    assert(position.hash == compute_zobrist_key(position));
+}
+
+/** Returns true if the given log entry is that of a null move, see <code>make_null_move</code>. */
+[[nodiscard]] constexpr bool is_null_move(const reversible_move& move) {
+    return move.origin == move.destination;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+/**
+ * <h2>Repetitions</h2>
+ * <p>Detection of repeated positions from the Zobrist keys recorded in the move log, and of positions from which the
+ * player to move could repeat one with a single move.</p>
+ */
+
+#include "board.hpp"
+#include "move_generation.hpp"
+#include "position.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <utility>
+
+// Repetitions
+
+/**
+ * <p>Determines whether the position occurred before, by comparing its key with those recorded in the move log.</p>
+ * <p>Only the entries since the last capture or pawn move are compared, a bound kept by the halfmove clock, and of
+ * those only every other one, since a position with the other player to move cannot be the same position. The
+ * nearest candidate is four plies back, as each player needs at least two moves to return to a position.</p>
+ * <p>The position type must have an indexable move log, such as <code>ply_indexed_move_log</code>.</p>
+ */
+template<typename position_type>
+[[nodiscard]] bool is_repetition(const position_type& position) {
+    const std::size_t plies = position.move_log.size();
+    const std::size_t end = std::min<std::size_t>(position.halfmove_clock, plies);
+    for (std::size_t distance = 4; distance <= end; distance += 2) {
+        if (position.move_log[plies - distance].hash == position.hash) return true;
+    }
+    return false;
+}
+
+// Cuckoo Tables
+
+constexpr std::size_t cuckoo_table_size = 8192;
+
+/** The number of moves, of either color, between two squares a piece other than a pawn could move between. */
+constexpr std::size_t reversible_piece_move_count = 3668;
+
+[[nodiscard]] constexpr std::size_t cuckoo_first_slot(const zobrist_key key) { return key & (cuckoo_table_size - 1); }
+
+[[nodiscard]] constexpr std::size_t cuckoo_second_slot(const zobrist_key key) {
+    return (key >> 16) & (cuckoo_table_size - 1);
+}
+
+/**
+ * <p>The keys of every move which can be unmade by another move, that is every move of a piece other than a pawn
+ * which neither captures nor castles, stored as the change they make to the Zobrist key of a position, along with
+ * the squares of the two ends of each move. A key is stored in one of two slots, see <code>cuckoo_first_slot</code>
+ * and <code>cuckoo_second_slot</code>, so that looking it up takes two reads at most. Empty slots hold a zero key.
+ * </p>
+ * <p>Since a move from one square to another and the move back change the key by the same amount, each pair of
+ * squares is stored once, with the lesser square first.</p>
+ */
+struct cuckoo_tables {
+    std::array<zobrist_key, cuckoo_table_size> keys;
+    std::array<std::array<uint8_t, 2>, cuckoo_table_size> squares;
+};
+
+consteval cuckoo_tables generate_cuckoo_tables() {
+    cuckoo_tables tables {};
+    const zobrist_table_set zobrist = generate_zobrist_tables();
+    const std::array<bitboard, 64> knight_moves = generate_knight_move_table();
+    const std::array<bitboard, 64> king_moves = generate_king_move_table();
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        for (uint8_t type = piece_type::rook; type < piece_type::pawn; ++type) {
+            for (uint8_t from = 0; from < 64; ++from) {
+                const bitboard rooklike = walk_slider_attacks(from, 0, rooklike_directions, true);
+                const bitboard bishoplike = walk_slider_attacks(from, 0, bishoplike_directions, true);
+                bitboard destinations = 0;
+                switch (type) {
+                    case piece_type::rook: destinations = rooklike; break;
+                    case piece_type::knight: destinations = knight_moves[from]; break;
+                    case piece_type::bishop: destinations = bishoplike; break;
+                    case piece_type::queen: destinations = rooklike | bishoplike; break;
+                    default: destinations = king_moves[from]; break;
+                }
+                for (uint8_t to = from + 1; to < 64; ++to) {
+                    if (!(destinations & sbitboard(to))) continue;
+                    zobrist_key key = zobrist.piece[color][type][from] ^ zobrist.piece[color][type][to] ^
+                                      zobrist.black_to_move;
+                    std::array<uint8_t, 2> squares = { from, to };
+                    // Each key displaces the occupant of its slot into the occupant's other slot, until one lands
+                    // in an empty slot.
+                    std::size_t slot = cuckoo_first_slot(key);
+                    while (true) {
+                        std::swap(tables.keys[slot], key);
+                        std::swap(tables.squares[slot], squares);
+                        if (key == 0) break;
+                        slot = slot == cuckoo_first_slot(key) ? cuckoo_second_slot(key) : cuckoo_first_slot(key);
+                    }
+                }
+            }
+        }
+    }
+    return tables;
+}
+
+inline constinit cuckoo_tables cuckoo = generate_cuckoo_tables();
+static_assert(std::ranges::count_if(generate_cuckoo_tables().keys, [](const zobrist_key key) { return key != 0; })
+              == reversible_piece_move_count, "Every reversible move must be stored, and none displaced.");
+
+/**
+ * <h2>Upcoming Repetition Detection</h2>
+ * <p>Determines whether the player to move has a move which repeats an earlier position, without generating any
+ * moves. This is the algorithm of Marcel van Kervinck, as used by Stockfish.</p>
+ * <p>A move of ours repeats the position <code>distance</code> plies back, an odd number, if the opponent's moves
+ * since cancel out, and the difference between the keys of then and now is the key of a reversible move in
+ * <code>cuckoo</code>. That move must then be unobstructed, and be one of ours rather than the opponent's. It may be
+ * illegal, should it expose our king, but the position it would lead to has occurred, with that king safe.</p>
+ * <p>The position type must have an indexable move log, such as <code>ply_indexed_move_log</code>.</p>
+ */
+template<typename position_type>
+[[nodiscard]] bool has_upcoming_repetition(const position_type& position) {
+    const std::size_t plies = position.move_log.size();
+    const std::size_t end = std::min<std::size_t>(position.halfmove_clock, plies);
+    if (end < 3) return false;
+    const bitboard occupancy = position.color_bitboard[piece_color::white] |
+                               position.color_bitboard[piece_color::black];
+    const auto key_before = [&](const std::size_t distance) { return position.move_log[plies - distance].hash; };
+    zobrist_key opponent_moves = position.hash ^ key_before(1) ^ zobrist_tables.black_to_move;
+    for (std::size_t distance = 3; distance <= end; distance += 2) {
+        opponent_moves ^= key_before(distance - 1) ^ key_before(distance) ^ zobrist_tables.black_to_move;
+        if (opponent_moves) continue;
+        const zobrist_key move_key = position.hash ^ key_before(distance);
+        std::size_t slot = cuckoo_first_slot(move_key);
+        if (cuckoo.keys[slot] != move_key) slot = cuckoo_second_slot(move_key);
+        if (cuckoo.keys[slot] != move_key) continue;
+        const auto [from, to] = cuckoo.squares[slot];
+        if (between_table[from][to] & occupancy) continue;
+        const uint8_t mover = (occupancy & sbitboard(from)) ? from : to;
+        if (position.color_bitboard[position.whos_turn] & sbitboard(mover)) return true;
+    }
+    return false;
+}
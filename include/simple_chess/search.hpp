@@ -0,0 +1,1045 @@
+#pragma once
+
+/**
+ * <h2>Search</h2>
+ * <p>Iterative deepening principal variation search with quiescence, move ordering and Lazy SMP.</p>
+ */
+
+#include "book.hpp"
+#include "evaluation.hpp"
+#include "move_generation.hpp"
+#include "notation.hpp"
+#include "repetition.hpp"
+#include "tablebase.hpp"
+#include "transposition_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Search
+
+/**
+ * The position type used by the search, chosen because it can be copied between threads with a memcpy. Unlike
+ * <code>flat_chess_position</code>, it maintains the network accumulators, which perft has no use for.
+ */
+using search_position = basic_chess_position<ply_indexed_move_log<max_ply>, nnue_accumulator_stack>;
+static_assert(std::is_trivially_copyable_v<search_position>);
+
+/** The deepest line, in plies from the root, the search may explore. */
+constexpr int max_search_ply = 128;
+static_assert(nnue_accumulator_stack::capacity >= max_search_ply);
+
+constexpr int infinite_score = 32001;
+
+/** The score of a position in which the side to move has been checkmated at the root. */
+constexpr int mate_score = 32000;
+
+/** Scores at least this large in magnitude announce a forced mate. */
+constexpr int mate_threshold = mate_score - max_search_ply;
+
+/**
+ * The score of a position the tablebases know to be won, less the ply it is found at, so that of two ways into won
+ * endings the search prefers the shorter. It lies beneath every mate score and above every evaluation.
+ */
+constexpr int tablebase_win_score = mate_threshold - 1;
+
+/** Scores at least this large in magnitude are tablebase wins or mates. */
+constexpr int tablebase_win_threshold = tablebase_win_score - max_search_ply;
+
+[[nodiscard]] constexpr int tablebase_score(const tablebase_wdl wdl, const int ply) {
+    if (wdl == tablebase_wdl::draw) return 0;
+    return wdl == tablebase_wdl::win ? tablebase_win_score - ply : ply - tablebase_win_score;
+}
+
+/**
+ * Mate and tablebase scores are relative to the root, but an entry of the transposition table may be read at another
+ * ply, so they are stored relative to the node instead.
+ */
+[[nodiscard]] constexpr int score_to_tt(const int score, const int ply) {
+    return score >= tablebase_win_threshold ? score + ply : score <= -tablebase_win_threshold ? score - ply : score;
+}
+
+[[nodiscard]] constexpr int score_from_tt(const int score, const int ply) {
+    return score >= tablebase_win_threshold ? score - ply : score <= -tablebase_win_threshold ? score + ply : score;
+}
+
+/**
+ * <h2>Search Parameters</h2>
+ * <p>The thresholds of the selective search, which trade the accuracy of the search for its depth. Depths are in
+ * plies and margins in centipawns.</p>
+ * <ul>
+ * <li><b>Null move pruning</b> lets the opponent move twice, searched to a depth reduced by
+ * <code>null_move_reduction</code> plus one ply per <code>null_move_depth_divisor</code> plies of depth. If the
+ * player to move still scores at least beta, the node is cut off.</li>
+ * <li><b>Late move reductions</b> search the quiet moves and losing captures, those the move picker yields last,
+ * to a depth reduced by <code>lmr_base</code> plus the product of the logarithms of the depth and the move number
+ * over <code>lmr_divisor</code>, both in hundredths of a ply, and search them again to full depth should they
+ * raise alpha.</li>
+ * <li><b>Futility pruning</b> skips the quiet moves which give no check at nodes whose static evaluation falls
+ * short of alpha by <code>futility_margin</code> per ply of depth.</li>
+ * <li><b>Razoring</b> drops into the quiescence search at nodes whose evaluation falls short of alpha by
+ * <code>razoring_margin</code> per ply of depth, and returns its score if it confirms the node fails low.</li>
+ * </ul>
+ * <p>Each technique is disabled by a depth range which is empty, for instance a futility or razoring depth of zero,
+ * or a minimum depth of <code>max_search_ply</code>.</p>
+ */
+struct search_parameters {
+    int null_move_min_depth = 3;
+    int null_move_reduction = 3;
+    int null_move_depth_divisor = 4;
+    int lmr_min_depth = 3;
+    int lmr_min_moves = 3;
+    int lmr_base = 75;
+    int lmr_divisor = 225;
+    int futility_max_depth = 4;
+    int futility_margin = 90;
+    int razoring_max_depth = 2;
+    int razoring_margin = 300;
+};
+
+/** The name of a search parameter, as a UCI option or command-line parameter, and its bounds. */
+struct search_parameter_descriptor {
+    std::string_view name;
+    int search_parameters::* value;
+    int min;
+    int max;
+};
+
+constexpr std::array<search_parameter_descriptor, 11> search_parameter_descriptors = {{
+    { "NullMoveMinDepth", &search_parameters::null_move_min_depth, 1, max_search_ply },
+    { "NullMoveReduction", &search_parameters::null_move_reduction, 0, 16 },
+    { "NullMoveDepthDivisor", &search_parameters::null_move_depth_divisor, 1, max_search_ply },
+    { "LmrMinDepth", &search_parameters::lmr_min_depth, 1, max_search_ply },
+    { "LmrMinMoves", &search_parameters::lmr_min_moves, 1, max_moves },
+    { "LmrBase", &search_parameters::lmr_base, 0, 1000 },
+    { "LmrDivisor", &search_parameters::lmr_divisor, 1, 10000 },
+    { "FutilityMaxDepth", &search_parameters::futility_max_depth, 0, max_search_ply },
+    { "FutilityMargin", &search_parameters::futility_margin, 0, 2000 },
+    { "RazoringMaxDepth", &search_parameters::razoring_max_depth, 0, max_search_ply },
+    { "RazoringMargin", &search_parameters::razoring_margin, 0, 2000 }
+}};
+
+/**
+ * Sets the named parameter, see <code>search_parameter_descriptors</code>. Returns false if there is no such
+ * parameter or the value is out of its bounds, in which case the parameters are left as they were.
+ */
+[[nodiscard]] inline bool set_search_parameter(search_parameters& parameters, const std::string_view name,
+                                               const std::int64_t value) {
+    for (const search_parameter_descriptor& descriptor : search_parameter_descriptors) {
+        if (descriptor.name != name) continue;
+        if (value < descriptor.min || value > descriptor.max) return false;
+        parameters.*descriptor.value = static_cast<int>(value);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * The limits placed upon a search. A limit of zero is no limit. When a clock is given, the time budget is derived
+ * from it, otherwise <code>move_time</code> is the budget.
+ */
+struct search_limits {
+    int max_depth = max_search_ply - 1;
+    std::uint64_t max_nodes = 0;
+    std::chrono::milliseconds move_time { 0 };
+    std::chrono::milliseconds time_remaining { 0 };
+    std::chrono::milliseconds increment { 0 };
+
+    /** The thresholds of the selective search, which belong with the limits because they too shape its budget. */
+    search_parameters parameters;
+
+    /** Varies the choice among the book moves of a position, which is otherwise the same from run to run. */
+    std::uint64_t book_seed = 0;
+};
+
+/**
+ * <p>The two deadlines of a timed search. Once the <b>soft</b> deadline has passed, no new iteration is started,
+ * because the next iteration would most likely not complete before the hard deadline. The <b>hard</b> deadline
+ * aborts the search mid-iteration.</p>
+ * <p>With a fixed move time, the soft deadline is half the budget, so that the time actually spent varies little
+ * from move to move.</p>
+ */
+struct search_deadlines {
+    std::chrono::steady_clock::time_point soft;
+    std::chrono::steady_clock::time_point hard;
+    bool is_timed;
+};
+
+[[nodiscard]] inline search_deadlines compute_deadlines(const search_limits& limits,
+                                                        const std::chrono::steady_clock::time_point start) {
+    using std::chrono::milliseconds;
+    if (limits.time_remaining.count() > 0) {
+        // Plan for forty more moves, spend most of the increment, and never risk more than a fifth of the clock on a
+        // single move.
+        const milliseconds planned = limits.time_remaining / 40 + limits.increment * 3 / 4;
+        const milliseconds hard = std::min(planned * 4, limits.time_remaining / 5);
+        return { start + std::min(planned, hard), start + hard, true };
+    }
+    if (limits.move_time.count() > 0) return { start + limits.move_time / 2, start + limits.move_time, true };
+    return { start, start, false };
+}
+
+/** A snapshot of the search, reported once per completed iteration. */
+struct search_report {
+    int depth;
+    int score;
+    std::uint64_t nodes;
+    std::chrono::milliseconds elapsed;
+    unsigned hashfull;
+    std::vector<bitmove> principal_variation;
+};
+
+struct search_result {
+    bitmove best_move = bitmove::null();
+    int score = 0;
+    int depth = 0;
+    std::uint64_t nodes = 0;
+
+    /**
+     * The ratio of the nodes searched by the last completed iteration to those searched by the one before it, or zero
+     * if fewer than two iterations completed. The better the move ordering, the closer it is to the square root of
+     * the number of legal moves.
+     */
+    double effective_branching_factor = 0;
+};
+
+/** Writes a score in UCI notation, either <code>cp x</code> in centipawns or <code>mate n</code> in moves. */
+inline std::string format_score(const int score) {
+    if (score >= mate_threshold) return "mate " + std::to_string((mate_score - score + 1) / 2);
+    if (score <= -mate_threshold) return "mate -" + std::to_string((mate_score + score) / 2);
+    return "cp " + std::to_string(score);
+}
+
+// Static Exchange Evaluation
+
+/** The material values used by the static exchange evaluation, by type: rook, knight, bishop, queen, king, pawn. */
+constexpr std::array<int, 7> see_piece_values = { 500, 320, 330, 900, 20000, 100, 0 };
+
+/** Computes every piece of either color attacking the given square, assuming the given occupancy. */
+template<typename position_type>
+[[nodiscard]] bitboard attackers_of(const position_type& position, const uint8_t sindex, const bitboard occupancy) {
+    const std::array<bitboard, 7>& types = position.type_specific_bitboard;
+    const bitboard white_pawns = types[piece_type::pawn] & position.color_bitboard[piece_color::white];
+    const bitboard black_pawns = types[piece_type::pawn] & position.color_bitboard[piece_color::black];
+    return (pawn_attack_table[piece_color::black][sindex] & white_pawns) |
+           (pawn_attack_table[piece_color::white][sindex] & black_pawns) |
+           (knight_move_table[sindex] & types[piece_type::knight]) |
+           (king_move_table[sindex] & types[piece_type::king]) |
+           (bishoplike_attacks(sindex, occupancy) & (types[piece_type::bishop] | types[piece_type::queen])) |
+           (rooklike_attacks(sindex, occupancy) & (types[piece_type::rook] | types[piece_type::queen]));
+}
+
+/**
+ * <h2>Static Exchange Evaluation</h2>
+ * <p>Estimates the material the player whose turn it is gains by the given capture, once both players have made
+ * every recapture on the destination square that suits them, always recapturing with their least valuable
+ * attacker. Either player may stop recapturing when continuing would lose material.</p>
+ * <p>Each capture is simulated by removing the capturer from the occupancy alone, after which the attackers of the
+ * square are recomputed, so that sliders lined up behind the capturer join in. Pins are not considered.</p>
+ */
+template<typename position_type>
+[[nodiscard]] int static_exchange_evaluation(const position_type& position, const bitmove move) {
+    const auto [origin, destination, promote_to] = move.unpack_all();
+    const piece_type mover = position.occupier_type_lookup_table[origin];
+    const piece_type victim = position.occupier_type_lookup_table[destination];
+    bitboard occupancy = position.color_bitboard[piece_color::white] | position.color_bitboard[piece_color::black];
+
+    std::array<int, 32> gain;
+    gain[0] = see_piece_values[victim];
+    if (mover == piece_type::pawn && victim == piece_type::none && (origin & 0b111) != (destination & 0b111)) {
+        gain[0] = see_piece_values[piece_type::pawn];
+        occupancy ^= sbitboard(coords_to_sindex(origin >> 3, destination & 0b111));
+    }
+    int on_square_value = see_piece_values[mover];
+    if (promote_to != piece_type::none) {
+        gain[0] += see_piece_values[promote_to] - see_piece_values[piece_type::pawn];
+        on_square_value = see_piece_values[promote_to];
+    }
+    occupancy ^= sbitboard(origin);
+
+    // Each entry of the gain list is speculative, the gain of the next side should it recapture on the square. The
+    // entry is only confirmed by finding that side an attacker, and the last, unconfirmed entry is discarded.
+    piece_color side = !position.whos_turn;
+    int depth = 0;
+    while (true) {
+        ++depth;
+        gain[depth] = on_square_value - gain[depth - 1];
+        if (depth == static_cast<int>(gain.size()) - 1) break;
+        const bitboard attackers = attackers_of(position, destination, occupancy) & occupancy &
+                                   position.color_bitboard[side];
+        if (!attackers) break;
+        piece_type attacker = piece_type::none;
+        for (const piece_type type : { piece_type::pawn, piece_type::knight, piece_type::bishop, piece_type::rook,
+                                       piece_type::queen, piece_type::king }) {
+            if (attackers & position.type_specific_bitboard[type]) {
+                attacker = type;
+                break;
+            }
+        }
+        occupancy ^= sbitboard(std::countr_zero(attackers & position.type_specific_bitboard[attacker]));
+        on_square_value = see_piece_values[attacker];
+        side = !side;
+    }
+    while (--depth > 0) gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    return gain[0];
+}
+
+// Move Ordering
+
+/** The two most recent quiet moves to cause a beta cutoff at a ply, tried right after the captures. */
+using killer_moves = std::array<bitmove, 2>;
+
+/**
+ * The butterfly history table, indexed by the mover's color, origin and destination. A quiet move's score grows each
+ * time it causes a beta cutoff, more so the deeper the cutoff, and shrinks each time it is searched without causing
+ * one when another quiet move does.
+ */
+using history_table = std::array<std::array<std::array<int16_t, 64>, 64>, 2>;
+
+/** History scores saturate at this magnitude, see <code>update_history</code>. */
+constexpr int max_history_score = 16384;
+
+/**
+ * Adds the given bonus, which may be negative, to a history score. The bonus is scaled down as the score approaches
+ * <code>max_history_score</code>, so that scores saturate rather than overflow, and so that a move's old successes
+ * are gradually outweighed by its recent ones.
+ */
+constexpr void update_history(int16_t& score, const int bonus) {
+    score = static_cast<int16_t>(score + bonus - score * std::abs(bonus) / max_history_score);
+}
+
+/** The ordering of the piece types for MVV-LVA, by type: rook, knight, bishop, queen, king, pawn, none. */
+constexpr std::array<int8_t, 7> mvv_lva_rank = { 4, 2, 3, 5, 6, 1, 0 };
+
+enum class pick_stage: uint8_t {
+    tt_move,
+    generate_captures,
+    captures,
+    killers,
+    generate_quiets,
+    quiets,
+    bad_captures,
+    done
+};
+
+/** Returns true for the stages of the moves expected to be worst, the quiet moves and the losing captures. */
+[[nodiscard]] constexpr bool is_late_stage(const pick_stage stage) {
+    return stage == pick_stage::quiets || stage == pick_stage::bad_captures;
+}
+
+/**
+ * <h2>Move Picker</h2>
+ * <p>Yields the legal moves of a node one at a time, best first by the usual estimates, and generates them in
+ * stages, so that a node which is cut off early never pays for the moves it did not try.</p>
+ * <ol>
+ * <li>The move of the transposition table entry, if it is legal, before anything is generated.</li>
+ * <li>The captures and promotions which do not lose material by <code>static_exchange_evaluation</code>, the most
+ * valuable victim first, and of those the least valuable attacker first. Victims are read from
+ * <code>occupier_type_lookup_table</code>, an en-passant victim being the empty square's pawn. A promotion is valued
+ * as the capture of the piece it promotes to.</li>
+ * <li>The killer moves of the ply, if they are legal quiet moves.</li>
+ * <li>The quiet moves, by their score in the history table.</li>
+ * <li>The captures which lose material, in the order they were set aside.</li>
+ * </ol>
+ * <p>The quiescence search asks for captures only. It then never sees the captures which lose material, since it
+ * would prune them anyway.</p>
+ * <p>Within a stage the picker selects the best remaining move each time it is asked, rather than sorting, because
+ * a cutoff usually comes after the first few.</p>
+ */
+template<piece_color us, typename position_type>
+class move_picker {
+    private:
+        const position_type& position;
+        const bitmove tt_move;
+        const killer_moves& killers;
+        const history_table& history;
+        const bool include_quiets;
+        pick_stage stage = pick_stage::tt_move;
+        uint8_t killer_index = 0;
+        move_buffer moves;
+        std::array<int, max_moves> scores;
+        std::uint16_t next_index = 0;
+        move_buffer bad_captures;
+
+        /** Removes and returns the best scored move not yet yielded, or the null move if none remain. */
+        bitmove select_best() {
+            if (next_index == moves.size) return bitmove::null();
+            std::uint16_t best = next_index;
+            for (std::uint16_t i = next_index + 1; i < moves.size; ++i) {
+                if (scores[i] > scores[best]) best = i;
+            }
+            std::swap(moves.moves[best], moves.moves[next_index]);
+            std::swap(scores[best], scores[next_index]);
+            return moves.moves[next_index++];
+        }
+
+        [[nodiscard]] bool is_killer(const bitmove move) const {
+            return move == killers[0] || move == killers[1];
+        }
+    public:
+        move_picker(const position_type& position, const bitmove tt_move, const killer_moves& killers,
+                    const history_table& history, const bool include_quiets = true)
+            : position(position), tt_move(tt_move), killers(killers), history(history),
+              include_quiets(include_quiets) {}
+
+        /**
+         * The stage of the move last yielded. Moves yielded in the quiet and bad capture stages are those move ordering
+         * expects least of, see <code>is_late_stage</code>.
+         */
+        [[nodiscard]] pick_stage current_stage() const { return stage; }
+
+        /** Returns the next move to try, or the null move once every legal move has been yielded. */
+        bitmove next() {
+            switch (stage) {
+                case pick_stage::tt_move:
+                    stage = pick_stage::generate_captures;
+                    if (is_legal_move<us>(position, tt_move)) return tt_move;
+                    [[fallthrough]];
+                case pick_stage::generate_captures:
+                    generate_legal_captures<us>(position, moves);
+                    for (std::uint16_t i = 0; i < moves.size; ++i) {
+                        const auto [origin, destination, promote_to] = moves.moves[i].unpack_all();
+                        const piece_type victim = position.occupier_type_lookup_table[destination];
+                        const piece_type attacker = position.occupier_type_lookup_table[origin];
+                        const int victim_rank = victim == piece_type::none && promote_to == piece_type::none
+                                                ? mvv_lva_rank[piece_type::pawn] : mvv_lva_rank[victim];
+                        scores[i] = (victim_rank + mvv_lva_rank[promote_to]) * 8 - mvv_lva_rank[attacker];
+                    }
+                    stage = pick_stage::captures;
+                    [[fallthrough]];
+                case pick_stage::captures:
+                    for (bitmove move; !(move = select_best()).is_null();) {
+                        if (move == tt_move) continue;
+                        if (static_exchange_evaluation(position, move) >= 0) return move;
+                        bad_captures.push(move);
+                    }
+                    if (!include_quiets) {
+                        stage = pick_stage::done;
+                        return bitmove::null();
+                    }
+                    stage = pick_stage::killers;
+                    [[fallthrough]];
+                case pick_stage::killers:
+                    while (killer_index < killers.size()) {
+                        const bitmove killer = killers[killer_index++];
+                        if (killer != tt_move && !killer.is_null() && !is_capture_or_promotion(position, killer)
+                            && is_legal_move<us>(position, killer)) {
+                            return killer;
+                        }
+                    }
+                    stage = pick_stage::generate_quiets;
+                    [[fallthrough]];
+                case pick_stage::generate_quiets:
+                    moves.size = 0;
+                    next_index = 0;
+                    generate_legal_quiets<us>(position, moves);
+                    for (std::uint16_t i = 0; i < moves.size; ++i) {
+                        scores[i] = history[us][moves.moves[i].unpack_origin()][moves.moves[i].unpack_destination()];
+                    }
+                    stage = pick_stage::quiets;
+                    [[fallthrough]];
+                case pick_stage::quiets:
+                    for (bitmove move; !(move = select_best()).is_null();) {
+                        if (move != tt_move && !is_killer(move)) return move;
+                    }
+                    stage = pick_stage::bad_captures;
+                    next_index = 0;
+                    [[fallthrough]];
+                case pick_stage::bad_captures:
+                    if (next_index < bad_captures.size) return bad_captures.moves[next_index++];
+                    stage = pick_stage::done;
+                    [[fallthrough]];
+                case pick_stage::done:
+                    return bitmove::null();
+            }
+            return bitmove::null();
+        }
+};
+
+/**
+ * <h2>Search Worker</h2>
+ * <p>A negamax alpha-beta search over its own copy of the root position, driven by iterative deepening with
+ * aspiration windows. Results are shared with other searches through the transposition table.</p>
+ * <p>The node and time budgets are checked once every <code>limit_check_interval</code> nodes rather than at every
+ * node, so that reading the clock costs nothing measurable, while the search still stops within a fraction of a
+ * millisecond of its hard deadline.</p>
+ */
+class search_worker {
+    public:
+        using report_callback = std::function<void(const search_report&)>;
+
+        /**
+         * Creates a worker searching a private copy of the root. Workers of one Lazy SMP search share the table, the
+         * stop signal and the node counter, and are told apart by their thread index. The node counter may be null
+         * when the worker searches alone.
+         * <p>The ponder signal, if given, suspends the time limits while it is set, see <code>is_pondering</code>.</p>
+         */
+        search_worker(const search_position& root, transposition_table& table, const search_limits& limits,
+                      std::atomic<bool>& stop_signal, std::atomic<std::uint64_t>* shared_nodes = nullptr,
+                      const unsigned thread_index = 0, const std::atomic<bool>* ponder_signal = nullptr)
+            : position(root), table(table), limits(limits), stop_signal(stop_signal), shared_nodes(shared_nodes),
+              thread_index(thread_index), ponder_signal(ponder_signal),
+              pondering(ponder_signal && ponder_signal->load(std::memory_order_relaxed)),
+              start(std::chrono::steady_clock::now()), deadlines(compute_deadlines(limits, start)) {
+            initialize_reductions();
+        }
+
+        search_result iterative_deepening(const report_callback& report) {
+            search_result result;
+            if (probe_book_root(result)) return result;
+            if (probe_tablebase_root(result)) {
+                if (report) report(make_report(result.depth, result.score));
+                return result;
+            }
+            result.best_move = first_legal_move();
+            int previous_score = 0;
+            // Killer moves belong to the position they were found in, but history carries over usefully from one
+            // search to the next, so it is only halved.
+            killers = {};
+            for (auto& by_origin : history) {
+                for (auto& by_destination : by_origin) {
+                    for (int16_t& score : by_destination) score /= 2;
+                }
+            }
+            std::uint64_t previous_iteration_nodes = 0;
+            // Helper threads of odd index skip the first depth, so that from then on half the helpers work on the
+            // next iteration and fill the table with results the main thread is about to need.
+            for (int depth = 1 + (thread_index & 1); depth <= limits.max_depth; ++depth) {
+                const std::uint64_t nodes_before_iteration = nodes;
+                const int score = aspiration_search(depth, previous_score);
+                if (aborted) break;
+                const std::uint64_t iteration_nodes = nodes - nodes_before_iteration;
+                if (previous_iteration_nodes) {
+                    result.effective_branching_factor = static_cast<double>(iteration_nodes) /
+                                                        static_cast<double>(previous_iteration_nodes);
+                }
+                previous_iteration_nodes = iteration_nodes;
+                previous_score = score;
+                result.depth = depth;
+                result.score = score;
+                if (pv_length[0] > 0) result.best_move = pv[0][0];
+                if (report) report(make_report(depth, score));
+                if (std::abs(score) >= mate_threshold && mate_score - std::abs(score) <= depth) break;
+                if (deadlines.is_timed && !is_pondering() && std::chrono::steady_clock::now() >= deadlines.soft) {
+                    break;
+                }
+            }
+            flush_node_count();
+            result.nodes = nodes;
+            return result;
+        }
+
+        [[nodiscard]] std::uint64_t node_count() const { return nodes; }
+
+        /**
+         * Prepares the worker to search another root under other limits, as if newly created. This saves the batch
+         * analyzer reallocating a worker for every position. The history table is cleared too, so the search does not
+         * depend on what the worker searched before.
+         */
+        void reset(const search_position& root, const search_limits& new_limits) {
+            position = root;
+            history = {};
+            limits = new_limits;
+            start = std::chrono::steady_clock::now();
+            deadlines = compute_deadlines(limits, start);
+            initialize_reductions();
+            nodes = 0;
+            flushed_nodes = 0;
+            aborted = false;
+        }
+
+    private:
+        static constexpr std::uint64_t limit_check_interval = 2048;
+        static constexpr int aspiration_min_depth = 4;
+        static constexpr int aspiration_initial_delta = 25;
+
+        /** The most positional compensation a capture is assumed able to win besides its victim. */
+        static constexpr int delta_margin = 200;
+
+        search_position position;
+        transposition_table& table;
+        search_limits limits;
+        std::atomic<bool>& stop_signal;
+        std::atomic<std::uint64_t>* shared_nodes;
+        std::uint64_t flushed_nodes = 0;
+        unsigned thread_index;
+        const std::atomic<bool>* ponder_signal;
+        bool pondering;
+        std::chrono::steady_clock::time_point start;
+        search_deadlines deadlines;
+        std::uint64_t nodes = 0;
+        bool aborted = false;
+
+        std::array<killer_moves, max_search_ply> killers {};
+        history_table history {};
+        pawn_hash_table pawn_table {};
+
+        /**
+         * The late move reductions, in plies, indexed by depth and by the number of moves searched before, each
+         * capped at 63. See <code>search_parameters</code>.
+         */
+        std::array<std::array<uint8_t, 64>, 64> reductions {};
+
+        /** The triangular principal variation table. Row <i>p</i> holds the best line found from ply <i>p</i>. */
+        std::array<std::array<bitmove, max_search_ply>, max_search_ply> pv {};
+        std::array<int, max_search_ply> pv_length {};
+
+        /** Adds the nodes searched since the last flush to the shared node counter, if there is one. */
+        void flush_node_count() {
+            if (shared_nodes) shared_nodes->fetch_add(nodes - flushed_nodes, std::memory_order_relaxed);
+            flushed_nodes = nodes;
+        }
+
+        /** The number of nodes searched by every worker of the search, as far as this worker knows. */
+        [[nodiscard]] std::uint64_t total_nodes() const {
+            return shared_nodes ? shared_nodes->load(std::memory_order_relaxed) + (nodes - flushed_nodes) : nodes;
+        }
+
+        /**
+         * Checks the budgets and the stop signal, and publishes the node count. Called every
+         * <code>limit_check_interval</code> nodes, so the shared counter is written rarely enough not to contend.
+         */
+        void check_limits() {
+            flush_node_count();
+            if (stop_signal.load(std::memory_order_relaxed)) aborted = true;
+            if (limits.max_nodes && total_nodes() >= limits.max_nodes) aborted = true;
+            if (deadlines.is_timed && !is_pondering() && std::chrono::steady_clock::now() >= deadlines.hard) {
+                aborted = true;
+            }
+        }
+
+        /**
+         * Returns true while the search ponders, that is until the ponder signal is cleared. The opponent's clock
+         * runs while the search ponders, so the deadlines are computed afresh the moment it stops.
+         */
+        bool is_pondering() {
+            if (pondering && !ponder_signal->load(std::memory_order_relaxed)) {
+                pondering = false;
+                deadlines = compute_deadlines(limits, std::chrono::steady_clock::now());
+            }
+            return pondering;
+        }
+
+        void initialize_reductions() {
+            const search_parameters& parameters = limits.parameters;
+            for (std::size_t depth = 1; depth < reductions.size(); ++depth) {
+                for (std::size_t moves = 1; moves < reductions[depth].size(); ++moves) {
+                    const double reduction = parameters.lmr_base / 100.0 + std::log(static_cast<double>(depth)) *
+                                             std::log(static_cast<double>(moves)) * 100.0 / parameters.lmr_divisor;
+                    reductions[depth][moves] = static_cast<uint8_t>(std::clamp(reduction, 0.0, 63.0));
+                }
+            }
+        }
+
+        /** Returns true if the player to move has a piece besides pawns and the king, and so is rarely in zugzwang. */
+        template<piece_color us>
+        [[nodiscard]] bool has_non_pawn_material() const {
+            return position.color_bitboard[us] & ~(position.type_specific_bitboard[piece_type::pawn] |
+                                                   position.type_specific_bitboard[piece_type::king]);
+        }
+
+        /**
+         * Returns true if the position is drawn by repetition or by the fifty-move rule. Any repetition counts, not
+         * only a third occurrence, since a player who could repeat once could repeat again. A mate delivered on the
+         * move which completes the fifty moves stands.
+         */
+        template<piece_color us>
+        [[nodiscard]] bool is_draw() const {
+            if (is_repetition(position)) return true;
+            if (position.halfmove_clock < 100) return false;
+            if (!is_king_attacked(position, us)) return true;
+            move_buffer evasions;
+            generate_legal_moves<us>(position, evasions);
+            return evasions.size > 0;
+        }
+
+        int aspiration_search(const int depth, const int previous_score) {
+            if (depth < aspiration_min_depth) return search_root(-infinite_score, infinite_score, depth);
+            int delta = aspiration_initial_delta;
+            int alpha = std::max(previous_score - delta, -infinite_score);
+            int beta = std::min(previous_score + delta, infinite_score);
+            while (true) {
+                const int score = search_root(alpha, beta, depth);
+                if (aborted) return score;
+                if (score <= alpha) {
+                    alpha = std::max(score - delta, -infinite_score);
+                } else if (score >= beta) {
+                    beta = std::min(score + delta, infinite_score);
+                } else {
+                    return score;
+                }
+                delta *= 2;
+            }
+        }
+
+        /** Dispatches on the color of the side to move once, after which every ply knows its color statically. */
+        int search_root(const int alpha, const int beta, const int depth) {
+            return position.whos_turn == piece_color::white ? negamax<piece_color::white>(alpha, beta, depth, 0)
+                                                            : negamax<piece_color::black>(alpha, beta, depth, 0);
+        }
+
+        template<piece_color us>
+        int negamax(int alpha, const int beta, const int depth, const int ply) {
+            pv_length[ply] = 0;
+            if (ply > 0) {
+                if (is_draw<us>()) {
+                    count_event(instrumented_counter::draws);
+                    return 0;
+                }
+                // A player who can repeat a position can hold the draw, so the node is worth at least that.
+                if (alpha < 0 && has_upcoming_repetition(position)) {
+                    count_event(instrumented_counter::upcoming_repetitions);
+                    alpha = 0;
+                    if (alpha >= beta) return alpha;
+                }
+            }
+            // A horizon node is counted by the quiescence search alone.
+            if (depth <= 0) return quiescence<us>(alpha, beta, ply);
+            if ((++nodes & (limit_check_interval - 1)) == 0) check_limits();
+            if (aborted) return 0;
+            if (ply >= max_search_ply - 1) return evaluate(position, pawn_table);
+            count_event(instrumented_counter::nodes);
+
+            const bool is_pv = beta - alpha > 1;
+            bitmove tt_move = bitmove::null();
+            tt_data entry;
+            if (table.probe(position.hash, entry)) {
+                tt_move = entry.best_move;
+                const int tt_score = score_from_tt(entry.score, ply);
+                if (!is_pv && entry.depth >= depth
+                    && (entry.bound == tt_bound::exact_bound
+                        || (entry.bound == tt_bound::lower_bound && tt_score >= beta)
+                        || (entry.bound == tt_bound::upper_bound && tt_score <= alpha))) {
+                    count_event(instrumented_counter::tt_cutoffs);
+                    return tt_score;
+                }
+            }
+            const bitboard occupancy = position.color_bitboard[piece_color::white] |
+                                       position.color_bitboard[piece_color::black];
+            if (ply > 0 && active_tablebases
+                && static_cast<std::size_t>(std::popcount(occupancy)) <= active_tablebases->max_piece_count()) {
+                tablebase_wdl probed;
+                // A result the fifty-move rule may overturn is left to the search, which finds the zeroing moves.
+                if (active_tablebases->probe_wdl(position, probed)) {
+                    // The result is exact whatever the depth, so it is stored as deep as an entry goes.
+                    count_event(instrumented_counter::tablebase_hits);
+                    const int score = tablebase_score(probed, ply);
+                    table.store(position.hash, bitmove::null(), static_cast<int16_t>(score_to_tt(score, ply)),
+                                static_cast<int8_t>(max_search_ply - 1), tt_bound::exact_bound);
+                    return score;
+                }
+            }
+
+            const search_parameters& parameters = limits.parameters;
+            const bool in_check = is_king_attacked(position, us);
+            const bool is_selective = !is_pv && !in_check;
+            const int static_evaluation = is_selective ? evaluate(position, pawn_table) : 0;
+            if (is_selective && depth <= parameters.razoring_max_depth
+                && static_evaluation + parameters.razoring_margin * depth <= alpha) {
+                const int score = quiescence<us>(alpha, alpha + 1, ply);
+                if (aborted) return 0;
+                if (score <= alpha) {
+                    count_event(instrumented_counter::razoring_cutoffs);
+                    return score;
+                }
+            }
+            // Passing twice in a row proves nothing, and nor does passing in zugzwang, which is most likely when
+            // the player to move has nothing but pawns. A mate found after passing is not a mate.
+            if (is_selective && ply > 0 && depth >= parameters.null_move_min_depth && static_evaluation >= beta
+                && beta < tablebase_win_threshold && has_non_pawn_material<us>()
+                && !is_null_move(position.move_log.top())) {
+                const int reduction = parameters.null_move_reduction + depth / parameters.null_move_depth_divisor;
+                make_null_move(position);
+                table.prefetch(position.hash);
+                const int score = -negamax<!us>(-beta, -beta + 1, depth - 1 - reduction, ply + 1);
+                unmake_null_move(position);
+                if (aborted) return 0;
+                if (score >= beta) {
+                    count_event(instrumented_counter::null_move_cutoffs);
+                    return score >= tablebase_win_threshold ? beta : score;
+                }
+            }
+            const bool is_futile = is_selective && depth <= parameters.futility_max_depth
+                                   && alpha > -tablebase_win_threshold
+                                   && static_evaluation + parameters.futility_margin * depth <= alpha;
+
+            move_picker<us, search_position> picker(position, tt_move, killers[ply], history);
+            move_buffer quiets_tried;
+            const int original_alpha = alpha;
+            int best_score = -infinite_score;
+            bitmove best_move = bitmove::null();
+            int moves_searched = 0;
+            for (bitmove move; !(move = picker.next()).is_null();) {
+                const bool is_quiet = !is_capture_or_promotion(position, move);
+                const bool is_late = is_late_stage(picker.current_stage());
+                make_move<us>(move, position);
+                const bool gives_check = is_king_attacked(position, !us);
+                // A pruned move counts toward neither the reductions of the moves after it nor the best score, but it
+                // was still passed over for the move which cuts off, as far as the history is concerned.
+                if (is_futile && is_quiet && moves_searched > 0 && !gives_check) {
+                    unmake_move<us>(position);
+                    count_event(instrumented_counter::futility_prunes);
+                    quiets_tried.push(move);
+                    continue;
+                }
+                table.prefetch(position.hash);
+                int reduction = 0;
+                if (depth >= parameters.lmr_min_depth && moves_searched >= parameters.lmr_min_moves && is_late
+                    && !in_check && !gives_check) {
+                    reduction = reductions[std::min(depth, 63)][std::min(moves_searched, 63)] - is_pv;
+                    reduction = std::clamp(reduction, 0, depth - 2);
+                }
+                int score;
+                if (moves_searched == 0) {
+                    score = -negamax<!us>(-beta, -alpha, depth - 1, ply + 1);
+                } else {
+                    // Principal variation search: the first move is expected to be the best, so a null window
+                    // suffices to show each later move is no better. Should one raise alpha instead, it is searched
+                    // again, first at full depth if it was reduced, and then with the full window if it still
+                    // falls inside it.
+                    if (reduction > 0) count_event(instrumented_counter::late_move_reductions);
+                    score = -negamax<!us>(-alpha - 1, -alpha, depth - 1 - reduction, ply + 1);
+                    if (score > alpha && reduction > 0 && !aborted)
+                        score = -negamax<!us>(-alpha - 1, -alpha, depth - 1, ply + 1);
+                    if (score > alpha && score < beta && !aborted)
+                        score = -negamax<!us>(-beta, -alpha, depth - 1, ply + 1);
+                }
+                unmake_move<us>(position);
+                if (aborted) return 0;
+
+                if (score > best_score) {
+                    best_score = score;
+                    if (score > alpha) {
+                        alpha = score;
+                        best_move = move;
+                        pv[ply][0] = move;
+                        std::copy_n(pv[ply + 1].begin(), pv_length[ply + 1], pv[ply].begin() + 1);
+                        pv_length[ply] = pv_length[ply + 1] + 1;
+                        if (alpha >= beta) {
+                            count_event(instrumented_counter::beta_cutoffs);
+                            if (moves_searched == 0) count_event(instrumented_counter::first_move_beta_cutoffs);
+                            if (is_quiet) reward_quiet_cutoff<us>(move, quiets_tried, depth, ply);
+                            break;
+                        }
+                    }
+                }
+                if (is_quiet) quiets_tried.push(move);
+                ++moves_searched;
+            }
+
+            if (best_score == -infinite_score) return in_check ? -mate_score + ply : 0;
+
+            const tt_bound bound = best_score >= beta ? tt_bound::lower_bound
+                                 : best_score > original_alpha ? tt_bound::exact_bound : tt_bound::upper_bound;
+            table.store(position.hash, best_move, static_cast<int16_t>(score_to_tt(best_score, ply)),
+                        static_cast<int8_t>(depth), bound);
+            return best_score;
+        }
+
+        /**
+         * <p>Searches captures only, beneath the horizon of the main search, until the position is quiet enough for
+         * <code>evaluate</code> to be trusted.</p>
+         * <p>The player to move may always stand pat, declining every capture, so the static evaluation is a lower
+         * bound on the score. Captures which lose material by static exchange evaluation are never searched, and
+         * nor are captures which could not lift the score to alpha even if the victim were won for free, the
+         * margin for positional compensation notwithstanding. When in check, standing pat is not an option, and
+         * every evasion is searched instead.</p>
+         */
+        template<piece_color us>
+        int quiescence(int alpha, const int beta, const int ply) {
+            count_event(instrumented_counter::quiescence_nodes);
+            pv_length[ply] = 0;
+            if ((++nodes & (limit_check_interval - 1)) == 0) check_limits();
+            if (aborted) return 0;
+            if (ply >= max_search_ply - 1) return evaluate(position, pawn_table);
+
+            const bool in_check = is_king_attacked(position, us);
+            int best_score = -infinite_score;
+            int stand_pat = 0;
+            if (!in_check) {
+                stand_pat = evaluate(position, pawn_table);
+                if (stand_pat >= beta) return stand_pat;
+                alpha = std::max(alpha, stand_pat);
+                best_score = stand_pat;
+            }
+
+            move_picker<us, search_position> picker(position, bitmove::null(), killers[ply], history, in_check);
+            for (bitmove move; !(move = picker.next()).is_null();) {
+                if (!in_check && move.unpack_promotion() == piece_type::none) {
+                    const piece_type victim = position.occupier_type_lookup_table[move.unpack_destination()];
+                    const int victim_value = see_piece_values[victim == piece_type::none ? piece_type::pawn : victim];
+                    if (stand_pat + victim_value + delta_margin <= alpha) continue;
+                }
+                make_move<us>(move, position);
+                const int score = -quiescence<!us>(-beta, -alpha, ply + 1);
+                unmake_move<us>(position);
+                if (aborted) return 0;
+                if (score <= best_score) continue;
+                best_score = score;
+                if (score <= alpha) continue;
+                alpha = score;
+                pv[ply][0] = move;
+                std::copy_n(pv[ply + 1].begin(), pv_length[ply + 1], pv[ply].begin() + 1);
+                pv_length[ply] = pv_length[ply + 1] + 1;
+                if (alpha >= beta) break;
+            }
+            // In check, no evasion means checkmate. Out of check, a position without captures is simply quiet.
+            if (best_score == -infinite_score) return -mate_score + ply;
+            return best_score;
+        }
+
+        /**
+         * Records that the given quiet move caused a beta cutoff. It becomes the first killer move of the ply, and its
+         * history score rises, while the scores of the quiet moves tried before it and refuted fall by as much.
+         */
+        template<piece_color us>
+        void reward_quiet_cutoff(const bitmove move, const move_buffer& quiets_tried, const int depth, const int ply) {
+            if (killers[ply][0] != move) {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = move;
+            }
+            const int bonus = std::min(depth * depth, max_history_score / 8);
+            update_history(history[us][move.unpack_origin()][move.unpack_destination()], bonus);
+            for (const bitmove refuted : quiets_tried) {
+                update_history(history[us][refuted.unpack_origin()][refuted.unpack_destination()], -bonus);
+            }
+        }
+
+        /**
+         * Looks the root up in the book, and plays one of its moves if it has any, chosen at random by weight so that
+         * the engine varies its openings. The choice is seeded by the key of the position and the book seed of the
+         * limits, so that a given position and seed always give the same move.
+         */
+        bool probe_book_root(search_result& result) {
+            std::uint64_t state = position.hash ^ limits.book_seed;
+            bitmove move;
+            if (!active_book || !active_book->choose(position, splitmix64(state), move)) return false;
+            pv[0][0] = move;
+            pv_length[0] = 1;
+            result.best_move = move;
+            return true;
+        }
+
+        /**
+         * Looks the root up in the tables. If it is there, the search has nothing to add: the result is the move which
+         * keeps the best result by the shortest way to zeroing, see <code>tablebase_set::probe_root</code>. A result
+         * the fifty-move rule may overturn is left to the search.
+         */
+        bool probe_tablebase_root(search_result& result) {
+            bitmove move;
+            tablebase_result probed;
+            if (!active_tablebases || !active_tablebases->probe_root(position, move, probed)
+                || !is_clear_of_fifty_move_rule(probed, position.halfmove_clock)) {
+                return false;
+            }
+            count_event(instrumented_counter::tablebase_hits);
+            pv[0][0] = move;
+            pv_length[0] = 1;
+            result.best_move = move;
+            result.score = tablebase_score(probed.wdl, 0);
+            result.depth = 1;
+            return true;
+        }
+
+        /** A move to fall back upon should the budget expire before the first iteration completes. */
+        bitmove first_legal_move() {
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            return moves.size ? *moves.begin() : bitmove::null();
+        }
+
+        search_report make_report(const int depth, const int score) const {
+            return search_report {
+                .depth = depth,
+                .score = score,
+                .nodes = total_nodes(),
+                .elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start),
+                .hashfull = table.hashfull(),
+                .principal_variation = { pv[0].begin(), pv[0].begin() + pv_length[0] }
+            };
+        }
+};
+
+/**
+ * <h2>Lazy SMP</h2>
+ * <p>Searches the root with the given number of threads. Every thread runs its own <code>search_worker</code> on its
+ * own copy of the root position, and the threads communicate only through the shared transposition table. The
+ * results of one thread's search show up as table hits which shorten the others'.</p>
+ * <p>The calling thread becomes the main worker. It alone observes the limits, reports progress and decides the
+ * result. When it finishes, it stops the helpers.</p>
+ */
+inline search_result lazy_smp_search(const search_position& root, transposition_table& table,
+                                     const search_limits& limits, const unsigned thread_count, std::atomic<bool>& stop_signal,
+                                     const search_worker::report_callback& report,
+                                     const std::atomic<bool>* const ponder_signal = nullptr) {
+    std::atomic<std::uint64_t> shared_nodes = 0;
+    std::atomic<bool> helper_stop_signal = false;
+    std::vector<std::unique_ptr<search_worker>> helpers;
+    std::vector<std::thread> helper_threads;
+    // The helpers search with the same parameters as the main worker, but leave the budgets to it.
+    search_limits helper_limits = limits;
+    helper_limits.max_nodes = 0;
+    helper_limits.move_time = helper_limits.time_remaining = helper_limits.increment = std::chrono::milliseconds { 0 };
+    for (unsigned i = 1; i < thread_count; ++i) {
+        helpers.push_back(std::make_unique<search_worker>(root, table, helper_limits, helper_stop_signal,
+                                                          &shared_nodes, i));
+        helper_threads.emplace_back([&worker = *helpers.back()] { worker.iterative_deepening(nullptr); });
+    }
+    // The main worker is too large for the stack, as is each helper.
+    auto main_worker = std::make_unique<search_worker>(root, table, limits, stop_signal, &shared_nodes, 0,
+                                                       ponder_signal);
+    search_result result = main_worker->iterative_deepening(report);
+    helper_stop_signal = true;
+    for (std::thread& thread : helper_threads) thread.join();
+    result.nodes = shared_nodes.load();
+    return result;
+}
+
+/** Appends the decimal representation of the given integer to the given buffer. */
+template<typename integer_type>
+void append_integer(std::string& buffer, const integer_type value) {
+    std::array<char, 24> digits;
+    const auto [end, error] = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+    buffer.append(digits.data(), end);
+}
+
+/** Formats a search report as a UCI <code>info</code> line. */
+inline std::string format_search_report(const search_report& report) {
+    const auto milliseconds = static_cast<std::uint64_t>(report.elapsed.count());
+    std::string line = "info depth ";
+    append_integer(line, report.depth);
+    line += " score " + format_score(report.score) + " nodes ";
+    append_integer(line, report.nodes);
+    line += " nps ";
+    append_integer(line, milliseconds ? report.nodes * 1000 / milliseconds : report.nodes);
+    line += " hashfull ";
+    append_integer(line, report.hashfull);
+    line += " time ";
+    append_integer(line, milliseconds);
+    line += " pv";
+    for (const bitmove move : report.principal_variation) {
+        line += ' ';
+        line += to_long_algebraic(move);
+    }
+    return line;
+}
+
+/** Prints a search report as a UCI <code>info</code> line. */
+inline void print_search_report(const search_report& report) {
+    std::cout << format_search_report(report) << std::endl;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ * <h2>Simple Chess Computer</h2>
+ * <p>The engine as a header-only library: include this header for all of it, or the header of a part.</p>
+ */
+
+#include "board.hpp"
+#include "instrumentation.hpp"
+#include "nnue.hpp"
+#include "position.hpp"
+#include "move_generation.hpp"
+#include "repetition.hpp"
+#include "attack_batch.hpp"
+#include "compact_position.hpp"
+#include "notation.hpp"
+#include "packed_position.hpp"
+#include "transposition_table.hpp"
+#include "tablebase.hpp"
+#include "book.hpp"
+#include "perft.hpp"
+#include "evaluation.hpp"
+#include "search.hpp"
+#include "batch_analysis.hpp"
+#include "uci.hpp"
@@ -0,0 +1,1866 @@
+#pragma once
+
+/**
+ * <h2>Endgame Tablebases</h2>
+ * <p>Win, draw and loss tables with distances to zeroing for the endings of few pieces, their generation by
+ * retrograde analysis, and their probing from files mapped into memory on first use.</p>
+ * <p>Two formats are read: this library's own uncompressed tables, generated by <code>tablebase generate</code> for
+ * endings of up to four pieces, and the compressed Syzygy WDL and DTZ tables of up to seven.</p>
+ */
+
+#include "compact_position.hpp"
+#include "move_generation.hpp"
+#include "notation.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Material
+
+/** The most pieces, kings included, of any table. A table of <i>n</i> pieces has 2 * 64<sup>n</sup> entries. */
+constexpr std::size_t max_tablebase_pieces = 4;
+
+/** The most pieces, kings included, of any Syzygy table. */
+constexpr std::size_t max_syzygy_pieces = 7;
+
+/** The pieces besides the king, strongest first, in the order a material signature lists them. */
+constexpr std::array<piece_type, 5> tablebase_piece_order = {
+    piece_type::queen, piece_type::rook, piece_type::bishop, piece_type::knight, piece_type::pawn
+};
+
+/**
+ * <h2>Material Signature</h2>
+ * <p>The number of pieces of each color and type on the board, the kings aside. Each table holds the positions of
+ * one signature, and is named after it the way Syzygy tables are, the white pieces first, as in KRPvKR.</p>
+ * <p>A signature and its color-flipped counterpart share a table, which holds the positions of the <i>canonical</i>
+ * one of the two, whose white side is the stronger by <code>side_strength</code>. The positions of the other are
+ * probed by flipping the board vertically and swapping the colors.</p>
+ */
+struct tablebase_material {
+    std::array<std::array<uint8_t, 7>, 2> counts {};
+
+    [[nodiscard]] std::size_t piece_count() const {
+        std::size_t count = 2;
+        for (const piece_type type : tablebase_piece_order) count += counts[piece_color::white][type];
+        for (const piece_type type : tablebase_piece_order) count += counts[piece_color::black][type];
+        return count;
+    }
+
+    [[nodiscard]] std::size_t pawn_count() const {
+        return counts[piece_color::white][piece_type::pawn] + counts[piece_color::black][piece_type::pawn];
+    }
+
+    /** The number of pieces of the given side, then its count of each type strongest first. */
+    [[nodiscard]] std::array<uint8_t, 6> side_strength(const piece_color color) const {
+        std::array<uint8_t, 6> strength {};
+        for (std::size_t i = 0; i < tablebase_piece_order.size(); ++i) {
+            strength[0] += counts[color][tablebase_piece_order[i]];
+            strength[i + 1] = counts[color][tablebase_piece_order[i]];
+        }
+        return strength;
+    }
+
+    [[nodiscard]] bool is_canonical() const {
+        return side_strength(piece_color::white) >= side_strength(piece_color::black);
+    }
+
+    [[nodiscard]] tablebase_material flipped() const {
+        tablebase_material flipped;
+        flipped.counts[piece_color::white] = counts[piece_color::black];
+        flipped.counts[piece_color::black] = counts[piece_color::white];
+        return flipped;
+    }
+
+    /** A key unique to the signature, four bits for the count of each colored piece type. */
+    [[nodiscard]] std::uint64_t key() const {
+        std::uint64_t key = 0;
+        for (const piece_color color : { piece_color::white, piece_color::black }) {
+            for (const piece_type type : tablebase_piece_order) key = key << 4 | counts[color][type];
+        }
+        return key;
+    }
+
+    [[nodiscard]] std::string name() const {
+        std::string name;
+        for (const piece_color color : { piece_color::white, piece_color::black }) {
+            if (color == piece_color::black) name += 'v';
+            name += 'K';
+            for (const piece_type type : tablebase_piece_order) {
+                name.append(counts[color][type], fen_piece_symbols[piece_color::white][type]);
+            }
+        }
+        return name;
+    }
+};
+
+/**
+ * Reads a signature from its name, as written by <code>tablebase_material::name</code>, of at most as many pieces as
+ * a Syzygy table holds.
+ */
+[[nodiscard]] inline bool parse_tablebase_material(const std::string_view name, tablebase_material& material) {
+    material = {};
+    piece_color color = piece_color::white;
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        if (name[i] == 'v' && color == piece_color::white) {
+            color = piece_color::black;
+            continue;
+        }
+        const uint8_t code = fen_symbol_table[static_cast<unsigned char>(name[i])];
+        if (code == invalid_fen_symbol || static_cast<piece_color>(code >> 3) != piece_color::white) return false;
+        const auto type = static_cast<piece_type>(code & 0b111);
+        if (type != piece_type::king) ++material.counts[color][type];
+    }
+    return material.piece_count() <= max_syzygy_pieces && material.name() == name;
+}
+
+template<typename position_type>
+[[nodiscard]] tablebase_material material_of(const position_type& position) {
+    const std::array<bitboard, 2>& colors = color_bitboards(position);
+    const std::array<bitboard, 7>& types = piece_bitboards(position);
+    tablebase_material material;
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        for (const piece_type type : tablebase_piece_order) {
+            material.counts[color][type] = static_cast<uint8_t>(std::popcount(colors[color] & types[type]));
+        }
+    }
+    return material;
+}
+
+// Indexing
+
+/**
+ * <h2>Table Layout</h2>
+ * <p>The pieces of a canonical signature in the order their squares appear in an index: the white king, the other
+ * white pieces strongest first, then likewise for black. The lowest bit of an index is the side to move, and the
+ * six bits of each piece's square follow in turn. Pieces of the same color and type may appear in either order, so
+ * such a position appears under several indices, each holding the same entry.</p>
+ * <p>The tables are neither compressed nor reduced by symmetry, so indexing one is a handful of shifts followed by
+ * a single load.</p>
+ */
+struct tablebase_layout {
+    std::array<piece_color, max_tablebase_pieces> colors {};
+    std::array<piece_type, max_tablebase_pieces> types {};
+    uint8_t piece_count = 0;
+
+    [[nodiscard]] std::size_t entry_count() const { return std::size_t { 2 } << (6 * piece_count); }
+};
+
+[[nodiscard]] inline tablebase_layout tablebase_layout_of(const tablebase_material& material) {
+    tablebase_layout layout;
+    for (const piece_color color : { piece_color::white, piece_color::black }) {
+        layout.colors[layout.piece_count] = color;
+        layout.types[layout.piece_count++] = piece_type::king;
+        for (const piece_type type : tablebase_piece_order) {
+            for (uint8_t i = 0; i < material.counts[color][type]; ++i) {
+                layout.colors[layout.piece_count] = color;
+                layout.types[layout.piece_count++] = type;
+            }
+        }
+    }
+    return layout;
+}
+
+[[nodiscard]] constexpr uint8_t tablebase_square(const std::size_t index, const std::size_t piece) {
+    return (index >> (1 + 6 * piece)) & 0b111111;
+}
+
+[[nodiscard]] constexpr std::size_t with_tablebase_square(const std::size_t index, const std::size_t piece,
+                                                          const uint8_t sindex) {
+    const std::size_t shift = 1 + 6 * piece;
+    return (index & ~(std::size_t { 0b111111 } << shift)) | (std::size_t { sindex } << shift);
+}
+
+/**
+ * Computes the index of a position of the layout's signature, or, if <code>flip</code> is set, of its
+ * color-flipped counterpart.
+ */
+template<typename position_type>
+[[nodiscard]] std::size_t tablebase_index(const tablebase_layout& layout, const position_type& position,
+                                          const bool flip) {
+    const std::array<bitboard, 2>& colors = color_bitboards(position);
+    const std::array<bitboard, 7>& types = piece_bitboards(position);
+    std::size_t index = flip ? !position.whos_turn : position.whos_turn;
+    bitboard taken = 0;
+    for (std::size_t piece = 0; piece < layout.piece_count; ++piece) {
+        const piece_color color = flip ? !layout.colors[piece] : layout.colors[piece];
+        const auto sindex = static_cast<uint8_t>(std::countr_zero(colors[color] & types[layout.types[piece]] & ~taken));
+        taken |= sbitboard(sindex);
+        index |= std::size_t { flip ? static_cast<uint8_t>(sindex ^ 0b111000) : sindex } << (1 + 6 * piece);
+    }
+    return index;
+}
+
+/**
+ * Places the pieces of the given index on an otherwise empty board, without castling rights or an en-passant file.
+ * Returns false if the index names no legal position, because two pieces share a square, a pawn stands on the first
+ * or last rank, or the player not to move is in check.
+ */
+[[nodiscard]] inline bool decode_tablebase_index(const tablebase_layout& layout, const std::size_t index,
+                                                 compact_chess_position& position) {
+    position = {};
+    position.whos_turn = static_cast<piece_color>(index & 1);
+    position.enpassant_file = no_enpassant;
+    bitboard occupancy = 0;
+    for (std::size_t piece = 0; piece < layout.piece_count; ++piece) {
+        const uint8_t sindex = tablebase_square(index, piece);
+        if (occupancy & sbitboard(sindex)) return false;
+        if (layout.types[piece] == piece_type::pawn && (sindex < 8 || sindex >= 56)) return false;
+        occupancy |= sbitboard(sindex);
+        set_compact_square(position, sindex, layout.colors[piece], layout.types[piece]);
+    }
+    return !is_king_attacked(position, !position.whos_turn);
+}
+
+/**
+ * Makes the given move on a copy of a position, updating only the board, the side to move and the en-passant file,
+ * which is all that the tables read.
+ */
+[[nodiscard]] inline compact_chess_position tablebase_successor(const compact_chess_position& parent,
+                                                                const bitmove move) {
+    const auto [origin, destination, promote_to] = move.unpack_all();
+    const piece_color us = parent.whos_turn;
+    const piece_type moved_piece_type = piece_type_on(parent, origin);
+    const uint8_t target = lookup_target(origin, destination, moved_piece_type, piece_type_on(parent, destination),
+                                         us);
+    compact_chess_position child = parent;
+    set_compact_square(child, origin, us, piece_type::none);
+    set_compact_square(child, target, !us, piece_type::none);
+    set_compact_square(child, destination, us, promote_to != piece_type::none ? promote_to : moved_piece_type);
+    const bool is_double_push = (moved_piece_type == piece_type::pawn) &
+                                ((origin > destination ? origin - destination : destination - origin) == 16);
+    child.enpassant_file = is_double_push ? (origin & 0b111) : no_enpassant;
+    child.whos_turn = !us;
+    return child;
+}
+
+/** Whether the move captures en passant. */
+[[nodiscard]] inline bool is_enpassant_capture(const compact_chess_position& position, const bitmove move) {
+    if (position.enpassant_file == no_enpassant) return false;
+    const uint8_t target = coords_to_sindex(position.whos_turn == piece_color::white ? 5 : 2,
+                                            position.enpassant_file);
+    return move.unpack_destination() == target && piece_type_on(position, move.unpack_origin()) == piece_type::pawn;
+}
+
+// Entries
+
+enum class tablebase_wdl: int8_t { loss = -1, draw = 0, win = 1 };
+
+/** The result for the other player. */
+[[nodiscard]] constexpr tablebase_wdl operator-(const tablebase_wdl wdl) {
+    return static_cast<tablebase_wdl>(-static_cast<int8_t>(wdl));
+}
+
+/**
+ * What a table knows of a position, from the point of view of the player to move: its result under best play, and
+ * the number of plies until the next zeroing move, a capture or pawn move, or else until mate. A checkmated position
+ * is a loss at distance zero. The winner plays to zero as soon as possible, and the loser to put it off.
+ */
+struct tablebase_result {
+    tablebase_wdl wdl;
+    uint8_t dtz;
+};
+
+/** Whether the first result is the better for the player to move, the distances breaking ties. */
+[[nodiscard]] constexpr bool is_better_tablebase_result(const tablebase_result& a, const tablebase_result& b) {
+    if (a.wdl != b.wdl) return a.wdl > b.wdl;
+    if (a.wdl == tablebase_wdl::win) return a.dtz < b.dtz;
+    return a.wdl == tablebase_wdl::loss && a.dtz > b.dtz;
+}
+
+/**
+ * The byte a table stores for each position: zero for a draw, the distance for a win, and -1 less the distance for a
+ * loss. Entries of indices naming no legal position are zero.
+ */
+using tablebase_entry = int8_t;
+
+/**
+ * Whether the fifty-move rule leaves the result of a position with the given halfmove clock as the tables have it: a
+ * win or loss stands only when its zeroing move comes before a draw could be claimed. The distance is that to the
+ * first zeroing move only, so one which stands may still be spoiled further on.
+ */
+[[nodiscard]] constexpr bool is_clear_of_fifty_move_rule(const tablebase_result& result, const int halfmove_clock) {
+    return result.wdl == tablebase_wdl::draw || result.dtz + halfmove_clock <= 100;
+}
+
+/** The longest distance to zeroing an entry can hold. */
+constexpr uint8_t max_tablebase_dtz = 127;
+
+[[nodiscard]] constexpr tablebase_result decode_tablebase_entry(const tablebase_entry entry) {
+    if (entry > 0) return { tablebase_wdl::win, static_cast<uint8_t>(entry) };
+    if (entry < 0) return { tablebase_wdl::loss, static_cast<uint8_t>(-1 - entry) };
+    return { tablebase_wdl::draw, 0 };
+}
+
+[[nodiscard]] constexpr tablebase_entry encode_tablebase_entry(const tablebase_result result) {
+    if (result.wdl == tablebase_wdl::win) return static_cast<tablebase_entry>(result.dtz);
+    if (result.wdl == tablebase_wdl::loss) return static_cast<tablebase_entry>(-1 - result.dtz);
+    return 0;
+}
+
+// Table Files
+
+/**
+ * <h2>Table File</h2>
+ * <p>A table file is named after its signature, as in KRvK.sctb. It begins with this 64 byte header, followed by the
+ * <code>tablebase_entry</code> of every index of its layout, in order.</p>
+ */
+struct tablebase_file_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t piece_count;
+    std::uint64_t entry_count;
+    std::array<char, 16> material;
+    std::array<std::uint8_t, 24> reserved;
+};
+static_assert(sizeof(tablebase_file_header) == 64);
+
+constexpr std::array<char, 8> tablebase_file_magic = { 'S', 'C', 'C', 'T', 'B', '\0', '\0', '\0' };
+constexpr std::uint32_t tablebase_file_version = 1;
+constexpr std::string_view tablebase_file_extension = ".sctb";
+
+// Syzygy Tables
+
+constexpr std::string_view syzygy_wdl_extension = ".rtbw";
+constexpr std::string_view syzygy_dtz_extension = ".rtbz";
+constexpr std::array<uint8_t, 4> syzygy_wdl_magic = { 0x71, 0xE8, 0x23, 0x5D };
+constexpr std::array<uint8_t, 4> syzygy_dtz_magic = { 0xD7, 0x66, 0x0C, 0xA5 };
+
+/**
+ * The result a Syzygy table stores, from the point of view of the player to move. A cursed win is won only if the
+ * fifty-move rule is ignored, and a blessed loss likewise lost, so under the rule, from a zeroed clock, both are draws.
+ */
+enum class syzygy_wdl: int8_t { loss = -2, blessed_loss = -1, draw = 0, cursed_win = 1, win = 2 };
+
+[[nodiscard]] constexpr syzygy_wdl operator-(const syzygy_wdl wdl) {
+    return static_cast<syzygy_wdl>(-static_cast<int8_t>(wdl));
+}
+
+/** The distance to zeroing of a position whose best move zeroes, signed as in a DTZ table. */
+[[nodiscard]] constexpr int syzygy_dtz_before_zeroing(const syzygy_wdl wdl) {
+    switch (wdl) {
+        case syzygy_wdl::win: return 1;
+        case syzygy_wdl::cursed_win: return 101;
+        case syzygy_wdl::blessed_loss: return -101;
+        case syzygy_wdl::loss: return -1;
+        default: return 0;
+    }
+}
+
+/** The code of each piece type in a Syzygy file, to which a black piece adds eight. */
+constexpr std::array<uint8_t, 6> syzygy_piece_codes = { 4, 2, 3, 5, 6, 1 };
+
+[[nodiscard]] constexpr uint8_t syzygy_piece_code(const piece_color color, const piece_type type) {
+    return syzygy_piece_codes[type] | (color == piece_color::black ? 8 : 0);
+}
+
+template<typename integer_type>
+[[nodiscard]] constexpr integer_type read_little_endian(const uint8_t* bytes) {
+    integer_type value = 0;
+    for (std::size_t i = sizeof(integer_type); i-- > 0;) value = static_cast<integer_type>(value << 8 | bytes[i]);
+    return value;
+}
+
+template<typename integer_type>
+[[nodiscard]] constexpr integer_type read_big_endian(const uint8_t* bytes) {
+    integer_type value = 0;
+    for (std::size_t i = 0; i < sizeof(integer_type); ++i) value = static_cast<integer_type>(value << 8 | bytes[i]);
+    return value;
+}
+
+/** How far a square lies above the a1-h8 diagonal, negative below it. */
+[[nodiscard]] constexpr int syzygy_diagonal_offset(const uint8_t sindex) {
+    return static_cast<int>(sindex >> 3) - static_cast<int>(sindex & 0b111);
+}
+
+/**
+ * <h2>Syzygy Index Tables</h2>
+ * <p>The numbering by which a Syzygy table turns the placement of its pieces into an index. A pawnless table moves
+ * its leading piece into the a1-d1-d4 triangle by symmetry, and either numbers the placements of both kings together
+ * or, when at least three pieces are unique, of the first three. A table with pawns splits by the file, a to d, of its
+ * leading pawn, and numbers the placements of the pawns of the leading color from those of the leading pawn.</p>
+ */
+struct syzygy_index_tables {
+    /** The number of each pawn square a2-h7 in the order leading pawns are chosen, edge files and low ranks last. */
+    std::array<int, 64> pawn_squares {};
+
+    /** The number of each square below the a1-h8 diagonal, 0 to 27. */
+    std::array<int, 64> below_diagonal_squares {};
+
+    /** The number of each square of the a1-d1-d4 triangle, those below the diagonal first, 0 to 9. */
+    std::array<int, 64> triangle_squares {};
+
+    /** The number of each of the 462 placements of two kings, the first in the triangle, by triangle square. */
+    std::array<std::array<int, 64>, 10> king_placements {};
+
+    /** The number of ways to choose <i>k</i> of <i>n</i> squares, by <i>k</i> and <i>n</i>. */
+    std::array<std::array<std::uint64_t, 64>, 6> binomials {};
+
+    /** The first index of each square of the leading pawn, by the number of leading pawns. */
+    std::array<std::array<std::uint64_t, 64>, 6> lead_pawn_indices {};
+
+    /** The number of placements of the leading pawns, by their number and the file of the leading one. */
+    std::array<std::array<std::uint64_t, 4>, 6> lead_pawn_placements {};
+};
+
+consteval syzygy_index_tables generate_syzygy_index_tables() {
+    syzygy_index_tables tables;
+    int code = 0;
+    for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+        if (syzygy_diagonal_offset(sindex) < 0) tables.below_diagonal_squares[sindex] = code++;
+    }
+    code = 0;
+    for (uint8_t sindex = 0; sindex < 64; ++sindex) {
+        if (syzygy_diagonal_offset(sindex) < 0 && (sindex & 0b111) <= 3 && (sindex >> 3) <= 3) {
+            tables.triangle_squares[sindex] = code++;
+        }
+    }
+    for (uint8_t sindex = 0; sindex <= 27; sindex += 9) tables.triangle_squares[sindex] = code++;
+
+    // Placements with both kings on the diagonal are numbered last.
+    std::array<std::pair<int, uint8_t>, 64> on_diagonal {};
+    std::size_t on_diagonal_count = 0;
+    code = 0;
+    for (int triangle = 0; triangle < 10; ++triangle) {
+        for (uint8_t first = 0; first <= 27; ++first) {
+            const bool is_in_triangle = (first & 0b111) <= 3 && syzygy_diagonal_offset(first) <= 0;
+            if (!is_in_triangle || tables.triangle_squares[first] != triangle) continue;
+            for (uint8_t second = 0; second < 64; ++second) {
+                const int rank_distance = (first >> 3) - (second >> 3);
+                const int file_distance = (first & 0b111) - (second & 0b111);
+                if (rank_distance >= -1 && rank_distance <= 1 && file_distance >= -1 && file_distance <= 1) continue;
+                if (syzygy_diagonal_offset(first) == 0 && syzygy_diagonal_offset(second) > 0) continue;
+                if (syzygy_diagonal_offset(first) == 0 && syzygy_diagonal_offset(second) == 0) {
+                    on_diagonal[on_diagonal_count++] = { triangle, second };
+                } else {
+                    tables.king_placements[triangle][second] = code++;
+                }
+            }
+        }
+    }
+    for (std::size_t i = 0; i < on_diagonal_count; ++i) {
+        tables.king_placements[on_diagonal[i].first][on_diagonal[i].second] = code++;
+    }
+
+    tables.binomials[0][0] = 1;
+    for (std::size_t n = 1; n < 64; ++n) {
+        for (std::size_t k = 0; k < 6 && k <= n; ++k) {
+            tables.binomials[k][n] = (k > 0 ? tables.binomials[k - 1][n - 1] : 0) +
+                                     (k < n ? tables.binomials[k][n - 1] : 0);
+        }
+    }
+
+    int available_squares = 47;
+    for (std::size_t lead_pawns = 1; lead_pawns <= 5; ++lead_pawns) {
+        for (uint8_t file = 0; file < 4; ++file) {
+            std::uint64_t index = 0;
+            for (uint8_t rank = 1; rank <= 6; ++rank) {
+                const uint8_t sindex = coords_to_sindex(rank, file);
+                if (lead_pawns == 1) {
+                    tables.pawn_squares[sindex] = available_squares--;
+                    tables.pawn_squares[sindex ^ 0b111] = available_squares--;
+                }
+                tables.lead_pawn_indices[lead_pawns][sindex] = index;
+                index += tables.binomials[lead_pawns - 1][tables.pawn_squares[sindex]];
+            }
+            tables.lead_pawn_placements[lead_pawns][file] = index;
+        }
+    }
+    return tables;
+}
+
+inline constinit syzygy_index_tables syzygy_indexing = generate_syzygy_index_tables();
+
+/**
+ * <h2>Syzygy Pairs Data</h2>
+ * <p>One compressed sequence of a Syzygy file: the values of every index for one side to move and, in a table with
+ * pawns, one file of the leading pawn. The values are compressed by recursive pairing, which replaces the commonest
+ * adjacent pair of symbols by a new symbol over and over, and the symbols are then Huffman coded into blocks of a
+ * fixed size. A sparse index gives the block and offset of every <code>span</code>-th value, so that reading a value
+ * decodes the one block holding it.</p>
+ */
+struct syzygy_pairs {
+    enum flag: uint8_t {
+        side_to_move = 1, is_mapped = 2, has_win_plies = 4, has_loss_plies = 8, is_wide = 16, is_single_value = 128
+    };
+
+    uint8_t flags = 0;
+
+    /** The shortest Huffman code, or, in a sequence of a single value, that value. */
+    uint8_t min_code_length = 0;
+
+    std::size_t block_size = 0;
+    std::size_t span = 0;
+    std::uint32_t block_count = 0;
+    std::size_t block_length_count = 0;
+    std::size_t sparse_index_size = 0;
+
+    /** The lowest symbol of each code length, shortest first, little-endian 16 bit each. */
+    const uint8_t* lowest_symbols = nullptr;
+
+    /** The two symbols each symbol pairs, twelve bits each in three bytes, or the value of a leaf and 0xFFF. */
+    const uint8_t* symbol_tree = nullptr;
+
+    /** The block and offset within it of every <code>span</code>-th value, six bytes each. */
+    const uint8_t* sparse_index = nullptr;
+
+    /** The number of values of each block less one, little-endian 16 bit each. */
+    const uint8_t* block_lengths = nullptr;
+
+    const uint8_t* blocks = nullptr;
+
+    /** The lowest code of each length, shortest first, left-aligned in 64 bits. */
+    std::vector<std::uint64_t> code_bases;
+
+    /** The number of values each symbol expands to, less one. */
+    std::vector<uint8_t> symbol_lengths;
+
+    /** The pieces in the order their squares are indexed, which sets the groups. */
+    std::array<uint8_t, max_syzygy_pieces> pieces {};
+
+    /** The number of pieces of each group, the leading group first, ending with zero. */
+    std::array<int, max_syzygy_pieces + 1> group_lengths {};
+
+    /** The factor of each group in an index, the last entry past the groups being the number of indices. */
+    std::array<std::uint64_t, max_syzygy_pieces + 1> group_factors {};
+
+    /** The start of the distances of wins, losses, cursed wins and blessed losses in a DTZ file's map. */
+    std::array<uint16_t, 4> dtz_map_starts {};
+
+    [[nodiscard]] std::uint32_t left_symbol(const std::uint32_t symbol) const {
+        const uint8_t* node = symbol_tree + 3 * symbol;
+        return (node[1] & 0xF) << 8 | node[0];
+    }
+
+    [[nodiscard]] std::uint32_t right_symbol(const std::uint32_t symbol) const {
+        const uint8_t* node = symbol_tree + 3 * symbol;
+        return node[2] << 4 | node[1] >> 4;
+    }
+
+    [[nodiscard]] int block_length(const std::uint32_t block) const {
+        return read_little_endian<uint16_t>(block_lengths + 2 * std::size_t { block });
+    }
+
+    [[nodiscard]] std::uint64_t index_count() const {
+        std::size_t group = 0;
+        while (group_lengths[group]) ++group;
+        return group_factors[group];
+    }
+
+    /**
+     * Reads the code lengths and the symbol tree which begin at the given address, returning the address past them,
+     * or null if they run past the end.
+     */
+    const uint8_t* set_up(const uint8_t* data, const uint8_t* end) {
+        if (end - data < 2) return nullptr;
+        flags = *data++;
+        if (flags & is_single_value) {
+            min_code_length = *data++;
+            return data;
+        }
+        if (end - data < 10) return nullptr;
+        const uint8_t block_size_bits = *data++;
+        const uint8_t span_bits = *data++;
+        if (block_size_bits >= 32 || span_bits == 0 || span_bits >= 32) return nullptr;
+        block_size = std::size_t { 1 } << block_size_bits;
+        span = std::size_t { 1 } << span_bits;
+        sparse_index_size = static_cast<std::size_t>((index_count() + span - 1) / span);
+        const uint8_t padding = *data++;
+        block_count = read_little_endian<std::uint32_t>(data);
+        data += 4;
+        block_length_count = std::size_t { block_count } + padding;
+        const uint8_t max_code_length = *data++;
+        min_code_length = *data++;
+        if (min_code_length == 0 || max_code_length < min_code_length || max_code_length > 32) return nullptr;
+        const std::size_t length_count = max_code_length - min_code_length + 1;
+        if (end - data < static_cast<std::ptrdiff_t>(2 * length_count + 2)) return nullptr;
+        lowest_symbols = data;
+
+        // Longer codes are numerically lower, and the symbols of each length consecutive, so that halving the next
+        // longer lowest code, less the number of its symbols, gives the lowest code of every length.
+        code_bases.assign(length_count, 0);
+        for (std::size_t i = length_count - 1; i-- > 0;) {
+            code_bases[i] = (code_bases[i + 1] + read_little_endian<uint16_t>(lowest_symbols + 2 * i)
+                             - read_little_endian<uint16_t>(lowest_symbols + 2 * i + 2)) / 2;
+        }
+        for (std::size_t i = 0; i < length_count; ++i) code_bases[i] <<= 64 - i - min_code_length;
+        data += 2 * length_count;
+        const std::size_t symbol_count = read_little_endian<uint16_t>(data);
+        data += 2;
+        if (end - data < static_cast<std::ptrdiff_t>(3 * symbol_count + 1)) return nullptr;
+        symbol_tree = data;
+        symbol_lengths.assign(symbol_count, 0);
+        std::vector<bool> visited(symbol_count);
+        for (std::uint32_t symbol = 0; symbol < symbol_count; ++symbol) count_symbol_values(symbol, visited);
+        return data + 3 * symbol_count + (symbol_count & 1);
+    }
+
+    /** Sets the length of a symbol, and of the symbols it pairs, which precede it in the tree. */
+    void count_symbol_values(const std::uint32_t symbol, std::vector<bool>& visited) {
+        if (visited[symbol]) return;
+        visited[symbol] = true;
+        const std::uint32_t right = right_symbol(symbol);
+        if (right == 0xFFF) return;
+        const std::uint32_t left = left_symbol(symbol);
+        if (left >= symbol_lengths.size() || right >= symbol_lengths.size()) return;
+        count_symbol_values(left, visited);
+        count_symbol_values(right, visited);
+        symbol_lengths[symbol] = static_cast<uint8_t>(symbol_lengths[left] + symbol_lengths[right] + 1);
+    }
+
+    /** Decodes the value of the given index. */
+    [[nodiscard]] int decompress(const std::uint64_t index) const {
+        if (flags & is_single_value) return min_code_length;
+
+        // The sparse entry nearest the index is that of the value at the middle of its span, from which the block
+        // lengths lead to the block holding the index.
+        const std::size_t entry = static_cast<std::size_t>(index / span);
+        std::uint32_t block = read_little_endian<std::uint32_t>(sparse_index + 6 * entry);
+        int offset = read_little_endian<uint16_t>(sparse_index + 6 * entry + 4);
+        offset += static_cast<int>(index % span) - static_cast<int>(span / 2);
+        while (offset < 0) offset += block_length(--block) + 1;
+        while (offset > block_length(block)) offset -= block_length(block++) + 1;
+
+        // Each symbol of the block stands for one value more than its symbol length, so the symbols are decoded
+        // until the one holding the offset.
+        const uint8_t* next = blocks + std::size_t { block } * block_size;
+        std::uint64_t buffer = read_big_endian<std::uint64_t>(next);
+        next += 8;
+        int buffered = 64;
+        std::uint32_t symbol = 0;
+        while (true) {
+            std::size_t length = 0;
+            while (buffer < code_bases[length]) ++length;
+            symbol = static_cast<std::uint32_t>((buffer - code_bases[length]) >> (64 - length - min_code_length));
+            symbol += read_little_endian<uint16_t>(lowest_symbols + 2 * length);
+            if (offset < symbol_lengths[symbol] + 1) break;
+            offset -= symbol_lengths[symbol] + 1;
+            length += min_code_length;
+            buffer <<= length;
+            buffered -= static_cast<int>(length);
+            if (buffered <= 32) {
+                buffered += 32;
+                buffer |= std::uint64_t { read_big_endian<std::uint32_t>(next) } << (64 - buffered);
+                next += 4;
+            }
+        }
+
+        // The pairs of a symbol are adjacent, so the offset leads down the tree to the leaf holding the value.
+        while (symbol_lengths[symbol]) {
+            const std::uint32_t left = left_symbol(symbol);
+            if (offset < symbol_lengths[left] + 1) {
+                symbol = left;
+            } else {
+                offset -= symbol_lengths[left] + 1;
+                symbol = right_symbol(symbol);
+            }
+        }
+        return static_cast<int>(left_symbol(symbol));
+    }
+};
+
+/**
+ * <h2>Syzygy Table</h2>
+ * <p>One Syzygy file, WDL (.rtbw) or DTZ (.rtbz), of the signature it is named after. Its white side is the first of
+ * the name; positions of the color-flipped signature, and, if both sides hold the same pieces, positions with black
+ * to move, are probed by flipping the board vertically and swapping the colors. A DTZ file holds only one side to
+ * move of each sequence.</p>
+ * <p>The file is mapped read-only and its sequences set up the first time it is probed.</p>
+ */
+class syzygy_table {
+    private:
+        enum header_flag: uint8_t { is_split = 1, has_pawns_flag = 2 };
+
+        std::string path;
+        bool is_dtz;
+        std::size_t piece_count = 0;
+        bool has_pawns = false;
+        bool has_unique_pieces = false;
+        bool is_symmetric = false;
+
+        /** The pawns of the leading color, then of the other. The leading color is that with fewer pawns but some. */
+        std::array<uint8_t, 2> pawn_counts {};
+
+        /** The number of pieces of each code, to check the pieces of each sequence by. */
+        std::array<uint8_t, 16> piece_code_counts {};
+
+        std::once_flag mapped;
+        void* mapping = nullptr;
+        std::size_t mapping_size = 0;
+        bool is_set_up = false;
+
+        /** The sequences, by side to move and by file of the leading pawn. */
+        std::array<std::array<syzygy_pairs, 4>, 2> sequences;
+
+        const uint8_t* dtz_map = nullptr;
+
+        [[nodiscard]] std::size_t file_count() const { return has_pawns ? 4 : 1; }
+        [[nodiscard]] std::size_t side_count() const { return !is_dtz && !is_symmetric ? 2 : 1; }
+
+        /** Splits the pieces of a sequence into groups and finds the factor of each in an index. */
+        void set_up_groups(syzygy_pairs& pairs, const std::array<int, 2>& order, const std::size_t file) const {
+            int first_length = has_pawns ? 0 : has_unique_pieces ? 3 : 2;
+            std::size_t group = 0;
+            pairs.group_lengths[0] = 1;
+            for (std::size_t i = 1; i < piece_count; ++i) {
+                if (--first_length > 0 || pairs.pieces[i] == pairs.pieces[i - 1]) {
+                    ++pairs.group_lengths[group];
+                } else {
+                    pairs.group_lengths[++group] = 1;
+                }
+            }
+            pairs.group_lengths[++group] = 0;
+
+            // The groups are laid out in the index in the file's order, the leading group at order[0] and the pawns
+            // of the other color, if any, at order[1].
+            const bool has_both_pawns = has_pawns && pawn_counts[1];
+            std::size_t next = has_both_pawns ? 2 : 1;
+            int free_squares = 64 - pairs.group_lengths[0] - (has_both_pawns ? pairs.group_lengths[1] : 0);
+            std::uint64_t factor = 1;
+            for (int k = 0; next < group || k == order[0] || k == order[1]; ++k) {
+                if (k == order[0]) {
+                    pairs.group_factors[0] = factor;
+                    factor *= has_pawns ? syzygy_indexing.lead_pawn_placements[pairs.group_lengths[0]][file]
+                                        : has_unique_pieces ? 31332 : 462;
+                } else if (k == order[1]) {
+                    pairs.group_factors[1] = factor;
+                    factor *= syzygy_indexing.binomials[pairs.group_lengths[1]][48 - pairs.group_lengths[0]];
+                } else {
+                    pairs.group_factors[next] = factor;
+                    factor *= syzygy_indexing.binomials[pairs.group_lengths[next]][free_squares];
+                    free_squares -= pairs.group_lengths[next++];
+                }
+            }
+            pairs.group_factors[group] = factor;
+        }
+
+        [[nodiscard]] bool has_table_pieces(const syzygy_pairs& pairs) const {
+            std::array<uint8_t, 16> counts {};
+            for (std::size_t i = 0; i < piece_count; ++i) ++counts[pairs.pieces[i]];
+            return counts == piece_code_counts && (!has_pawns || (pairs.pieces[0] & 0b111) == syzygy_piece_codes[
+                piece_type::pawn]);
+        }
+
+        /** Reads the layout of the file which follows its magic. Returns false if it is not of this table. */
+        bool set_up(const uint8_t* begin, const uint8_t* end) {
+            const auto* base = static_cast<const uint8_t*>(mapping);
+            const auto align = [base](const uint8_t* data, const std::size_t alignment) {
+                const auto misalignment = static_cast<std::size_t>(data - base) & (alignment - 1);
+                return misalignment ? data + (alignment - misalignment) : data;
+            };
+            const uint8_t* data = begin;
+            const uint8_t header = *data++;
+            if (static_cast<bool>(header & has_pawns_flag) != has_pawns
+                || static_cast<bool>(header & is_split) == is_symmetric) {
+                return false;
+            }
+            const bool has_both_pawns = has_pawns && pawn_counts[1];
+            for (std::size_t file = 0; file < file_count(); ++file) {
+                if (end - data < static_cast<std::ptrdiff_t>(1 + has_both_pawns + piece_count)) return false;
+                const std::array<std::array<int, 2>, 2> orders = {{
+                    { data[0] & 0xF, has_both_pawns ? data[1] & 0xF : 0xF },
+                    { data[0] >> 4, has_both_pawns ? data[1] >> 4 : 0xF }
+                }};
+                data += 1 + has_both_pawns;
+                for (std::size_t i = 0; i < piece_count; ++i, ++data) {
+                    for (std::size_t side = 0; side < side_count(); ++side) {
+                        sequences[side][file].pieces[i] = side ? *data >> 4 : *data & 0xF;
+                    }
+                }
+                for (std::size_t side = 0; side < side_count(); ++side) {
+                    if (!has_table_pieces(sequences[side][file])) return false;
+                    set_up_groups(sequences[side][file], orders[side], file);
+                }
+            }
+            data = align(data, 2);
+            for (std::size_t file = 0; file < file_count(); ++file) {
+                for (std::size_t side = 0; side < side_count(); ++side) {
+                    if (!(data = sequences[side][file].set_up(data, end))) return false;
+                }
+            }
+            if (is_dtz) {
+                dtz_map = data;
+                for (std::size_t file = 0; file < file_count(); ++file) {
+                    syzygy_pairs& pairs = sequences[0][file];
+                    if (!(pairs.flags & syzygy_pairs::is_mapped)) continue;
+                    if (pairs.flags & syzygy_pairs::is_wide) data = align(data, 2);
+                    for (uint16_t& start : pairs.dtz_map_starts) {
+                        if (end - data < 2) return false;
+                        if (pairs.flags & syzygy_pairs::is_wide) {
+                            start = static_cast<uint16_t>((data - dtz_map) / 2 + 1);
+                            data += 2 * std::size_t { read_little_endian<uint16_t>(data) } + 2;
+                        } else {
+                            start = static_cast<uint16_t>(data - dtz_map + 1);
+                            data += std::size_t { *data } + 1;
+                        }
+                    }
+                }
+                data = align(data, 2);
+            }
+            for (std::size_t file = 0; file < file_count(); ++file) {
+                for (std::size_t side = 0; side < side_count(); ++side) {
+                    sequences[side][file].sparse_index = data;
+                    data += 6 * sequences[side][file].sparse_index_size;
+                }
+            }
+            for (std::size_t file = 0; file < file_count(); ++file) {
+                for (std::size_t side = 0; side < side_count(); ++side) {
+                    sequences[side][file].block_lengths = data;
+                    data += 2 * sequences[side][file].block_length_count;
+                }
+            }
+            for (std::size_t file = 0; file < file_count(); ++file) {
+                for (std::size_t side = 0; side < side_count(); ++side) {
+                    data = align(data, 64);
+                    sequences[side][file].blocks = data;
+                    data += sequences[side][file].block_count * sequences[side][file].block_size;
+                }
+            }
+            return data <= end;
+        }
+
+        /** Maps the file. If it cannot be mapped, or is not this table, the table stays unset. */
+        void map() {
+            const int descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0) return;
+            struct stat status {};
+            if (::fstat(descriptor, &status) == 0 && status.st_size % 64 == 16) {
+                mapping_size = static_cast<std::size_t>(status.st_size);
+                mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapping == MAP_FAILED) mapping = nullptr;
+            }
+            ::close(descriptor);
+            if (!mapping) return;
+            const auto* data = static_cast<const uint8_t*>(mapping);
+            const std::array<uint8_t, 4>& magic = is_dtz ? syzygy_dtz_magic : syzygy_wdl_magic;
+            is_set_up = std::equal(magic.begin(), magic.end(), data) && set_up(data + 4, data + mapping_size);
+        }
+
+        /**
+         * Finds the sequence and index of a position, or, if <code>flip</code> is set, of its color-flipped
+         * counterpart. Returns false if the table is a DTZ table holding the other side to move.
+         */
+        bool locate(const compact_chess_position& position, bool flip, const syzygy_pairs*& pairs,
+                    std::size_t& file, std::uint64_t& index) const {
+            const syzygy_index_tables& tables = syzygy_indexing;
+            const std::array<bitboard, 2> colors = color_bitboards(position);
+            const std::array<bitboard, 7> types = piece_bitboards(position);
+            flip = flip || (is_symmetric && position.whos_turn == piece_color::black);
+            const uint8_t flip_colors = flip ? 8 : 0;
+            const uint8_t flip_squares = flip ? 0b111000 : 0;
+            const std::size_t side = flip ^ (position.whos_turn == piece_color::black);
+            const auto by_pawn_square = [&tables](const uint8_t a, const uint8_t b) {
+                return tables.pawn_squares[a] < tables.pawn_squares[b];
+            };
+
+            // The leading pawn is the one toward the edge of the lowest rank, and its file chooses the sequence.
+            std::array<uint8_t, max_syzygy_pieces> squares {};
+            std::array<uint8_t, max_syzygy_pieces> pieces {};
+            std::size_t size = 0;
+            bitboard lead_pawns = 0;
+            file = 0;
+            if (has_pawns) {
+                const auto lead_color = static_cast<piece_color>(!((sequences[0][0].pieces[0] ^ flip_colors) & 8));
+                lead_pawns = colors[lead_color] & types[piece_type::pawn];
+                for (bitboard pawns = lead_pawns; pawns; pawns &= pawns - 1) {
+                    squares[size++] = static_cast<uint8_t>(std::countr_zero(pawns) ^ flip_squares);
+                }
+                std::swap(squares[0], *std::max_element(squares.begin(), squares.begin() + size, by_pawn_square));
+                file = std::min(squares[0] & 0b111, 7 - (squares[0] & 0b111));
+            }
+            const std::size_t lead_pawn_count = size;
+            if (is_dtz && (sequences[0][file].flags & syzygy_pairs::side_to_move) != side
+                && !(is_symmetric && !has_pawns)) {
+                return false;
+            }
+            for (bitboard rest = (colors[0] | colors[1]) & ~lead_pawns; rest; rest &= rest - 1) {
+                const auto sindex = static_cast<uint8_t>(std::countr_zero(rest));
+                const piece_color color = (colors[piece_color::white] & sbitboard(sindex)) ? piece_color::white
+                                                                                            : piece_color::black;
+                squares[size] = sindex ^ flip_squares;
+                pieces[size++] = syzygy_piece_code(color, piece_type_on(position, sindex)) ^ flip_colors;
+            }
+            pairs = &sequences[is_dtz ? 0 : side][file];
+
+            // The pieces are put in the sequence's order, then moved by symmetry so that the leading one is in the
+            // a1-d1-d4 triangle, or, for a pawn, on files a to d.
+            for (std::size_t i = lead_pawn_count; i + 1 < size; ++i) {
+                for (std::size_t j = i + 1; j < size; ++j) {
+                    if (pairs->pieces[i] == pieces[j]) {
+                        std::swap(pieces[i], pieces[j]);
+                        std::swap(squares[i], squares[j]);
+                        break;
+                    }
+                }
+            }
+            if ((squares[0] & 0b111) > 3) {
+                for (std::size_t i = 0; i < size; ++i) squares[i] ^= 0b111;
+            }
+            if (has_pawns) {
+                index = tables.lead_pawn_indices[lead_pawn_count][squares[0]];
+                std::stable_sort(squares.begin() + 1, squares.begin() + lead_pawn_count, by_pawn_square);
+                for (std::size_t i = 1; i < lead_pawn_count; ++i) {
+                    index += tables.binomials[i][tables.pawn_squares[squares[i]]];
+                }
+            } else {
+                if ((squares[0] >> 3) > 3) {
+                    for (std::size_t i = 0; i < size; ++i) squares[i] ^= 0b111000;
+                }
+                for (int i = 0; i < pairs->group_lengths[0]; ++i) {
+                    if (!syzygy_diagonal_offset(squares[i])) continue;
+                    if (syzygy_diagonal_offset(squares[i]) > 0) {
+                        for (std::size_t j = i; j < size; ++j) squares[j] = rotate_sindex(squares[j]);
+                    }
+                    break;
+                }
+                index = has_unique_pieces ? unique_pieces_index(squares)
+                                          : tables.king_placements[tables.triangle_squares[squares[0]]][squares[1]];
+            }
+
+            // Each further group is numbered by its squares in ascending order, each counted among the squares left
+            // free by the groups before it.
+            index *= pairs->group_factors[0];
+            bool is_remaining_pawns = has_pawns && pawn_counts[1];
+            std::size_t begin = pairs->group_lengths[0];
+            for (std::size_t group = 1; pairs->group_lengths[group]; ++group) {
+                const auto length = static_cast<std::size_t>(pairs->group_lengths[group]);
+                for (std::size_t i = begin + 1; i < begin + length; ++i) {
+                    for (std::size_t j = i; j > begin && squares[j - 1] > squares[j]; --j) {
+                        std::swap(squares[j - 1], squares[j]);
+                    }
+                }
+                std::uint64_t placement = 0;
+                for (std::size_t i = 0; i < length; ++i) {
+                    const uint8_t sindex = squares[begin + i];
+                    const auto preceding = std::count_if(squares.begin(), squares.begin() + begin,
+                                                         [sindex](const uint8_t other) { return sindex > other; });
+                    placement += tables.binomials[i + 1][sindex - preceding - 8 * is_remaining_pawns];
+                }
+                is_remaining_pawns = false;
+                index += placement * pairs->group_factors[group];
+                begin += length;
+            }
+            return true;
+        }
+
+        /** Numbers the placement of three unique leading pieces, the first below the diagonal or on it. */
+        [[nodiscard]] static std::uint64_t unique_pieces_index(const std::array<uint8_t, max_syzygy_pieces>& squares) {
+            const syzygy_index_tables& tables = syzygy_indexing;
+            const int first_adjust = squares[1] > squares[0];
+            const int second_adjust = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (syzygy_diagonal_offset(squares[0])) {
+                return (tables.triangle_squares[squares[0]] * 63 + (squares[1] - first_adjust)) * 62 +
+                       squares[2] - second_adjust;
+            }
+            if (syzygy_diagonal_offset(squares[1])) {
+                return (6 * 63 + (squares[0] >> 3) * 28 + tables.below_diagonal_squares[squares[1]]) * 62 +
+                       squares[2] - second_adjust;
+            }
+            if (syzygy_diagonal_offset(squares[2])) {
+                return 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] >> 3) * 7 * 28 + ((squares[1] >> 3) - first_adjust) * 28
+                       + tables.below_diagonal_squares[squares[2]];
+            }
+            return 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (squares[0] >> 3) * 7 * 6
+                   + ((squares[1] >> 3) - first_adjust) * 6 + ((squares[2] >> 3) - second_adjust);
+        }
+
+    public:
+        syzygy_table(std::string path, const tablebase_material& material, const bool is_dtz)
+            : path(std::move(path)), is_dtz(is_dtz), piece_count(material.piece_count()),
+              has_pawns(material.pawn_count() > 0), is_symmetric(material.key() == material.flipped().key()) {
+            for (const piece_color color : { piece_color::white, piece_color::black }) {
+                ++piece_code_counts[syzygy_piece_code(color, piece_type::king)];
+                for (const piece_type type : tablebase_piece_order) {
+                    piece_code_counts[syzygy_piece_code(color, type)] += material.counts[color][type];
+                    has_unique_pieces |= material.counts[color][type] == 1;
+                }
+            }
+            const uint8_t white_pawns = material.counts[piece_color::white][piece_type::pawn];
+            const uint8_t black_pawns = material.counts[piece_color::black][piece_type::pawn];
+            const bool leads_white = !black_pawns || (white_pawns && black_pawns >= white_pawns);
+            pawn_counts = leads_white ? std::array<uint8_t, 2> { white_pawns, black_pawns }
+                                      : std::array<uint8_t, 2> { black_pawns, white_pawns };
+        }
+
+        syzygy_table(const syzygy_table&) = delete;
+        syzygy_table& operator=(const syzygy_table&) = delete;
+
+        ~syzygy_table() {
+            if (mapping) ::munmap(mapping, mapping_size);
+        }
+
+        /** Maps the file on the first call. Returns false if it is missing or malformed. */
+        [[nodiscard]] bool is_ready() {
+            std::call_once(mapped, [this] { map(); });
+            return is_set_up;
+        }
+
+        /** Reads the result a WDL table stores for a position, or, if <code>flip</code> is set, its counterpart. */
+        [[nodiscard]] syzygy_wdl probe_wdl(const compact_chess_position& position, const bool flip) const {
+            const syzygy_pairs* pairs = nullptr;
+            std::size_t file = 0;
+            std::uint64_t index = 0;
+            locate(position, flip, pairs, file, index);
+            return static_cast<syzygy_wdl>(pairs->decompress(index) - 2);
+        }
+
+        /**
+         * Reads the distance to zeroing in plies a DTZ table stores for a position of the given result, unsigned.
+         * Returns false if the table holds the other side to move.
+         */
+        [[nodiscard]] bool probe_dtz(const compact_chess_position& position, const bool flip, const syzygy_wdl wdl,
+                                     int& dtz) const {
+            const syzygy_pairs* pairs = nullptr;
+            std::size_t file = 0;
+            std::uint64_t index = 0;
+            if (!locate(position, flip, pairs, file, index)) return false;
+            dtz = pairs->decompress(index);
+            const syzygy_pairs& layout = sequences[0][file];
+            if (layout.flags & syzygy_pairs::is_mapped) {
+                constexpr std::array<std::size_t, 5> map_of_result = { 1, 3, 0, 2, 0 };
+                const std::size_t start = layout.dtz_map_starts[map_of_result[static_cast<int>(wdl) + 2]];
+                dtz = layout.flags & syzygy_pairs::is_wide
+                      ? read_little_endian<uint16_t>(dtz_map + 2 * (start + static_cast<std::size_t>(dtz)))
+                      : dtz_map[start + static_cast<std::size_t>(dtz)];
+            }
+
+            // Distances stored in moves rather than plies are doubled, and those of cursed wins and blessed losses
+            // always are.
+            if ((wdl == syzygy_wdl::win && !(layout.flags & syzygy_pairs::has_win_plies))
+                || (wdl == syzygy_wdl::loss && !(layout.flags & syzygy_pairs::has_loss_plies))
+                || wdl == syzygy_wdl::cursed_win || wdl == syzygy_wdl::blessed_loss) {
+                dtz *= 2;
+            }
+            dtz += 1;
+            return true;
+        }
+};
+
+/**
+ * <h2>Tablebase Set</h2>
+ * <p>The tables found in one or more directories: tables of this library's own format and Syzygy tables, of which
+ * the former are probed first. Opening the set only lists the directories. Each table is mapped into memory
+ * read-only the first time a position of its signature is probed, so opening even a large set is instant, and only
+ * the tables a game actually reaches are ever mapped, let alone paged in. Probing is safe from any number of
+ * threads.</p>
+ * <p>The tables know nothing of castling, so a position with castling rights is never found in them. Nor do they
+ * know of repetitions. The results and distances of this library's tables are those of play without the fifty-move
+ * rule; see <code>is_clear_of_fifty_move_rule</code> for when the rule leaves a result standing. Those of Syzygy
+ * tables are those of play under the rule from a zeroed clock, so their cursed wins and blessed losses are draws,
+ * and their distances may exceed the true ones by a ply.</p>
+ */
+class tablebase_set {
+    private:
+        struct table_file {
+            std::string path;
+            tablebase_layout layout;
+            std::once_flag mapped;
+            void* mapping = nullptr;
+            std::size_t mapping_size = 0;
+            const tablebase_entry* entries = nullptr;
+        };
+
+        /** The WDL and, if present, DTZ files of a Syzygy signature. */
+        struct syzygy_files {
+            std::unique_ptr<syzygy_table> wdl;
+            std::unique_ptr<syzygy_table> dtz;
+        };
+
+        std::unordered_map<std::uint64_t, std::unique_ptr<table_file>> tables;
+        std::unordered_map<std::uint64_t, syzygy_files> syzygy_tables;
+        std::size_t max_pieces = 0;
+
+        /** Maps the file of the given table. If it cannot be mapped, or is not the table, its entries remain null. */
+        static void map_table(table_file& table) {
+            const int descriptor = ::open(table.path.c_str(), O_RDONLY);
+            if (descriptor < 0) return;
+            const std::size_t file_size = sizeof(tablebase_file_header) + table.layout.entry_count();
+            struct stat status {};
+            if (::fstat(descriptor, &status) == 0 && static_cast<std::size_t>(status.st_size) == file_size) {
+                table.mapping_size = file_size;
+                table.mapping = ::mmap(nullptr, table.mapping_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (table.mapping == MAP_FAILED) table.mapping = nullptr;
+            }
+            ::close(descriptor);
+            if (!table.mapping) return;
+            const auto* header = static_cast<const tablebase_file_header*>(table.mapping);
+            if (header->magic != tablebase_file_magic || header->version != tablebase_file_version
+                || header->piece_count != table.layout.piece_count
+                || header->entry_count != table.layout.entry_count()) {
+                return;
+            }
+            table.entries = reinterpret_cast<const tablebase_entry*>(header + 1);
+        }
+
+        /** Whether the signature of the given material has a table of this library's format. */
+        [[nodiscard]] bool has_own_table(const tablebase_material& material) const {
+            return tables.contains(material.key()) || tables.contains(material.flipped().key());
+        }
+
+        /**
+         * Finds the Syzygy files of the given material, setting <code>flip</code> if they are those of its
+         * color-flipped counterpart. Returns null if there are none.
+         */
+        [[nodiscard]] const syzygy_files* find_syzygy_files(const tablebase_material& material, bool& flip) const {
+            flip = false;
+            auto files = syzygy_tables.find(material.key());
+            if (files == syzygy_tables.end()) {
+                flip = true;
+                files = syzygy_tables.find(material.flipped().key());
+                if (files == syzygy_tables.end()) return nullptr;
+            }
+            return &files->second;
+        }
+
+        [[nodiscard]] static bool is_checkmate(const compact_chess_position& position) {
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            return moves.size == 0 && is_king_attacked(position, position.whos_turn);
+        }
+
+        /** Reads the result the WDL tables store for a position, with no move searched. */
+        [[nodiscard]] bool probe_syzygy_wdl_table(const compact_chess_position& position, syzygy_wdl& wdl) const {
+            const tablebase_material material = material_of(position);
+            if (material.piece_count() == 2) {
+                wdl = syzygy_wdl::draw;
+                return true;
+            }
+            bool flip = false;
+            const syzygy_files* files = find_syzygy_files(material, flip);
+            if (!files || !files->wdl->is_ready()) return false;
+            wdl = files->wdl->probe_wdl(position, flip);
+            return true;
+        }
+
+        /**
+         * Reads the distance to zeroing the DTZ tables store for a position of the given result, signed as the
+         * result. Sets <code>is_other_side</code>, leaving the distance, if they hold the other side to move.
+         */
+        [[nodiscard]] bool probe_syzygy_dtz_table(const compact_chess_position& position, const syzygy_wdl wdl,
+                                                  int& dtz, bool& is_other_side) const {
+            bool flip = false;
+            const syzygy_files* files = find_syzygy_files(material_of(position), flip);
+            if (!files || !files->dtz || !files->dtz->is_ready()) return false;
+            is_other_side = !files->dtz->probe_dtz(position, flip, wdl, dtz);
+            if (is_other_side) return true;
+            const bool is_cursed = wdl == syzygy_wdl::cursed_win || wdl == syzygy_wdl::blessed_loss;
+            dtz = (dtz + 100 * is_cursed) * (wdl > syzygy_wdl::draw ? 1 : -1);
+            return true;
+        }
+
+        /**
+         * Finds the result of a position under its captures, and, if asked, its pawn moves: the tables do not hold
+         * positions with an en-passant file, and the result they store for a position whose best move zeroes may be
+         * any. Sets <code>zeroes_best</code> if such a move keeps the best result, the tables going unread should
+         * every move be one.
+         */
+        [[nodiscard]] bool search_syzygy_wdl(const compact_chess_position& position, const bool with_pawn_moves,
+                                             syzygy_wdl& wdl, bool& zeroes_best) const {
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            syzygy_wdl best = syzygy_wdl::loss;
+            std::size_t zeroing_count = 0;
+            for (const bitmove move : moves) {
+                const bool is_capture = piece_type_on(position, move.unpack_destination()) != piece_type::none
+                                        || is_enpassant_capture(position, move);
+                if (!is_capture
+                    && (!with_pawn_moves || piece_type_on(position, move.unpack_origin()) != piece_type::pawn)) {
+                    continue;
+                }
+                ++zeroing_count;
+                syzygy_wdl child = syzygy_wdl::draw;
+                bool child_zeroes_best = false;
+                if (!search_syzygy_wdl(tablebase_successor(position, move), false, child, child_zeroes_best)) {
+                    return false;
+                }
+                if (-child > best) {
+                    best = -child;
+                    if (best == syzygy_wdl::win) {
+                        wdl = best;
+                        zeroes_best = true;
+                        return true;
+                    }
+                }
+            }
+            const bool is_every_move_zeroing = zeroing_count > 0 && zeroing_count == moves.size;
+            syzygy_wdl stored = best;
+            if (!is_every_move_zeroing && !probe_syzygy_wdl_table(position, stored)) return false;
+            zeroes_best = best >= stored && (best > syzygy_wdl::draw || is_every_move_zeroing);
+            wdl = std::max(best, stored);
+            return true;
+        }
+
+        /**
+         * Finds the result of a position and its distance to zeroing in plies, signed as the result. A DTZ table
+         * holding only the other side to move is read one move on, the winner taking the shortest way to zeroing
+         * and the loser the longest.
+         */
+        [[nodiscard]] bool probe_syzygy_dtz(const compact_chess_position& position, syzygy_wdl& wdl, int& dtz) const {
+            bool zeroes_best = false;
+            if (!search_syzygy_wdl(position, true, wdl, zeroes_best)) return false;
+            if (wdl == syzygy_wdl::draw || zeroes_best) {
+                dtz = syzygy_dtz_before_zeroing(wdl);
+                return true;
+            }
+            bool is_other_side = false;
+            if (!probe_syzygy_dtz_table(position, wdl, dtz, is_other_side)) return false;
+            if (!is_other_side) return true;
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            int best = std::numeric_limits<int>::max();
+            for (const bitmove move : moves) {
+                const bool is_zeroing = piece_type_on(position, move.unpack_origin()) == piece_type::pawn
+                                        || piece_type_on(position, move.unpack_destination()) != piece_type::none;
+                const compact_chess_position child = tablebase_successor(position, move);
+                syzygy_wdl child_wdl = syzygy_wdl::draw;
+                int child_dtz = 0;
+                if (is_zeroing) {
+                    // A zeroing move is one ply from zeroing whatever follows, so only its result counts.
+                    bool child_zeroes_best = false;
+                    if (!search_syzygy_wdl(child, false, child_wdl, child_zeroes_best)) return false;
+                    child_dtz = -syzygy_dtz_before_zeroing(child_wdl);
+                } else if (is_checkmate(child)) {
+                    child_dtz = 1;
+                } else {
+                    if (!probe_syzygy_dtz(child, child_wdl, child_dtz)) return false;
+                    child_dtz = -child_dtz;
+                    child_dtz += (child_dtz > 0) - (child_dtz < 0);
+                }
+                if (child_dtz != 0 && (child_dtz > 0) == (wdl > syzygy_wdl::draw) && child_dtz < best) {
+                    best = child_dtz;
+                }
+            }
+            dtz = best == std::numeric_limits<int>::max() ? -1 : best;
+            return true;
+        }
+
+        /** Reads the result of a position whose signature has Syzygy tables. */
+        [[nodiscard]] bool probe_syzygy(const compact_chess_position& position, tablebase_result& result) const {
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            if (moves.size == 0) {
+                const bool is_mated = is_king_attacked(position, position.whos_turn);
+                result = { is_mated ? tablebase_wdl::loss : tablebase_wdl::draw, 0 };
+                return true;
+            }
+            syzygy_wdl wdl = syzygy_wdl::draw;
+            int dtz = 0;
+            if (!probe_syzygy_dtz(position, wdl, dtz)) return false;
+            if (wdl == syzygy_wdl::win || wdl == syzygy_wdl::loss) {
+                result = { wdl == syzygy_wdl::win ? tablebase_wdl::win : tablebase_wdl::loss,
+                           static_cast<uint8_t>(std::min(std::abs(dtz), 255)) };
+            } else {
+                result = { tablebase_wdl::draw, 0 };
+            }
+            return true;
+        }
+
+    public:
+        tablebase_set() = default;
+
+        /**
+         * Lists the tables of the given directories, separated by colons. A directory which does not exist holds no
+         * tables, and of two Syzygy tables of the same name the first found is kept.
+         */
+        explicit tablebase_set(const std::string& directories) {
+            std::size_t begin = 0;
+            while (begin <= directories.size()) {
+                const std::size_t end = std::min(directories.find(':', begin), directories.size());
+                std::error_code error;
+                for (const auto& file : std::filesystem::directory_iterator(directories.substr(begin, end - begin),
+                                                                            error)) {
+                    const std::filesystem::path& path = file.path();
+                    if (path.extension() == tablebase_file_extension) add_table(path.string());
+                    if (path.extension() == syzygy_wdl_extension) add_syzygy_table(path.string());
+                }
+                begin = end + 1;
+            }
+        }
+
+        tablebase_set(const tablebase_set&) = delete;
+        tablebase_set& operator=(const tablebase_set&) = delete;
+
+        ~tablebase_set() {
+            for (const auto& [key, table] : tables) {
+                if (table->mapping) ::munmap(table->mapping, table->mapping_size);
+            }
+        }
+
+        /**
+         * Adds the table in the given file, which must be named after a canonical signature, without mapping it.
+         * No other thread may probe meanwhile.
+         */
+        bool add_table(const std::string& path) {
+            tablebase_material material;
+            if (!parse_tablebase_material(std::filesystem::path(path).stem().string(), material)
+                || material.piece_count() > max_tablebase_pieces || !material.is_canonical()) {
+                return false;
+            }
+            auto table = std::make_unique<table_file>();
+            table->path = path;
+            table->layout = tablebase_layout_of(material);
+            tables[material.key()] = std::move(table);
+            max_pieces = std::max(max_pieces, material.piece_count());
+            return true;
+        }
+
+        /**
+         * Adds the Syzygy WDL table in the given file, and the DTZ table beside it, if any, without mapping them.
+         * No other thread may probe meanwhile.
+         */
+        bool add_syzygy_table(const std::string& path) {
+            tablebase_material material;
+            const std::filesystem::path wdl_path(path);
+            if (!parse_tablebase_material(wdl_path.stem().string(), material) || material.piece_count() < 3) {
+                return false;
+            }
+            bool flip = false;
+            if (find_syzygy_files(material, flip)) return false;
+            syzygy_files& files = syzygy_tables[material.key()];
+            files.wdl = std::make_unique<syzygy_table>(path, material, false);
+            std::filesystem::path dtz_path = wdl_path;
+            dtz_path.replace_extension(syzygy_dtz_extension);
+            std::error_code error;
+            if (std::filesystem::exists(dtz_path, error)) {
+                files.dtz = std::make_unique<syzygy_table>(dtz_path.string(), material, true);
+            }
+            max_pieces = std::max(max_pieces, material.piece_count());
+            return true;
+        }
+
+        [[nodiscard]] std::size_t table_count() const { return tables.size() + syzygy_tables.size(); }
+
+        /** The number of pieces, kings included, of the largest table. Positions of more pieces are never probed. */
+        [[nodiscard]] std::size_t max_piece_count() const { return max_pieces; }
+
+        /**
+         * Reads the result of the given position as if it had no en-passant file, from the tables of this library's
+         * format. Returns false if the position has castling rights, or if the table of its signature is missing or
+         * malformed. Bare kings are always drawn.
+         */
+        template<typename position_type>
+        [[nodiscard]] bool probe_ignoring_enpassant(const position_type& position, tablebase_result& result) const {
+            if (position.castling_rights) return false;
+            const tablebase_material material = material_of(position);
+            if (material.piece_count() == 2) {
+                result = { tablebase_wdl::draw, 0 };
+                return true;
+            }
+            if (material.piece_count() > max_pieces) return false;
+            bool flip = false;
+            auto table = tables.find(material.key());
+            if (table == tables.end()) {
+                flip = true;
+                table = tables.find(material.flipped().key());
+                if (table == tables.end()) return false;
+            }
+            table_file& file = *table->second;
+            std::call_once(file.mapped, map_table, file);
+            if (!file.entries) return false;
+            result = decode_tablebase_entry(file.entries[tablebase_index(file.layout, position, flip)]);
+            return true;
+        }
+
+        /**
+         * Improves upon the result of a position with an en-passant file, as probed ignoring that file, by the
+         * en-passant captures it allows. Should those captures be the only legal moves, the position ignoring the
+         * file is mate or stalemate, and the result is that of the best capture instead. Returns false if a position
+         * a capture leads to is not in the tables.
+         */
+        [[nodiscard]] bool apply_enpassant_captures(const compact_chess_position& position,
+                                                    tablebase_result& result) const {
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            tablebase_result best_capture { tablebase_wdl::loss, 0 };
+            std::size_t capture_count = 0;
+            for (const bitmove move : moves) {
+                if (!is_enpassant_capture(position, move)) continue;
+                tablebase_result child;
+                if (!probe_ignoring_enpassant(tablebase_successor(position, move), child)) return false;
+                const tablebase_wdl wdl = -child.wdl;
+                const tablebase_result capture { wdl, static_cast<uint8_t>(wdl != tablebase_wdl::draw) };
+                if (capture_count++ == 0 || is_better_tablebase_result(capture, best_capture)) best_capture = capture;
+            }
+            const bool is_forced = capture_count == moves.size;
+            if (capture_count > 0 && (is_forced || is_better_tablebase_result(best_capture, result))) {
+                result = best_capture;
+            }
+            return true;
+        }
+
+        /** Reads the result of the given position. Returns false if it is not in the tables. */
+        template<typename position_type>
+        [[nodiscard]] bool probe(const position_type& position, tablebase_result& result) const {
+            if (position.castling_rights) return false;
+            const tablebase_material material = material_of(position);
+            bool flip = false;
+            if (!has_own_table(material) && find_syzygy_files(material, flip)) {
+                return probe_syzygy(to_compact_position(position), result);
+            }
+            if (!probe_ignoring_enpassant(position, result)) return false;
+            if (position.enpassant_file == no_enpassant) return true;
+            return apply_enpassant_captures(to_compact_position(position), result);
+        }
+
+        /**
+         * Reads the result of the given position as the fifty-move rule leaves it at the position's halfmove clock.
+         * Returns false if it is not in the tables, or if the rule may yet overturn it. A win or loss of a Syzygy
+         * table stands as it is right after a zeroing move, so only at a later ply do its distances need reading.
+         */
+        template<typename position_type>
+        [[nodiscard]] bool probe_wdl(const position_type& position, tablebase_wdl& wdl) const {
+            if (position.castling_rights) return false;
+            const tablebase_material material = material_of(position);
+            bool flip = false;
+            tablebase_result result {};
+            if (has_own_table(material) || !find_syzygy_files(material, flip)) {
+                if (!probe(position, result) || !is_clear_of_fifty_move_rule(result, position.halfmove_clock)) {
+                    return false;
+                }
+                wdl = result.wdl;
+                return true;
+            }
+            const compact_chess_position compact = to_compact_position(position);
+            syzygy_wdl stored = syzygy_wdl::draw;
+            bool zeroes_best = false;
+            if (!search_syzygy_wdl(compact, false, stored, zeroes_best)) return false;
+            if (stored != syzygy_wdl::win && stored != syzygy_wdl::loss) {
+                wdl = tablebase_wdl::draw;
+                return true;
+            }
+            if (position.halfmove_clock != 0
+                && (!probe_syzygy(compact, result) || !is_clear_of_fifty_move_rule(result, position.halfmove_clock))) {
+                return false;
+            }
+            wdl = stored == syzygy_wdl::win ? tablebase_wdl::win : tablebase_wdl::loss;
+            return true;
+        }
+
+        /**
+         * <p>Finds the best move of the given position by the tables: one which keeps the best result and, of those,
+         * when winning, the one which zeroes soonest, and when losing, the one which puts it off longest. Playing
+         * these moves wins every won position, since the distance falls with each move of the winner until a zeroing
+         * move, and a game holds only so many zeroing moves.</p>
+         * <p>Returns false if the position has no legal moves, or if it or a position a move leads to is not in the
+         * tables.</p>
+         */
+        template<typename position_type>
+        [[nodiscard]] bool probe_root(const position_type& position, bitmove& best_move,
+                                      tablebase_result& best) const {
+            if (position.castling_rights || material_of(position).piece_count() > max_pieces) return false;
+            const compact_chess_position root = to_compact_position(position);
+            move_buffer moves;
+            generate_legal_moves(root, moves);
+            best_move = bitmove::null();
+            for (const bitmove move : moves) {
+                tablebase_result child;
+                if (!probe(tablebase_successor(root, move), child)) return false;
+                const bool is_zeroing = piece_type_on(root, move.unpack_origin()) == piece_type::pawn
+                                        || piece_type_on(root, move.unpack_destination()) != piece_type::none;
+                const tablebase_wdl wdl = -child.wdl;
+                const tablebase_result result {
+                    wdl, static_cast<uint8_t>(wdl == tablebase_wdl::draw ? 0 : is_zeroing ? 1 : child.dtz + 1)
+                };
+                if (best_move.is_null() || is_better_tablebase_result(result, best)) {
+                    best_move = move;
+                    best = result;
+                }
+            }
+            return !best_move.is_null();
+        }
+};
+
+/**
+ * The tables probed by the search, or null when none were opened. Like <code>active_network</code>, it is set while
+ * no search runs, and never changes during one.
+ */
+inline const tablebase_set* active_tablebases = nullptr;
+
+// Generation
+
+/** A summary of a generated table, counting each legal position once per index it appears under. */
+struct tablebase_statistics {
+    std::uint64_t wins = 0;
+    std::uint64_t draws = 0;
+    std::uint64_t losses = 0;
+    uint8_t longest_win = 0;
+};
+
+/**
+ * <h2>Table Generator</h2>
+ * <p>Solves one canonical signature by retrograde analysis, given a set holding the tables of the signatures its
+ * captures and promotions lead to.</p>
+ * <p>The first pass visits every index, generating the legal moves of its position. A position without moves is
+ * mated or stalemated. The result of each capture and promotion is read from the smaller tables, and every other
+ * move is counted. Thereafter, each position found lost makes every position one unmove away won, and each position
+ * found won discounts one move of every position one unmove away, which is lost once no moves remain besides losing
+ * captures and promotions. Whatever is never resolved is drawn.</p>
+ * <p>The second pass finds the distances to zeroing level by level in the same way, pawn unmoves excepted. It begins
+ * with the mated positions, the positions won by a zeroing move, and the lost positions whose every move zeroes.</p>
+ * <p>A double push may allow an en-passant capture, which the index of the position it leads to does not record. The
+ * result of such a push is that of the position it leads to, unless the capture is better for the opponent.</p>
+ */
+class tablebase_generator {
+    private:
+        enum position_flag: uint8_t {
+            is_legal = 0b00001,
+            is_resolved = 0b00010,
+            has_zeroing_moves = 0b00100,
+            has_pawn_pushes = 0b01000,
+            has_distance = 0b10000
+        };
+
+        const tablebase_set& smaller;
+        tablebase_layout layout;
+        std::vector<uint8_t> flags;
+        std::vector<tablebase_wdl> results;
+        std::vector<uint8_t> distances;
+
+        /** The moves of each position within the table which are not yet refuted, in the first pass. */
+        std::vector<uint8_t> unrefuted_moves;
+
+        /** The moves of each position which neither capture, promote nor move a pawn, in the second pass. */
+        std::vector<uint8_t> quiet_moves;
+
+        /** The best result each position reaches by a capture or promotion. */
+        std::vector<tablebase_wdl> best_conversions;
+
+        std::vector<std::uint32_t> resolved;
+        std::vector<std::vector<std::uint32_t>> levels;
+        bool is_complete = true;
+
+        void resolve(const std::size_t index, const tablebase_wdl result) {
+            flags[index] |= is_resolved;
+            results[index] = result;
+            if (result != tablebase_wdl::draw) resolved.push_back(static_cast<std::uint32_t>(index));
+        }
+
+        void set_distance(const std::size_t index, const std::size_t distance) {
+            if (distance > max_tablebase_dtz) {
+                is_complete = false;
+                return;
+            }
+            flags[index] |= has_distance;
+            distances[index] = static_cast<uint8_t>(distance);
+            if (levels.size() <= distance) levels.resize(distance + 1);
+            levels[distance].push_back(static_cast<std::uint32_t>(index));
+        }
+
+        /**
+         * The best result the player to move in a position just reached by a double push gets by capturing en
+         * passant, or a loss if no such capture is legal.
+         */
+        tablebase_wdl enpassant_floor(const compact_chess_position& position) {
+            tablebase_result result { tablebase_wdl::loss, 0 };
+            if (position.enpassant_file == no_enpassant) return result.wdl;
+            if (!smaller.apply_enpassant_captures(position, result)) is_complete = false;
+            return result.wdl;
+        }
+
+        /**
+         * Whether the only legal moves of the given position capture en passant. The result of such a position is
+         * that of its best capture, rather than the mate or stalemate its index holds.
+         */
+        [[nodiscard]] static bool has_only_enpassant_moves(const compact_chess_position& position) {
+            if (position.enpassant_file == no_enpassant) return false;
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            for (const bitmove move : moves) {
+                if (!is_enpassant_capture(position, move)) return false;
+            }
+            return moves.size > 0;
+        }
+
+        /**
+         * Calls the visitor with the index of every legal position from which a move of the player not to move leads
+         * to the given position, and with whether that move is a double push. Captures and promotions are never
+         * unmade, and pawn moves only if asked.
+         */
+        template<typename visitor_type>
+        void for_each_unmove(const std::size_t index, const compact_chess_position& position, const bool with_pawns,
+                             visitor_type&& visit) const {
+            const piece_color mover = !position.whos_turn;
+            const bitboard occupancy = compact_occupancy(position);
+            const std::size_t parent = index ^ 1;
+            for (std::size_t piece = 0; piece < layout.piece_count; ++piece) {
+                if (layout.colors[piece] != mover) continue;
+                const uint8_t sindex = tablebase_square(index, piece);
+                bitboard origins = 0;
+                bitboard double_push_origins = 0;
+                switch (layout.types[piece]) {
+                    case piece_type::king: origins = king_move_table[sindex]; break;
+                    case piece_type::knight: origins = knight_move_table[sindex]; break;
+                    case piece_type::bishop: origins = bishoplike_attacks(sindex, occupancy); break;
+                    case piece_type::rook: origins = rooklike_attacks(sindex, occupancy); break;
+                    case piece_type::queen:
+                        origins = bishoplike_attacks(sindex, occupancy) | rooklike_attacks(sindex, occupancy);
+                        break;
+                    case piece_type::pawn: {
+                        // A pawn on its second rank has never moved, and one on its fourth may have pushed twice.
+                        const int8_t forward = mover == piece_color::white ? 8 : -8;
+                        const uint8_t relative_rank = mover == piece_color::white ? sindex >> 3 : 7 - (sindex >> 3);
+                        if (!with_pawns || relative_rank < 2) break;
+                        const auto single_push_origin = static_cast<uint8_t>(sindex - forward);
+                        if (occupancy & sbitboard(single_push_origin)) break;
+                        origins = sbitboard(single_push_origin);
+                        if (relative_rank == 3) double_push_origins = sbitboard(single_push_origin - forward);
+                        break;
+                    }
+                    default: break;
+                }
+                origins &= ~occupancy;
+                double_push_origins &= ~occupancy;
+                for (; origins; origins &= origins - 1) {
+                    const std::size_t origin_index = with_tablebase_square(parent, piece, std::countr_zero(origins));
+                    if (flags[origin_index] & is_legal) visit(origin_index, false);
+                }
+                if (double_push_origins) {
+                    const std::size_t origin_index = with_tablebase_square(parent, piece,
+                                                                          std::countr_zero(double_push_origins));
+                    if (flags[origin_index] & is_legal) visit(origin_index, true);
+                }
+            }
+        }
+
+        /** Generates the moves of every position, resolving those whose result their moves already decide. */
+        void count_moves() {
+            compact_chess_position position;
+            move_buffer moves;
+            for (std::size_t index = 0; index < flags.size(); ++index) {
+                if (!decode_tablebase_index(layout, index, position)) continue;
+                flags[index] = is_legal;
+                moves.size = 0;
+                generate_legal_moves(position, moves);
+                if (moves.size == 0) {
+                    resolve(index, is_king_attacked(position, position.whos_turn) ? tablebase_wdl::loss
+                                                                                   : tablebase_wdl::draw);
+                    continue;
+                }
+                tablebase_wdl best_conversion = tablebase_wdl::loss;
+                uint8_t unrefuted = 0;
+                uint8_t quiet = 0;
+                for (const bitmove move : moves) {
+                    const auto [origin, destination, promote_to] = move.unpack_all();
+                    const bool is_pawn_move = piece_type_on(position, origin) == piece_type::pawn;
+                    if (piece_type_on(position, destination) != piece_type::none || promote_to != piece_type::none) {
+                        flags[index] |= has_zeroing_moves;
+                        tablebase_result child {};
+                        if (!smaller.probe(tablebase_successor(position, move), child)) is_complete = false;
+                        best_conversion = std::max(best_conversion, -child.wdl);
+                        continue;
+                    }
+                    if (!is_pawn_move) {
+                        ++quiet;
+                        ++unrefuted;
+                        continue;
+                    }
+                    flags[index] |= has_zeroing_moves | has_pawn_pushes;
+                    const compact_chess_position pushed = tablebase_successor(position, move);
+                    const tablebase_wdl floor = enpassant_floor(pushed);
+                    // A push the opponent must answer by capturing en passant is a conversion to that capture.
+                    if (has_only_enpassant_moves(pushed)) {
+                        best_conversion = std::max(best_conversion, -floor);
+                        continue;
+                    }
+                    // A push the opponent wins by capturing en passant is as good as a losing capture.
+                    if (floor != tablebase_wdl::win) ++unrefuted;
+                }
+                unrefuted_moves[index] = unrefuted;
+                quiet_moves[index] = quiet;
+                best_conversions[index] = best_conversion;
+                if (best_conversion == tablebase_wdl::win) {
+                    resolve(index, tablebase_wdl::win);
+                } else if (unrefuted == 0) {
+                    resolve(index, best_conversion);
+                }
+            }
+        }
+
+        /** Propagates each resolved win and loss to the positions one unmove away, until none remain. */
+        void propagate_results() {
+            compact_chess_position position;
+            for (std::size_t next = 0; next < resolved.size(); ++next) {
+                const std::size_t index = resolved[next];
+                const tablebase_wdl result = results[index];
+                [[maybe_unused]] const bool is_legal_index = decode_tablebase_index(layout, index, position);
+                assert(is_legal_index);
+                for_each_unmove(index, position, true, [&](const std::size_t parent, const bool is_double_push) {
+                    if (flags[parent] & is_resolved) return;
+                    tablebase_wdl floor = tablebase_wdl::loss;
+                    if (is_double_push) {
+                        compact_chess_position pushed = position;
+                        pushed.enpassant_file = moved_piece_file(index, parent);
+                        // Counted as a conversion already.
+                        if (has_only_enpassant_moves(pushed)) return;
+                        floor = enpassant_floor(pushed);
+                    }
+                    if (floor == tablebase_wdl::win) return;
+                    if (result == tablebase_wdl::loss) {
+                        if (floor == tablebase_wdl::loss) {
+                            resolve(parent, tablebase_wdl::win);
+                            return;
+                        }
+                        best_conversions[parent] = std::max(best_conversions[parent], tablebase_wdl::draw);
+                    }
+                    if (--unrefuted_moves[parent] == 0) resolve(parent, best_conversions[parent]);
+                });
+            }
+        }
+
+        /** The file of the piece whose square differs between two indices, which differ in one square only. */
+        [[nodiscard]] uint8_t moved_piece_file(const std::size_t index, const std::size_t parent) const {
+            std::size_t piece = 0;
+            while (tablebase_square(index, piece) == tablebase_square(parent, piece)) ++piece;
+            return tablebase_square(index, piece) & 0b111;
+        }
+
+        /** Whether the won position of the given index wins by a pawn push, which zeroes. */
+        bool wins_by_pawn_push(const std::size_t index, const compact_chess_position& position) {
+            move_buffer moves;
+            generate_legal_moves(position, moves);
+            for (const bitmove move : moves) {
+                const auto [origin, destination, promote_to] = move.unpack_all();
+                if (piece_type_on(position, origin) != piece_type::pawn || promote_to != piece_type::none
+                    || piece_type_on(position, destination) != piece_type::none) continue;
+                std::size_t piece = 0;
+                while (tablebase_square(index, piece) != origin) ++piece;
+                const std::size_t child = with_tablebase_square(index ^ 1, piece, destination);
+                const compact_chess_position pushed = tablebase_successor(position, move);
+                const tablebase_wdl floor = enpassant_floor(pushed);
+                const tablebase_wdl result = has_only_enpassant_moves(pushed) ? floor : std::max(results[child], floor);
+                if (result == tablebase_wdl::loss) return true;
+            }
+            return false;
+        }
+
+        /** Finds the distance to zeroing of every won and lost position, level by level. */
+        void measure_distances() {
+            compact_chess_position position;
+            for (std::size_t index = 0; index < flags.size(); ++index) {
+                if (!(flags[index] & is_legal) || results[index] == tablebase_wdl::draw) continue;
+                const bool has_zeroing = flags[index] & has_zeroing_moves;
+                if (results[index] == tablebase_wdl::loss) {
+                    if (quiet_moves[index] == 0) set_distance(index, has_zeroing ? 1 : 0);
+                    continue;
+                }
+                if (best_conversions[index] == tablebase_wdl::win) {
+                    set_distance(index, 1);
+                } else if (flags[index] & has_pawn_pushes) {
+                    [[maybe_unused]] const bool is_legal_index = decode_tablebase_index(layout, index, position);
+                    if (wins_by_pawn_push(index, position)) set_distance(index, 1);
+                }
+            }
+            for (std::size_t level = 0; level < levels.size(); ++level) {
+                for (std::size_t i = 0; i < levels[level].size(); ++i) {
+                    const std::size_t index = levels[level][i];
+                    const tablebase_wdl result = results[index];
+                    [[maybe_unused]] const bool is_legal_index = decode_tablebase_index(layout, index, position);
+                    for_each_unmove(index, position, false, [&](const std::size_t parent, bool) {
+                        if (flags[parent] & has_distance) return;
+                        if (result == tablebase_wdl::loss) {
+                            if (results[parent] == tablebase_wdl::win) set_distance(parent, level + 1);
+                        } else if (results[parent] == tablebase_wdl::loss && --quiet_moves[parent] == 0) {
+                            set_distance(parent, level + 1);
+                        }
+                    });
+                }
+            }
+        }
+    public:
+        tablebase_generator(const tablebase_material& material, const tablebase_set& smaller)
+            : smaller(smaller), layout(tablebase_layout_of(material)) {}
+
+        /**
+         * Solves the signature, writing the entry of every index to <code>entries</code>. Returns false if a table it
+         * needs is missing from the smaller set, or a distance is too long for an entry.
+         */
+        bool generate(std::vector<tablebase_entry>& entries, tablebase_statistics& statistics) {
+            const std::size_t entry_count = layout.entry_count();
+            flags.assign(entry_count, 0);
+            results.assign(entry_count, tablebase_wdl::draw);
+            distances.assign(entry_count, 0);
+            unrefuted_moves.assign(entry_count, 0);
+            quiet_moves.assign(entry_count, 0);
+            best_conversions.assign(entry_count, tablebase_wdl::loss);
+            count_moves();
+            propagate_results();
+            measure_distances();
+
+            entries.assign(entry_count, 0);
+            statistics = {};
+            for (std::size_t index = 0; index < entry_count; ++index) {
+                if (!(flags[index] & is_legal)) continue;
+                const tablebase_wdl result = results[index];
+                if (result != tablebase_wdl::draw && !(flags[index] & has_distance)) is_complete = false;
+                entries[index] = encode_tablebase_entry({ result, distances[index] });
+                if (result == tablebase_wdl::win) {
+                    ++statistics.wins;
+                    statistics.longest_win = std::max(statistics.longest_win, distances[index]);
+                } else {
+                    ++(result == tablebase_wdl::loss ? statistics.losses : statistics.draws);
+                }
+            }
+            return is_complete;
+        }
+};
+
+/**
+ * Lists the canonical signatures of three up to the given number of pieces, each after every signature its captures
+ * and promotions lead to: by the number of pieces, then by the number of pawns.
+ */
+[[nodiscard]] inline std::vector<tablebase_material> tablebase_materials(const std::size_t max_pieces) {
+    std::vector<tablebase_material> materials;
+    constexpr std::size_t slot_count = 2 * tablebase_piece_order.size();
+    const auto extend = [&](const auto& self, tablebase_material material, const std::size_t slot,
+                            const std::size_t pieces_left) -> void {
+        if (slot == slot_count) {
+            if (material.piece_count() > 2 && material.is_canonical()) materials.push_back(material);
+            return;
+        }
+        const auto color = static_cast<piece_color>(slot < tablebase_piece_order.size());
+        const piece_type type = tablebase_piece_order[slot % tablebase_piece_order.size()];
+        for (uint8_t count = 0; count <= pieces_left; ++count) {
+            material.counts[color][type] = count;
+            self(self, material, slot + 1, pieces_left - count);
+        }
+    };
+    extend(extend, tablebase_material {}, 0, std::min(max_pieces, max_tablebase_pieces) - 2);
+    std::stable_sort(materials.begin(), materials.end(), [](const auto& a, const auto& b) {
+        return std::make_pair(a.piece_count(), a.pawn_count()) < std::make_pair(b.piece_count(), b.pawn_count());
+    });
+    return materials;
+}
+
+/** Writes the entries of a generated table to the given file, header first. */
+[[nodiscard]] inline bool write_tablebase(const std::string& path, const tablebase_material& material,
+                                          const std::vector<tablebase_entry>& entries) {
+    tablebase_file_header header {};
+    header.magic = tablebase_file_magic;
+    header.version = tablebase_file_version;
+    header.piece_count = static_cast<std::uint32_t>(material.piece_count());
+    header.entry_count = entries.size();
+    const std::string name = material.name();
+    std::copy_n(name.begin(), std::min(name.size(), header.material.size() - 1), header.material.begin());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size()));
+    return file.good();
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+/**
+ * <h2>Transposition Table</h2>
+ * <p>The lockless transposition table shared by the search threads.</p>
+ */
+
+#include "position.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+// Transposition Table
+
+enum tt_bound: uint8_t {
+    /** The entry is vacant. */
+    no_bound = 0,
+    /** The score is an upper bound, every move failed low. */
+    upper_bound = 1,
+    /** The score is a lower bound, some move failed high. */
+    lower_bound = 2,
+    /** The score is exact. */
+    exact_bound = 3
+};
+
+/** The information recorded about a position by the transposition table. */
+struct tt_data {
+    bitmove best_move;
+    int16_t score;
+    int8_t depth;
+    tt_bound bound;
+    uint8_t age;
+};
+
+/**
+ * <h2>Transposition Table Entry</h2>
+ * <p>A 16 byte entry made of two 64-bit words, which many threads may read and write concurrently without locks.</p>
+ * <p>The first word is the Zobrist key XOR the second word, which packs the data. A thread probing the entry
+ * recovers the key by XOR-ing the two words back together. If another thread tore the entry by writing one word
+ * between the reads of the two, the recovered key does not match, and the torn entry is treated as a miss rather than
+ * returning data belonging to a different position.</p>
+ * <p>The second word is laid out as follows.
+ * <pre>\n
+ * bits | 63..48 47..42 41..40 39..32 31..16 15..0 \n
+ * v    | ()     (age ) (bnd ) (dpth) (score) (move)
+ * \n\n</pre></p>
+ */
+struct tt_entry {
+    std::atomic<std::uint64_t> key_xor_data;
+    std::atomic<std::uint64_t> data;
+};
+
+constexpr std::size_t tt_bucket_size = 4;
+
+/** A group of entries sharing one cache line. A key maps to exactly one bucket and may occupy any of its entries. */
+struct alignas(64) tt_bucket {
+    std::array<tt_entry, tt_bucket_size> entries;
+};
+static_assert(sizeof(tt_bucket) == 64);
+
+[[nodiscard]] constexpr std::uint64_t pack_tt_data(const bitmove move, const int16_t score, const int8_t depth,
+                                                   const tt_bound bound, const uint8_t age) {
+    return static_cast<std::uint64_t>(move.pack()) |
+           (static_cast<std::uint64_t>(static_cast<uint16_t>(score)) << 16) |
+           (static_cast<std::uint64_t>(static_cast<uint8_t>(depth)) << 32) |
+           (static_cast<std::uint64_t>(bound) << 40) |
+           (static_cast<std::uint64_t>(age & 0b111111) << 42);
+}
+
+[[nodiscard]] constexpr tt_data unpack_tt_data(const std::uint64_t data) {
+    return tt_data {
+        .best_move = bitmove::from_packed(static_cast<uint16_t>(data)),
+        .score = static_cast<int16_t>(static_cast<uint16_t>(data >> 16)),
+        .depth = static_cast<int8_t>(static_cast<uint8_t>(data >> 32)),
+        .bound = static_cast<tt_bound>((data >> 40) & 0b11),
+        .age = static_cast<uint8_t>((data >> 42) & 0b111111)
+    };
+}
+
+/**
+ * <h2>Transposition Table</h2>
+ * <p>A hash table of search results keyed by Zobrist key, shared by every search thread. It is a single allocation of
+ * cache line aligned buckets whose size is chosen in megabytes when the table is created. Probes and stores use
+ * relaxed atomic operations only, see <code>tt_entry</code>.</p>
+ * <p>Every search increments the table's age. When a bucket is full, the entry evicted is the one whose depth, less a
+ * penalty for each search since it was written, is smallest.</p>
+ */
+class transposition_table {
+    private:
+        std::unique_ptr<tt_bucket[]> buckets;
+        std::size_t bucket_count = 0;
+        uint8_t age = 0;
+
+        [[nodiscard]] tt_bucket& bucket_of(const zobrist_key key) const {
+            // Multiplying by the bucket count and keeping the high word maps the key uniformly onto the buckets
+            // without requiring a power of two bucket count.
+            const auto index = static_cast<std::size_t>((static_cast<unsigned __int128>(key) * bucket_count) >> 64);
+            return buckets[index];
+        }
+
+        [[nodiscard]] int replacement_priority(const tt_data& data) const {
+            const int age_distance = (age - data.age) & 0b111111;
+            return data.depth - 8 * age_distance;
+        }
+    public:
+        explicit transposition_table(const std::size_t megabytes) { resize(megabytes); }
+
+        /** Reallocates the table to the given size and clears it. Not safe to call while a search is running. */
+        void resize(const std::size_t megabytes) {
+            bucket_count = std::max<std::size_t>(1, megabytes * 1024 * 1024 / sizeof(tt_bucket));
+            buckets = std::make_unique<tt_bucket[]>(bucket_count);
+            clear();
+        }
+
+        /** Vacates every entry. Not safe to call while a search is running. */
+        void clear() {
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                for (tt_entry& entry : buckets[i].entries) {
+                    entry.key_xor_data.store(0, std::memory_order_relaxed);
+                    entry.data.store(0, std::memory_order_relaxed);
+                }
+            }
+            age = 0;
+        }
+
+        /** Marks the beginning of a new search, so that entries written by previous searches age. */
+        void new_search() { age = (age + 1) & 0b111111; }
+
+        [[nodiscard]] std::size_t size_in_bytes() const { return bucket_count * sizeof(tt_bucket); }
+
+        /**
+         * Hints to the processor that the bucket of the given key will be probed soon. Search calls this immediately
+         * after <code>make_move</code>, so that the cache miss overlaps with move generation.
+         */
+        void prefetch(const zobrist_key key) const { __builtin_prefetch(&bucket_of(key)); }
+
+        /** Looks up the given key. Returns true and fills <code>result</code> if the key is present. */
+        [[nodiscard]] bool probe(const zobrist_key key, tt_data& result) const {
+            count_event(instrumented_counter::tt_probes);
+            const scoped_cycle_timer timer(instrumented_timer::transposition_table);
+            for (const tt_entry& entry : bucket_of(key).entries) {
+                const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+                const std::uint64_t key_xor_data = entry.key_xor_data.load(std::memory_order_relaxed);
+                if ((key_xor_data ^ data) != key) continue;
+                result = unpack_tt_data(data);
+                if (result.bound == tt_bound::no_bound) continue;
+                count_event(instrumented_counter::tt_hits);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * Records a search result. The entry already holding the key is overwritten, otherwise the least valuable
+         * entry of the bucket is. When the new result has no best move, the previously recorded one is kept.
+         */
+        void store(const zobrist_key key, bitmove best_move, const int16_t score, const int8_t depth,
+                   const tt_bound bound) {
+            const scoped_cycle_timer timer(instrumented_timer::transposition_table);
+            tt_bucket& bucket = bucket_of(key);
+            tt_entry* victim = &bucket.entries[0];
+            int victim_priority = std::numeric_limits<int>::max();
+            for (tt_entry& entry : bucket.entries) {
+                const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+                const std::uint64_t key_xor_data = entry.key_xor_data.load(std::memory_order_relaxed);
+                const tt_data existing = unpack_tt_data(data);
+                if ((key_xor_data ^ data) == key) {
+                    if (best_move.is_null()) best_move = existing.best_move;
+                    victim = &entry;
+                    break;
+                }
+                const int priority = existing.bound == tt_bound::no_bound ? std::numeric_limits<int>::min()
+                                                                          : replacement_priority(existing);
+                if (priority < victim_priority) {
+                    victim = &entry;
+                    victim_priority = priority;
+                }
+            }
+            const std::uint64_t data = pack_tt_data(best_move, score, depth, bound, age);
+            victim->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+            victim->data.store(data, std::memory_order_relaxed);
+        }
+
+        /**
+         * Estimates the occupancy of the table in permille, as reported by the UCI <code>hashfull</code> statistic,
+         * by counting which of the first thousand entries, those of the first 1000 / <code>tt_bucket_size</code>
+         * buckets, were written during the current search.
+         */
+        [[nodiscard]] unsigned hashfull() const {
+            const std::size_t sampled_buckets = std::min<std::size_t>(1000 / tt_bucket_size, bucket_count);
+            unsigned used = 0;
+            for (std::size_t i = 0; i < sampled_buckets; ++i) {
+                for (const tt_entry& entry : buckets[i].entries) {
+                    const tt_data data = unpack_tt_data(entry.data.load(std::memory_order_relaxed));
+                    used += data.bound != tt_bound::no_bound && data.age == age;
+                }
+            }
+            return static_cast<unsigned>(used * 1000 / (sampled_buckets * tt_bucket_size));
+        }
+};
@@ -0,0 +1,384 @@
+#pragma once
+
+/**
+ * <h2>Universal Chess Interface</h2>
+ * <p>The UCI protocol, with the search on a thread of its own.</p>
+ */
+
+#include "search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Universal Chess Interface
+
+/**
+ * <h2>UCI Output</h2>
+ * <p>Writes lines to standard output from a thread of its own, so that a GUI slow to read the engine's output never
+ * stalls the thread posting them. Lines are written in the order they are posted.</p>
+ * <p>Info lines are rate limited. One posted within <code>info_interval</code> of the last one written is held back,
+ * and replaced by any info line posted after it, so that only the freshest is written. Posting any other line writes
+ * the held back info line first, so the final report of a search always precedes its best move.</p>
+ */
+class uci_output {
+    public:
+        static constexpr std::chrono::milliseconds info_interval { 50 };
+    private:
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::deque<std::string> lines;
+        std::string held_info;
+        std::chrono::steady_clock::time_point last_info_written {};
+        bool closing = false;
+        std::thread writer;
+
+        void write_lines() {
+            std::unique_lock lock(mutex);
+            while (true) {
+                if (!held_info.empty()) {
+                    const auto due = last_info_written + info_interval;
+                    const auto now = std::chrono::steady_clock::now();
+                    if (closing || now >= due) {
+                        lines.push_back(std::move(held_info));
+                        held_info.clear();
+                        last_info_written = now;
+                    } else if (lines.empty()) {
+                        wakeup.wait_until(lock, due);
+                        continue;
+                    }
+                }
+                if (lines.empty()) {
+                    if (closing) return;
+                    wakeup.wait(lock);
+                    continue;
+                }
+                std::deque<std::string> batch;
+                batch.swap(lines);
+                lock.unlock();
+                for (const std::string& line : batch) std::cout << line << '\n';
+                std::cout.flush();
+                lock.lock();
+            }
+        }
+    public:
+        uci_output() : writer([this] { write_lines(); }) {}
+
+        uci_output(const uci_output&) = delete;
+        uci_output& operator=(const uci_output&) = delete;
+
+        /** Writes every line posted so far before returning. */
+        ~uci_output() {
+            {
+                const std::lock_guard lock(mutex);
+                closing = true;
+            }
+            wakeup.notify_one();
+            writer.join();
+        }
+
+        void post(std::string line) {
+            {
+                const std::lock_guard lock(mutex);
+                if (!held_info.empty()) {
+                    lines.push_back(std::move(held_info));
+                    held_info.clear();
+                }
+                lines.push_back(std::move(line));
+            }
+            wakeup.notify_one();
+        }
+
+        void post_info(std::string line) {
+            {
+                const std::lock_guard lock(mutex);
+                held_info = std::move(line);
+            }
+            wakeup.notify_one();
+        }
+};
+
+/**
+ * <h2>UCI Engine</h2>
+ * <p>The state of a UCI session: the position set by the GUI, the options and the transposition table. Commands are
+ * read on the thread calling <code>execute</code>, and each <code>go</code> starts a search on a thread of its own,
+ * so <code>stop</code>, <code>ponderhit</code> and <code>isready</code> are answered while the search runs. The
+ * search notices <code>stop</code> within <code>limit_check_interval</code> nodes.</p>
+ * <p>After <code>go infinite</code> or <code>go ponder</code>, the best move is withheld until <code>stop</code> or
+ * <code>ponderhit</code> arrives, even if the search finishes first, as the protocol requires.</p>
+ */
+class uci_engine {
+    private:
+        static constexpr std::size_t default_hash_megabytes = 16;
+
+        uci_output output;
+        search_position position {};
+        transposition_table table { default_hash_megabytes };
+        unsigned thread_count = 1;
+        search_parameters parameters;
+
+        /** The tables of the SyzygyPath option, which replace any given on the command line. */
+        std::unique_ptr<tablebase_set> tablebases;
+
+        /** The book of the BookFile option, keyed by the Polyglot random numbers or by those of the BookKeys option. */
+        std::unique_ptr<opening_book> book;
+        std::string book_path;
+        std::string book_keys_path;
+        std::uint64_t book_seed = 0;
+
+        std::thread searcher;
+        std::atomic<bool> stop_signal = false;
+        std::atomic<bool> ponder_signal = false;
+        bool is_infinite = false;
+
+        /** Guards the signals above while the search thread waits on <code>signalled</code> to post its move. */
+        std::mutex signal_mutex;
+        std::condition_variable signalled;
+
+        /** Stops the running search, if any, and waits for it to post its best move. */
+        void finish_search() {
+            if (!searcher.joinable()) return;
+            signal_stop();
+            searcher.join();
+        }
+
+        void signal_stop() {
+            {
+                const std::lock_guard lock(signal_mutex);
+                stop_signal = true;
+            }
+            signalled.notify_one();
+        }
+
+        void signal_ponderhit() {
+            {
+                const std::lock_guard lock(signal_mutex);
+                ponder_signal = false;
+            }
+            signalled.notify_one();
+        }
+
+        void set_option(std::string_view arguments) {
+            // The option name may contain spaces, so it extends up to the "value" field.
+            if (take_field(arguments) != "name") return;
+            std::string name;
+            std::string_view value;
+            for (std::string_view field = take_field(arguments); !field.empty(); field = take_field(arguments)) {
+                if (field == "value") {
+                    // So may the value, a path for instance, so it extends to the end of the line.
+                    value = arguments.substr(std::min(arguments.find_first_not_of(" \t"), arguments.size()));
+                    value = value.substr(0, std::min(value.find_last_not_of(" \t\r\n") + 1, value.size()));
+                    break;
+                }
+                if (!name.empty()) name += ' ';
+                name += field;
+            }
+            std::uint64_t number = 0;
+            std::from_chars(value.data(), value.data() + value.size(), number);
+            if (name == "Hash" && number > 0) {
+                table.resize(number);
+            } else if (name == "Threads" && number > 0) {
+                thread_count = static_cast<unsigned>(number);
+            } else if (name == "Clear Hash") {
+                table.clear();
+            } else if (name == "SyzygyPath") {
+                active_tablebases = nullptr;
+                tablebases.reset();
+                if (value.empty() || value == "<empty>") return;
+                tablebases = std::make_unique<tablebase_set>(std::string(value));
+                active_tablebases = tablebases.get();
+                output.post("info string found " + std::to_string(tablebases->table_count()) + " tablebases of up to " +
+                            std::to_string(tablebases->max_piece_count()) + " pieces");
+            } else if (set_search_parameter(parameters, name, static_cast<std::int64_t>(number))) {
+                return;
+            } else if (name == "BookSeed") {
+                book_seed = number;
+            } else if (name == "BookFile" || name == "BookKeys") {
+                (name == "BookFile" ? book_path : book_keys_path) = value == "<empty>" ? "" : std::string(value);
+                open_book();
+            }
+        }
+
+        /** Replaces the book with that of the BookFile option, if any, keyed as the BookKeys option says. */
+        void open_book() {
+            active_book = nullptr;
+            book.reset();
+            if (book_path.empty()) return;
+            polyglot_random_table randoms = polyglot_randoms;
+            if (!book_keys_path.empty() && !load_polyglot_randoms(book_keys_path, randoms)) {
+                output.post("info string cannot read the 781 Polyglot random numbers from " + book_keys_path);
+                return;
+            }
+            book = std::make_unique<opening_book>(book_path, randoms);
+            if (!book->is_open()) {
+                output.post("info string cannot map book " + book_path);
+                book.reset();
+                return;
+            }
+            active_book = book.get();
+            output.post("info string found " + std::to_string(book->entry_count()) + " book entries");
+        }
+
+        void load_starting_position() {
+            [[maybe_unused]] const bool is_loaded = load_fen(starting_position_fen, position);
+            assert(is_loaded);
+        }
+
+        void set_position(std::string_view arguments) {
+            const std::string_view kind = take_field(arguments);
+            const std::size_t moves_at = arguments.find("moves");
+            std::string_view moves;
+            if (moves_at != std::string_view::npos) moves = arguments.substr(moves_at + 5);
+            const std::string_view fen = kind == "startpos" ? starting_position_fen : arguments.substr(0, moves_at);
+            const bool is_loaded = (kind == "startpos" || kind == "fen") && load_fen(fen, position);
+            if (!is_loaded) {
+                output.post("info string malformed position, using the starting position");
+                load_starting_position();
+                return;
+            }
+            for (std::string_view field = take_field(moves); !field.empty(); field = take_field(moves)) {
+                const bitmove move = parse_long_algebraic(position, field);
+                if (move.is_null()) {
+                    output.post("info string illegal move " + std::string(field));
+                    return;
+                }
+                // The log must keep room for the deepest line of the search, so a long game sheds its earliest
+                // moves. Repetitions are looked for no further back than the halfmove clock reaches, and it stops at
+                // 255, so no more are needed.
+                if (position.move_log.size() >= max_ply - max_search_ply) {
+                    position.move_log.keep_latest(std::numeric_limits<decltype(position.halfmove_clock)>::max());
+                    refresh_accumulator(position);
+                }
+                make_move(move, position);
+            }
+        }
+
+        void go(std::string_view arguments) {
+            using std::chrono::milliseconds;
+            search_limits limits;
+            bool ponder = false;
+            is_infinite = false;
+            const bool white = position.whos_turn == piece_color::white;
+            const auto take_number = [&arguments] {
+                const std::string_view field = take_field(arguments);
+                std::int64_t number = 0;
+                std::from_chars(field.data(), field.data() + field.size(), number);
+                return std::max<std::int64_t>(number, 0);
+            };
+            for (std::string_view field = take_field(arguments); !field.empty(); field = take_field(arguments)) {
+                if (field == "infinite") is_infinite = true;
+                else if (field == "ponder") ponder = true;
+                else if (field == "depth") limits.max_depth = std::clamp<int>(take_number(), 1, max_search_ply - 1);
+                else if (field == "nodes") limits.max_nodes = take_number();
+                else if (field == "movetime") limits.move_time = milliseconds(take_number());
+                else if (field == (white ? "wtime" : "btime")) limits.time_remaining = milliseconds(take_number());
+                else if (field == (white ? "winc" : "binc")) limits.increment = milliseconds(take_number());
+            }
+            limits.parameters = parameters;
+            limits.book_seed = book_seed;
+            stop_signal = false;
+            ponder_signal = ponder;
+            table.new_search();
+            reset_instrumentation();
+            searcher = std::thread([this, limits] { search(limits); });
+        }
+
+        /** The body of the search thread, which posts the best move once it may. */
+        void search(const search_limits& limits) {
+            std::vector<bitmove> principal_variation;
+            const auto report = [&](const search_report& snapshot) {
+                principal_variation = snapshot.principal_variation;
+                output.post_info(format_search_report(snapshot));
+            };
+            const search_result result = lazy_smp_search(position, table, limits, thread_count, stop_signal, report,
+                                                         &ponder_signal);
+            {
+                std::unique_lock lock(signal_mutex);
+                signalled.wait(lock, [this] { return stop_signal || (!is_infinite && !ponder_signal); });
+            }
+            for (const std::string& line : instrumentation_report()) output.post("info string " + line);
+            const bitmove best_move = result.best_move;
+            std::string line = "bestmove " + (best_move.is_null() ? "0000" : to_long_algebraic(best_move));
+            if (principal_variation.size() >= 2 && principal_variation[0] == best_move) {
+                line += " ponder " + to_long_algebraic(principal_variation[1]);
+            }
+            output.post(std::move(line));
+        }
+    public:
+        uci_engine() { load_starting_position(); }
+
+        ~uci_engine() {
+            finish_search();
+            if (tablebases && active_tablebases == tablebases.get()) active_tablebases = nullptr;
+            if (book && active_book == book.get()) active_book = nullptr;
+        }
+
+        /** Executes one line of input. Returns false once the GUI has asked the engine to quit. */
+        bool execute(std::string_view line) {
+            const std::string_view command = take_field(line);
+            if (command == "uci") {
+                output.post("id name simple_chess_computer");
+                output.post("id author duncpro");
+                output.post("option name Hash type spin default " + std::to_string(default_hash_megabytes) +
+                            " min 1 max 65536");
+                output.post("option name Threads type spin default 1 min 1 max 1024");
+                output.post("option name Ponder type check default false");
+                output.post("option name Clear Hash type button");
+                output.post("option name SyzygyPath type string default <empty>");
+                output.post("option name BookFile type string default <empty>");
+                output.post("option name BookKeys type string default <empty>");
+                output.post("option name BookSeed type spin default 0 min 0 max 2147483647");
+                for (const search_parameter_descriptor& descriptor : search_parameter_descriptors) {
+                    output.post("option name " + std::string(descriptor.name) + " type spin default " +
+                                std::to_string(search_parameters {}.*descriptor.value) + " min " +
+                                std::to_string(descriptor.min) + " max " + std::to_string(descriptor.max));
+                }
+                output.post("uciok");
+            } else if (command == "isready") {
+                output.post("readyok");
+            } else if (command == "setoption") {
+                finish_search();
+                set_option(line);
+            } else if (command == "ucinewgame") {
+                finish_search();
+                table.clear();
+            } else if (command == "position") {
+                finish_search();
+                set_position(line);
+            } else if (command == "go") {
+                finish_search();
+                go(line);
+            } else if (command == "stop") {
+                signal_stop();
+            } else if (command == "ponderhit") {
+                signal_ponderhit();
+            } else if (command == "quit") {
+                return false;
+            }
+            return true;
+        }
+};
+
+/** Speaks UCI over standard input and output until the GUI quits or closes the input. */
+inline int run_uci_loop() {
+    // The engine is too large for the stack, because its position holds the network accumulators.
+    const auto engine = std::make_unique<uci_engine>();
+    for (std::string line; std::getline(std::cin, line);) {
+        if (!engine->execute(line)) break;
+    }
+    return 0;
+}
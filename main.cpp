@@ -1,382 +1,659 @@
-#include <iostream>
-#include <cstdint>
-#include <array>
-#include <stack>
-
-enum piece_color: bool { white = true, black = false };
-constexpr piece_color operator!(piece_color original) { return static_cast<piece_color>(!static_cast<bool>(original)); }
-
-/**
- * A bitboard is a low resolution chess board. That is, a bitboard has the structure of a chess board (8x8 squares)
- * but does not posses the capability of storing exact piece type and color. Instead, a square on a bitboard is
- * considered either "marked" or "unmarked", based on the value of the bit (0 or 1) corresponding to the square.
- *
- * <pre>\n
- * _         Black         \n
- * Queenside      Kingside \n
- * 56 57 58 59 60 61 62 63 \n
- * 48 49 50 51 52 53 54 55 \n
- * 40 41 42 45 44 45 46 47 \n
- * 32 33 34 35 36 37 38 39 \n
- * 24 25 26 27 28 29 30 31 \n
- * 16 17 18 19 20 21 22 23 \n
- * 8  9  10 11 12 13 14 15 \n
- * 0  1  2  3  4  5  6  7  \n
- * Queenside      Kingside \n
- * _         White         \n
- * </pre>\n
- *
- * The square labeled with <i>n</i> is marked by setting the <nobr>(<i>n</i> + 1)th</nobr> least significant bit in
- * the bitboard. \n\n
- *
- * The clearest way to mark a square in a bitboard is using bitwise OR in conjunction with the <code>singleton</code>
- * function.
- */
-using bitboard = std::uint64_t;
+#include <simple_chess/simple_chess.hpp>
 
-/**
- * A bitlane represents 8 consecutive bits of a bitboard.\n\n
- * On a <b>standard bitboard</b>, a bitlane typically describes the occupancy of a rank. The <nobr>(<i>n</i> + 1)th</nobr>
- * least significant bit corresponds to the <nobr>(<i>n</i> + 1)th</nobr> queenside-most square of a rank. \n\n
- * On a <b>rotated bitboard</b>, a bitlane typically describes the occupancy of a file.
- */
-using bitlane = std::uint8_t;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+void print_usage() {
+    std::cout << "Usage:\n"
+                 "  simple_chess_computer                         speak UCI on standard input and output\n"
+                 "  simple_chess_computer perft <depth> [<fen>]   print the node count beneath each root move\n"
+                 "  simple_chess_computer perft suite [<depth>]   verify and time the standard perft positions\n"
+                 "  simple_chess_computer perft layouts [<depth>] compare the throughput of the move log layouts\n"
+                 "  simple_chess_computer perft colors [<depth>]  compare runtime and compile-time color dispatch\n"
+                 "  simple_chess_computer perft legality [<depth>] compare legal generation with filtering\n"
+                 "  simple_chess_computer perft bulk [<depth>]    compare bulk counting with playing out leaves\n"
+                 "  simple_chess_computer perft copymake [<depth>] compare copy-make of compact positions with\n"
+                 "                                                make/unmake\n"
+                 "  simple_chess_computer search [<fen>]          search the position and print the best move\n"
+                 "\n"
+                 "Perft options:\n"
+                 "  --layout flat|stack   the move log layout of the position (default flat)\n"
+                 "  --hash <MB>           the size of the perft table of subtree counts (default 0, none)\n"
+                 "  --threads <count>     the number of threads counting subtrees (default 1)\n"
+                 "\n"
+                 "Search options:\n"
+                 "  --depth <plies>       stop after completing this depth\n"
+                 "  --nodes <count>       stop after searching this many nodes\n"
+                 "  --movetime <ms>       stop after this much time\n"
+                 "  --hash <MB>           the size of the transposition table (default 16)\n"
+                 "  --threads <count>     the number of search threads (default 1)\n"
+                 "  --param <name>=<value> set a threshold of the selective search, as the UCI option of that name;\n"
+                 "                        also accepted by smp-bench and analyze\n"
+                 "\n"
+                 "  simple_chess_computer smp-bench [--depth <plies>] [--hash <MB>] [--max-threads <count>]\n"
+                 "      measure the time-to-depth speedup of Lazy SMP for 1, 2, 4, ... threads\n"
+                 "\n"
+                 "  simple_chess_computer fen-bench [--iterations <count>]\n"
+                 "      verify FEN round trips of the perft suite and time load_fen and write_fen\n"
+                 "\n"
+                 "  simple_chess_computer analyze <file>|- [--depth <plies>] [--nodes <count>] [--threads <count>]\n"
+                 "                        [--hash <MB>] [--output <file>]\n"
+                 "      search every FEN or EPD record of the file (default depth 6, one thread per core, 1 MB of\n"
+                 "      hash per thread) and write an EPD record of the results for each, in input order; the file may\n"
+                 "      also be a packed dataset\n"
+                 "\n"
+                 "  simple_chess_computer pack <fen-file> <dataset>   convert FEN or EPD records to 32 byte records\n"
+                 "  simple_chess_computer unpack <dataset>            print the positions of a dataset as FEN\n"
+                 "\n"
+                 "  simple_chess_computer tablebase generate <directory> [<pieces>]\n"
+                 "      generate the endgame tables of up to the given number of pieces (default 3, at most 4)\n"
+                 "  simple_chess_computer tablebase probe [<fen>]\n"
+                 "      print the result of the position in the tables given by --tablebases, and its best move\n"
+                 "\n"
+                 "  simple_chess_computer book make <games-file> <book> [<plies>]\n"
+                 "      write a book of the first moves (default 16) of each game, a line of long algebraic\n"
+                 "      moves from the starting position, weighted by the number of games which played them\n"
+                 "  simple_chess_computer book probe [<fen>]\n"
+                 "      print the moves the book given by --book has for the position, and their weights\n"
+                 "\n"
+                 "Global options:\n"
+                 "  --nnue <file>         evaluate searched positions with the network in the given file\n"
+                 "  --tablebases <dirs>   probe the generated and Syzygy endgame tables of the given directories,\n"
+                 "                        separated by colons, during search\n"
+                 "  --book <file>         play the moves of the given Polyglot book rather than searching\n"
+                 "  --book-keys <file>    key books with the 781 random numbers of the given file rather than\n"
+                 "                        the built-in Polyglot ones; they must reproduce the Polyglot test keys\n";
+}
 
 /**
- * Creates a singleton bitlane. That is, a bitlane where only a single square is marked.
- * In the context of <b>standard bitboards</b> this returns a bitlane with the <nobr>(<i>n</i> + 1)th</nobr>
- * queenside-most square is marked.
+ * Removes the named option and the value following it from the arguments. Returns the value, or the fallback if the
+ * option is absent.
  */
-[[nodiscard]] constexpr bitlane sbitlane(const std::uint8_t n) { return ((bitlane) 1) << n; }
+std::string_view take_option(std::vector<std::string_view>& arguments, const std::string_view name,
+                             const std::string_view fallback) {
+    for (auto it = arguments.begin(); it != arguments.end(); ++it) {
+        if (*it != name || it + 1 == arguments.end()) continue;
+        const std::string_view value = *(it + 1);
+        arguments.erase(it, it + 2);
+        return value;
+    }
+    return fallback;
+}
 
 /**
- * Converts a rank-file coordinate the index of the bit corresponding to that coordinate within a bitboard.  \n\n
- * Ranks are indexed [0, 7] beginning with the white edge of the board. \n\n
- * Files are indexed [0, 7] beginning with the queenside edge of the board.\n\n
+ * Removes every <code>--param &lt;name&gt;=&lt;value&gt;</code> option from the arguments and sets the search
+ * parameter it names. Returns false, having said why, if one is not a parameter or is out of its bounds.
  */
-[[nodiscard]] constexpr uint8_t coords_to_sindex(const std::uint8_t rank, const std::uint8_t file) { return rank * 8 + file; }
-
-/** Converts a standard sindex to a rotated sindex and vice versa.  */
-[[nodiscard]] constexpr std::uint8_t rotate_sindex(std::uint8_t original) {
-    const uint8_t a = original >> 3;
-    const uint8_t b = original & 0b111;
-    return (b * 8) + a;
+bool take_search_parameters(std::vector<std::string_view>& arguments, search_parameters& parameters) {
+    for (std::string_view option = take_option(arguments, "--param", ""); !option.empty();
+         option = take_option(arguments, "--param", "")) {
+        const std::size_t equals = option.find('=');
+        std::int64_t value = 0;
+        const bool is_parsed = equals != std::string_view::npos &&
+                               std::from_chars(option.data() + equals + 1, option.data() + option.size(), value).ec ==
+                               std::errc {};
+        if (!is_parsed || !set_search_parameter(parameters, option.substr(0, equals), value)) {
+            std::cerr << "Invalid search parameter " << option << ", expected one of";
+            for (const search_parameter_descriptor& descriptor : search_parameter_descriptors) {
+                std::cerr << " " << descriptor.name << " (" << descriptor.min << "-" << descriptor.max << ")";
+            }
+            std::cerr << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
-[[nodiscard]] consteval bitlane rank_literal(bool f0, bool f1, bool f2, bool f3, bool f4, bool f5, bool f6, bool f7) {
-    bitlane rank = 0;
-    if (f0) rank |= sbitlane(0);
-    if (f1) rank |= sbitlane(1);
-    if (f2) rank |= sbitlane(2);
-    if (f3) rank |= sbitlane(3);
-    if (f4) rank |= sbitlane(4);
-    if (f5) rank |= sbitlane(5);
-    if (f6) rank |= sbitlane(6);
-    if (f7) rank |= sbitlane(7);
-    return rank;
+template<typename position_type>
+int run_perft_divide(const unsigned depth, const std::string& fen, perft_table* const table,
+                     const unsigned thread_count) {
+    position_type position;
+    if (!load_fen(fen, position)) {
+        std::cout << "Malformed FEN: " << fen << std::endl;
+        return 1;
+    }
+    if (thread_count > 1) {
+        parallel_perft_divide(position, depth, thread_count, table);
+    } else {
+        perft_divide(position, depth, table);
+    }
+    return 0;
 }
 
-/** Creates a singleton bitboard. That is, a bitboard where only a single square is marked. */
-[[nodiscard]] constexpr bitboard sbitboard(const std::uint8_t square_index) { return static_cast<bitboard>(1) << square_index; }
+/** Joins the remaining arguments with spaces, for FEN strings given without quotes. */
+std::string join_arguments(const std::vector<std::string_view>& arguments, const std::size_t first) {
+    std::string joined;
+    for (std::size_t i = first; i < arguments.size(); ++i) {
+        if (i > first) joined += ' ';
+        joined += arguments[i];
+    }
+    return joined;
+}
 
-void print_bitboard(const bitboard board) {
-    for (std::uint8_t rank = 8; rank > 0; --rank) {
-        const uint8_t rank_begin_sindex = (rank - 1) * 8;
-        const uint8_t rank_end_sindex = rank_begin_sindex + 8;
-        for (std::uint8_t sindex = rank_begin_sindex; sindex < rank_end_sindex; ++sindex) {
-            std::cout << ((board & sbitboard(sindex)) ? '1' : '0');
-            std::cout << "  ";
+int run_perft_command(std::vector<std::string_view> arguments) {
+    const std::string_view layout = take_option(arguments, "--layout", "flat");
+    const std::size_t hash_megabytes = std::stoull(std::string(take_option(arguments, "--hash", "0")));
+    const unsigned thread_count = std::max(1, std::stoi(std::string(take_option(arguments, "--threads", "1"))));
+    if (arguments.empty() || (layout != "flat" && layout != "stack")) {
+        print_usage();
+        return 1;
+    }
+    const bool is_flat = layout == "flat";
+    std::unique_ptr<perft_table> table = hash_megabytes ? std::make_unique<perft_table>(hash_megabytes) : nullptr;
+    if (arguments[0] == "suite" || arguments[0] == "layouts" || arguments[0] == "colors"
+        || arguments[0] == "legality" || arguments[0] == "bulk" || arguments[0] == "copymake") {
+        const unsigned depth = arguments.size() > 1 ? std::stoul(std::string(arguments[1])) : 0;
+        if (arguments[0] == "layouts") return compare_move_log_layouts(depth) ? 0 : 1;
+        if (arguments[0] == "colors") {
+            return compare_perft_variants(depth, "runtime color", perft_variant::runtime_color,
+                                          "compile-time color", perft_variant::pseudo_legal) ? 0 : 1;
+        }
+        if (arguments[0] == "legality") {
+            return compare_perft_variants(depth, "make/unmake filtering", perft_variant::pseudo_legal,
+                                          "legal generation", perft_variant::legal) ? 0 : 1;
+        }
+        if (arguments[0] == "bulk") {
+            return compare_perft_variants(depth, "leaves played out", perft_variant::legal,
+                                          "bulk counting", perft_variant::bulk_counting) ? 0 : 1;
+        }
+        if (arguments[0] == "copymake") {
+            const bool legal_passed = compare_perft_variants(depth, "make/unmake, leaves played out",
+                                                             perft_variant::legal, "copy-make, leaves played out",
+                                                             perft_variant::copy_make_legal);
+            std::cout << "\n";
+            const bool bulk_passed = compare_perft_variants(depth, "make/unmake, bulk counting",
+                                                            perft_variant::bulk_counting, "copy-make, bulk counting",
+                                                            perft_variant::copy_make_bulk_counting);
+            return legal_passed && bulk_passed ? 0 : 1;
         }
-        std::cout << std::endl;
+        const perft_suite_result result =
+                is_flat ? run_perft_suite<flat_chess_position>(depth, perft_variant::bulk_counting, table.get(),
+                                                               thread_count)
+                        : run_perft_suite<chess_position>(depth, perft_variant::bulk_counting, table.get(),
+                                                          thread_count);
+        return result.all_passed ? 0 : 1;
     }
+    const unsigned depth = std::stoul(std::string(arguments[0]));
+    const std::string fen = arguments.size() > 1 ? join_arguments(arguments, 1) : std::string(starting_position_fen);
+    return is_flat ? run_perft_divide<flat_chess_position>(depth, fen, table.get(), thread_count)
+                   : run_perft_divide<chess_position>(depth, fen, table.get(), thread_count);
 }
 
-void print_rank(const bitlane lane) {
-    for (std::uint8_t file = 0; file < 8; file++) {
-        std::cout << ((sbitlane(file) & lane) ? "1" : "0");
+int run_search_command(std::vector<std::string_view> arguments) {
+    search_limits limits;
+    limits.max_depth = std::stoi(std::string(take_option(arguments, "--depth", std::to_string(limits.max_depth))));
+    limits.max_nodes = std::stoull(std::string(take_option(arguments, "--nodes", "0")));
+    limits.move_time = std::chrono::milliseconds(std::stoll(std::string(take_option(arguments, "--movetime", "0"))));
+    limits.max_depth = std::clamp(limits.max_depth, 1, max_search_ply - 1);
+    const std::size_t hash_megabytes = std::stoull(std::string(take_option(arguments, "--hash", "16")));
+    const unsigned thread_count = std::max(1, std::stoi(std::string(take_option(arguments, "--threads", "1"))));
+    if (!take_search_parameters(arguments, limits.parameters)) return 1;
+    const std::string fen = arguments.empty() ? std::string(starting_position_fen) : join_arguments(arguments, 0);
+
+    search_position position;
+    if (!load_fen(fen, position)) {
+        std::cout << "Malformed FEN: " << fen << std::endl;
+        return 1;
     }
-    std::cout << "\n";
+    transposition_table table(hash_megabytes);
+    table.new_search();
+    std::atomic<bool> stop_signal = false;
+    reset_instrumentation();
+    const search_result result = lazy_smp_search(position, table, limits, thread_count, stop_signal,
+                                                 print_search_report);
+    print_instrumentation_report(std::cout, "info string ");
+    std::cout << "info string effective branching factor " << std::fixed << std::setprecision(2)
+              << result.effective_branching_factor << "\n";
+    std::cout << "bestmove " << (result.best_move.is_null() ? "0000" : to_long_algebraic(result.best_move))
+              << std::endl;
+    return 0;
 }
 
-enum piece_type: uint8_t { rook = 0, knight = 1, bishop = 2, queen = 3, king = 4, pawn = 5, none = 6 };
-
 /**
- * <h2>Space-Efficient, Forward, Chess Move Representation</h2>
- * <h3>Origin & Destination Squares</h3>
- * <p>There are 64 squares on a chess board, which means for every move there are 64 possible
- * origin squares, and 63 possible destination squares. log2(64) = 6, therefore 6 bits are sufficient for
- * describing the origin square. Similarly, ceil(log2(63)) = 6, so six bits must be reserved for describing
- * the destination square.</p>
- *
- * <h3>Promotion</h3>
- * <p>It is possible for a piece to transform in type after it has been moved.
- * Specifically, when a pawn which reaches the opposite end of the board it becomes a major/minor piece
- * of the player's choosing. A pawn may be promoted to a [Rook, Knight, Bishop, Queen].
- * Therefore, 3 bits are necessary to describe the desired promotion.</p>
- *
- * <h3>Memory Layout</h3>
- * <p>The following table illustrates the layout of the move data over <code>std::uint16_t</code>.
- * <pre>\n
- * n  | 16 15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 \n
- * v  | () (promot) (destination) (origin    )
- * \n\n</pre>
- * Where <i>v</i> describes the value occupying the <i>n</i>th least significant bit.</p>\n\n
+ * Measures the time Lazy SMP takes to reach a fixed depth on the perft suite positions with 1, 2, 4, ... threads,
+ * clearing the table before each search, and reports the speedup over one thread.
  */
-class bitmove {
-    private:
-        std::uint16_t data;
-    public:
-        bitmove(const uint8_t origin, const uint8_t destination, const piece_type promote_to) {
-            assert(origin < 64 && destination < 64 && origin != destination);
-
-            data = (static_cast<uint16_t>(promote_to) << 12) |
-                   (static_cast<uint16_t>(destination) << 6) |
-                   static_cast<uint16_t>(origin);
-        }
-        [[nodiscard]] constexpr uint8_t unpack_origin() const { return data & 0b111111; }
-        [[nodiscard]] constexpr uint8_t unpack_destination() const { return (data >> 6) & 0b111111; }
-        [[nodiscard]] constexpr piece_type unpack_promotion() const { return static_cast<piece_type>((data >> 12) & 0b111); }
-
-        [[nodiscard]] constexpr std::tuple<uint8_t, uint8_t, piece_type> unpack_all() const {
-            return std::make_tuple(unpack_origin(), unpack_destination(), unpack_promotion());
+int run_smp_benchmark_command(std::vector<std::string_view> arguments) {
+    search_limits limits;
+    limits.max_depth = std::clamp(std::stoi(std::string(take_option(arguments, "--depth", "8"))), 1,
+                                  max_search_ply - 1);
+    const std::size_t hash_megabytes = std::stoull(std::string(take_option(arguments, "--hash", "64")));
+    const unsigned max_threads = std::max(1, std::stoi(std::string(take_option(arguments, "--max-threads", "32"))));
+    if (!take_search_parameters(arguments, limits.parameters)) return 1;
+    transposition_table table(hash_megabytes);
+
+    std::cout << "threads     time (s)   speedup          nps\n";
+    double single_thread_seconds = 0;
+    for (unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        std::uint64_t nodes = 0;
+        double seconds = 0;
+        for (const perft_suite_entry& entry : perft_suite) {
+            search_position position;
+            if (!load_fen(entry.fen, position)) return 1;
+            table.clear();
+            table.new_search();
+            std::atomic<bool> stop_signal = false;
+            seconds += time_seconds([&] {
+                nodes += lazy_smp_search(position, table, limits, thread_count, stop_signal, nullptr).nodes;
+            });
         }
-};
-
-struct reversible_move {
-    uint8_t origin;
-    uint8_t destination;
-    uint8_t target;
-    piece_type captured_piece_type;
-    bool is_promotion;
-};
-
-consteval auto generate_target_lookup_table() {
-    std::array<uint8_t, 8 /* files */ * 2 /* colors */ + 64 /* identity targets */> table {};
-    for (uint8_t file = 0; file < 8; file++) {
-        table[file << piece_color::white] = coords_to_sindex(4, file);
-        table[file << piece_color::black] = coords_to_sindex(3, file);
-    }
-    for (uint8_t i = 0; i < 64; i++) table[16 + i] = i;
-    return table;
+        if (thread_count == 1) single_thread_seconds = seconds;
+        std::cout << std::setw(7) << thread_count << std::setw(13) << std::fixed << std::setprecision(3) << seconds
+                  << std::setw(9) << std::setprecision(2) << (seconds > 0 ? single_thread_seconds / seconds : 0.0)
+                  << "x" << std::setw(13) << nodes_per_second(nodes, seconds) << std::endl;
+    }
+    return 0;
 }
-constinit auto target_lookup_table = generate_target_lookup_table();
 
 /**
- * <h2>Target Square Calculation Function</h2>
- * <p>This function calculates the <b>target square</b> of the given move and returns its index.</p>
- * <p>For <b>capturing moves</b>, the <b>target square</b> is the square containing the piece which is captured once the
- * move is made.</p>
- * <p>For <b>non-capture moves</b>, the <b>target square</b> is equivalent to the <b>destination square</b>.</p>
- * <p>In traditional chess, the only <b>capturing move</b> where the <b>target square</b> differs from the <b>destination
- * square</b> is enpassant pawn capture.</p>
- * <h3>Assumptions</h3>
- * <p>This function assumes that the given input move is legal. Specifically, it assumes that if a pawn is switching
- * files, and there is no piece on the destination square, then the move is valid enpassant capture, regardless
- * of the origin and destination ranks. If a non-legal move is given as input, the return value is undefined.</p>
+ * Verifies that every position of the perft suite survives a round trip through <code>write_fen</code> and
+ * <code>load_fen</code>, then measures the throughput of each, and of <code>unpack_position</code> for comparison.
  */
-uint8_t lookup_target(std::uint8_t origin, std::uint8_t destination, piece_type moved_piece_type,
-                      piece_type destination_occupant_type, piece_color aggressor_color) {
-    const bool is_enpassant = (moved_piece_type == piece_type::pawn) | ((origin & 0b111) != (destination & 0b111))
-                              | (destination_occupant_type == piece_type::none);
-    const uint8_t file = destination & 0b111;
-    const uint8_t key = ((((file + 1) << aggressor_color) - 1) * is_enpassant) + (!is_enpassant * (16 + destination));
-    return target_lookup_table[key];
-}
-
-struct chess_position {
-    std::array<bitboard, 2> color_bitboard;
-
-    std::array<bitboard, 2> color_bitboard_rotated;
-
-    /**
-     * <p>An array of bitboards indexed by <code>piece_type</code>. Each bitboard contains a mapping
-     * of all the pieces of the associated type which exist on the board currently.</p>
-     * <p>This array intentionally includes a bitboard associated with <code>piece_type::none</code>. It too
-     * must be kept consistent by <code>make_move</code> and <code>unmake_move</code>.</p>
-     */
-    std::array<bitboard, 7> type_specific_bitboard;
-
-    std::array<piece_type, 64> occupier_type_lookup_table;
-
-    std::stack<reversible_move> move_log;
-
-    /**
-     * The player whose turn it is to move this turn (either white or black). A read from this field is functionally
-     * equivalent to the following computation...
-     * \n<code><pre>
-     *      state.move_log.size() % 2 == 0 ? piece_color::white : piece_color::black;
-     * </pre></code>\n
-     */
-    piece_color whos_turn;
-};
-
-void make_move(bitmove move, chess_position& position) {
-    const auto [origin, destination, promote_to] = move.unpack_all();
-    const bool is_promotion = promote_to != piece_type::none;
-    const piece_type moved_piece_type = position.occupier_type_lookup_table[origin];
-    const piece_type destination_occupant_type = position.occupier_type_lookup_table[destination];
-    const piece_color opponent_color = !position.whos_turn;
-    const uint8_t origin_rotated = rotate_sindex(origin);
-
-    // The target and destination values are equivalent in all cases except en-passant.
-    const uint8_t target = lookup_target(origin, destination, moved_piece_type, destination_occupant_type,
-                                         position.whos_turn);
+int run_fen_benchmark_command(std::vector<std::string_view> arguments) {
+    const std::uint64_t iterations = std::stoull(std::string(take_option(arguments, "--iterations", "1000000")));
+    search_position position;
+    search_position reparsed;
+    std::array<char, max_fen_length> buffer;
+    for (const perft_suite_entry& entry : perft_suite) {
+        if (!load_fen(entry.fen, position)) return 1;
+        const std::string_view written(buffer.data(), write_fen(position, buffer));
+        if (!load_fen(written, reparsed) || reparsed.hash != position.hash
+            || reparsed.occupier_type_lookup_table != position.occupier_type_lookup_table) {
+            std::cout << entry.name << ": round trip failed, wrote " << written << std::endl;
+            return 1;
+        }
+    }
 
-    position.move_log.push(reversible_move {
-        .origin = origin,
-        .destination = destination,
-        .target = target,
-        .captured_piece_type = position.occupier_type_lookup_table[target],
-        .is_promotion = is_promotion,
+    std::size_t checksum = 0;
+    const double parse_seconds = time_seconds([&] {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            checksum += load_fen(perft_suite[i % perft_suite.size()].fen, position);
+            checksum += position.hash;
+        }
     });
-
-    // Clear the now vacated origin square.
-    position.occupier_type_lookup_table[origin] = piece_type::none;
-    position.color_bitboard[position.whos_turn] &= ~sbitboard(origin);
-    position.type_specific_bitboard[moved_piece_type] &= ~sbitboard(origin);
-    position.color_bitboard_rotated[position.whos_turn] &= ~sbitboard(origin_rotated);
-
-    // Clear the target square since the piece which resides on it has been captured.
-    const piece_type target_piece_type = position.occupier_type_lookup_table[target];
-    position.type_specific_bitboard[target_piece_type] &= ~sbitboard(target);
-    position.occupier_type_lookup_table[target] = piece_type::none;
-    position.color_bitboard[opponent_color] &= ~sbitboard(target);
-    position.color_bitboard_rotated[opponent_color] &= ~sbitboard(origin_rotated);
-
-    // Fill the destination square with the moved piece.
-    position.occupier_type_lookup_table[destination] = (is_promotion ? moved_piece_type : promote_to);
-    position.color_bitboard[position.whos_turn] |= sbitboard(destination);
-    position.type_specific_bitboard[moved_piece_type] |= sbitboard(destination);
-    position.color_bitboard_rotated[position.whos_turn] |= sbitboard(rotate_sindex(destination));
-
-    position.whos_turn = opponent_color;
+    const double write_seconds = time_seconds([&] {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            position.whos_turn = static_cast<piece_color>(i & 1);
+            checksum += write_fen(position, buffer);
+        }
+    });
+    std::array<packed_position, perft_suite.size()> packed_suite;
+    for (std::size_t i = 0; i < perft_suite.size(); ++i) {
+        if (!load_fen(perft_suite[i].fen, position) || !pack_position(position, packed_suite[i])) return 1;
+    }
+    const double unpack_seconds = time_seconds([&] {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            checksum += unpack_position(packed_suite[i % packed_suite.size()], position);
+            checksum += position.hash;
+        }
+    });
+    const auto nanoseconds_each = [&](const double seconds) {
+        return iterations ? seconds * 1e9 / static_cast<double>(iterations) : 0.0;
+    };
+    std::cout << "Round trips: ok\n" << std::fixed << std::setprecision(1)
+              << "load_fen:  " << nanoseconds_each(parse_seconds) << " ns\n"
+              << "write_fen: " << nanoseconds_each(write_seconds) << " ns\n"
+              << "unpack_position: " << nanoseconds_each(unpack_seconds) << " ns\n"
+              << "(checksum " << checksum << ")" << std::endl;
+    return 0;
 }
 
-void unmake_move(chess_position& position) {
-    const reversible_move last_move = position.move_log.top();
-    const bool is_capture = last_move.captured_piece_type != piece_type::none;
-    const piece_color last_player_to_move = !position.whos_turn;
-    const piece_type post_move_piece_type = position.occupier_type_lookup_table[last_move.destination];
-    const piece_type pre_move_piece_type = last_move.is_promotion ? piece_type::pawn : post_move_piece_type;
-    const uint8_t destination_rotated = rotate_sindex(last_move.destination);
-    const uint8_t target_rotated = rotate_sindex(last_move.target);
-    const uint8_t origin_rotated = rotate_sindex(last_move.origin);
-
-    // Remove the piece from its destination square.
-    position.occupier_type_lookup_table[last_move.destination] = piece_type::none;
-    position.color_bitboard[last_player_to_move] &= ~sbitboard(last_move.destination);
-    position.color_bitboard_rotated[last_player_to_move] &= ~sbitboard(destination_rotated);
-    position.type_specific_bitboard[post_move_piece_type] &= ~sbitboard(last_move.destination);
-
-    // If a piece was captured as a result of this move, un-capture it.
-    position.occupier_type_lookup_table[last_move.target] = last_move.captured_piece_type;
-    position.color_bitboard[position.whos_turn] |= (sbitboard(last_move.target) * is_capture);
-    position.color_bitboard_rotated[position.whos_turn] |= (sbitboard(target_rotated) * is_capture);
-    position.type_specific_bitboard[last_move.captured_piece_type] |= sbitboard(last_move.target);
-
-    // Put the piece back on its origin square.
-    position.occupier_type_lookup_table[last_move.origin] = pre_move_piece_type;
-    position.color_bitboard[last_player_to_move] |= sbitboard(last_move.origin);
-    position.color_bitboard_rotated[last_player_to_move] |= sbitboard(origin_rotated);
-    position.type_specific_bitboard[pre_move_piece_type] |= sbitboard(last_move.origin);
-
-    position.move_log.pop();
-    position.whos_turn = last_player_to_move;
+/** Converts a file of FEN or EPD records into a dataset of packed positions, skipping malformed records. */
+int run_pack_command(const std::vector<std::string_view>& arguments) {
+    if (arguments.size() != 2) {
+        print_usage();
+        return 1;
+    }
+    std::ifstream input{std::string(arguments[0])};
+    packed_dataset_writer writer{std::string(arguments[1])};
+    if (!input || !writer.is_open()) {
+        std::cerr << "Cannot open " << (input ? arguments[1] : arguments[0]) << std::endl;
+        return 1;
+    }
+    epd_record_source source(input);
+    search_position position;
+    packed_position packed;
+    std::uint64_t written = 0;
+    std::uint64_t skipped = 0;
+    for (std::size_t count; (count = source.next_batch(4096)) > 0;) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (source.load(i, position) && pack_position(position, packed)) {
+                writer.write(packed);
+                ++written;
+            } else {
+                ++skipped;
+            }
+        }
+    }
+    if (!writer.close()) {
+        std::cerr << "Cannot write " << arguments[1] << std::endl;
+        return 1;
+    }
+    std::cerr << "Packed " << written << " positions (" << skipped << " malformed records skipped)" << std::endl;
+    return 0;
 }
 
-// Knights
-
-consteval std::array<bitboard, 64> generate_knight_move_table() {
-    std::array<bitboard, 64> table {};
-
-    for (std::uint8_t knight_file = 0; knight_file < 8; ++knight_file) {
-        for (std::uint8_t knight_rank = 0; knight_rank < 8; ++knight_rank) {
-            bitboard moves = 0;
-
-            // The following comments refer to knight moves using the format "towards x-y" where
-            // x = the direction which the knight moves two spaces.
-            // y = the direction which the knight moves one space.
-            // x, y are both in [black, kingside, white, queenside], the set of chess board cardinal directions.
-            // Also, recall that the rank approaches the black-side border as it increases.
-            // And the file approaches the kingside of the board as it increases.
-            // The origin is (rank = 0, file = 0) and it refers to the furthest white queenside space.
-
-            // There exists a towards black-queenside knight move.
-            if (knight_file > 0 && knight_rank < 6)
-                moves |= sbitboard(coords_to_sindex(knight_rank + 2, knight_file - 1));
-
-            // There exists a towards black-kingside knight move.
-            if (knight_file < 7 && knight_rank < 6)
-                moves |= sbitboard(coords_to_sindex(knight_rank + 2, knight_file + 1));
-
-            // There exists a towards queenside-black knight move.
-            if (knight_file < 6 && knight_rank < 7)
-                moves |= sbitboard(coords_to_sindex(knight_rank + 1, knight_file + 2));
-
-            // There exists a towards kingside-black knight move.
-            if (knight_file > 1 && knight_rank < 7)
-                moves |= sbitboard(coords_to_sindex(knight_rank + 1, knight_file - 2));
-
-            // There exists a towards white-queenside knight move.
-            if (knight_file > 0 && knight_rank > 1)
-                moves |= sbitboard(coords_to_sindex(knight_rank - 2, knight_file - 1));
-
-            // There exists a towards white-kingside knight move.
-            if (knight_file < 7 && knight_rank > 1)
-                moves |= sbitboard(coords_to_sindex(knight_rank - 2, knight_file + 1));
-
-            // There exists a towards queenside-white knight move.
-            if (knight_file > 1 && knight_rank > 0)
-                moves |= sbitboard(coords_to_sindex(knight_rank - 1, knight_file - 2));
-
-            // There exists a towards kingside-white knight move.
-            if (knight_file < 6 && knight_rank > 0)
-                moves |= sbitboard(coords_to_sindex(knight_rank - 1, knight_file + 2));
-
-            table[coords_to_sindex(knight_rank, knight_file)] = moves;
+/** Prints every position of a dataset of packed positions as FEN, one per line. */
+int run_unpack_command(const std::vector<std::string_view>& arguments) {
+    if (arguments.size() != 1) {
+        print_usage();
+        return 1;
+    }
+    const packed_dataset_reader reader{std::string(arguments[0])};
+    if (!reader.is_open()) {
+        std::cerr << "Cannot map packed dataset " << arguments[0] << std::endl;
+        return 1;
+    }
+    search_position position;
+    std::array<char, max_fen_length> fen;
+    std::string output_buffer;
+    for (const packed_position& packed : reader.positions()) {
+        if (!unpack_position(packed, position)) {
+            output_buffer += "; malformed\n";
+            continue;
+        }
+        output_buffer.append(fen.data(), write_fen(position, fen));
+        output_buffer += '\n';
+        if (output_buffer.size() >= 1 << 16) {
+            std::cout << output_buffer;
+            output_buffer.clear();
         }
     }
-    return table;
+    std::cout << output_buffer << std::flush;
+    return 0;
 }
 
-constinit std::array<bitboard, 64> knight_move_table = generate_knight_move_table();
-
-// Rooks
-
-[[nodiscard]] consteval std::array<std::array<bitlane, 256>, 8> generate_rooklike_move_table() {
-    std::array<std::array<bitlane, 256>, 8> table {};
-
-    for (uint8_t origin = 0; origin < 8; ++origin) {
-        for (bitlane occupancy = 255; occupancy > 0; --occupancy) {
-            bitlane destinations = 0;
-            // Towards Queenside
-            for (uint8_t towards_queenside = 1; towards_queenside <= origin; ++towards_queenside) {
-                const bitlane mark = sbitlane(origin - towards_queenside);
-                const bool is_square_occupied = mark & occupancy;
-                destinations |= mark;
-                if (is_square_occupied) break;
-            }
+int run_analyze_command(std::vector<std::string_view> arguments) {
+    search_limits limits;
+    limits.max_nodes = std::stoull(std::string(take_option(arguments, "--nodes", "0")));
+    limits.max_depth = std::stoi(std::string(take_option(arguments, "--depth", limits.max_nodes ? "0" : "6")));
+    limits.max_depth = limits.max_depth > 0 ? std::min(limits.max_depth, max_search_ply - 1) : max_search_ply - 1;
+    const std::size_t hash_megabytes = std::stoull(std::string(take_option(arguments, "--hash", "1")));
+    const unsigned default_thread_count = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned thread_count = std::max(1, std::stoi(std::string(take_option(
+            arguments, "--threads", std::to_string(default_thread_count)))));
+    const std::string_view output_path = take_option(arguments, "--output", "-");
+    if (!take_search_parameters(arguments, limits.parameters)) return 1;
+    if (arguments.size() != 1) {
+        print_usage();
+        return 1;
+    }
 
-            // Towards Kingside
-            for (uint8_t kingside_square = origin + 1; kingside_square < 8; ++kingside_square) {
-                const bitlane mark = sbitlane(kingside_square);
-                const bool is_square_occupied = mark & occupancy;
-                destinations |= mark;
-                if (is_square_occupied) break;
+    std::ofstream output_file;
+    if (output_path != "-") {
+        output_file.open(std::string(output_path));
+        if (!output_file) {
+            std::cerr << "Cannot open " << output_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = output_file.is_open() ? static_cast<std::ostream&>(output_file) : std::cout;
+
+    const std::string input_path(arguments[0]);
+    batch_analysis_statistics statistics;
+    reset_instrumentation();
+    if (input_path != "-" && is_packed_dataset(input_path)) {
+        const packed_dataset_reader reader(input_path);
+        if (!reader.is_open()) {
+            std::cerr << "Malformed packed dataset " << input_path << std::endl;
+            return 1;
+        }
+        packed_record_source source(reader.positions());
+        statistics = analyze_batch(source, output, limits, thread_count, hash_megabytes);
+    } else {
+        std::ifstream input_file;
+        if (input_path != "-") {
+            input_file.open(input_path);
+            if (!input_file) {
+                std::cerr << "Cannot open " << input_path << std::endl;
+                return 1;
             }
-            table[origin][occupancy] = destinations;
         }
+        epd_record_source source(input_file.is_open() ? static_cast<std::istream&>(input_file) : std::cin);
+        statistics = analyze_batch(source, output, limits, thread_count, hash_megabytes);
     }
-
-    return table;
+    std::cerr << "Positions: " << statistics.positions << " (" << statistics.malformed << " malformed)\n"
+              << "Time: " << std::fixed << std::setprecision(3) << statistics.seconds << "s\n"
+              << "Positions/second: " << std::setprecision(1)
+              << (statistics.seconds > 0 ? static_cast<double>(statistics.positions) / statistics.seconds : 0.0)
+              << "\n"
+              << "Nodes/second: " << nodes_per_second(statistics.nodes, statistics.seconds) << std::endl;
+    print_instrumentation_report(std::cerr, "instrumentation: ");
+    return 0;
 }
 
-constinit std::array<std::array<bitlane, 256>, 8> rooklike_move_table = generate_rooklike_move_table();
-
-
+/**
+ * Generates every table of up to the given number of pieces into the given directory, smallest first, so that each
+ * finds the tables its captures and promotions lead to among those already written.
+ */
+int run_tablebase_generate_command(const std::vector<std::string_view>& arguments) {
+    if (arguments.empty() || arguments.size() > 2) {
+        print_usage();
+        return 1;
+    }
+    const std::string directory(arguments[0]);
+    const std::size_t max_pieces = arguments.size() > 1 ? std::stoul(std::string(arguments[1])) : 3;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    tablebase_set written;
+    std::vector<tablebase_entry> entries;
+    for (const tablebase_material& material : tablebase_materials(max_pieces)) {
+        tablebase_statistics statistics;
+        bool is_generated = false;
+        const double seconds = time_seconds([&] {
+            tablebase_generator generator(material, written);
+            is_generated = generator.generate(entries, statistics);
+        });
+        const std::string path = (std::filesystem::path(directory) / material.name()).string() +
+                                 std::string(tablebase_file_extension);
+        if (!is_generated || !write_tablebase(path, material, entries) || !written.add_table(path)) {
+            std::cerr << "Cannot generate " << path << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(8) << material.name() << std::right << " wins " << std::setw(9)
+                  << statistics.wins << " draws " << std::setw(9) << statistics.draws << " losses " << std::setw(9)
+                  << statistics.losses << " longest win " << std::setw(3) << static_cast<int>(statistics.longest_win)
+                  << " plies " << std::fixed << std::setprecision(1) << std::setw(6) << seconds << "s" << std::endl;
+    }
+    return 0;
+}
 
+/** Prints what the tables know of a position: its result, its distance to zeroing and its best move. */
+int run_tablebase_probe_command(const std::vector<std::string_view>& arguments) {
+    if (!active_tablebases) {
+        std::cerr << "No tablebases, see --tablebases" << std::endl;
+        return 1;
+    }
+    const std::string fen = arguments.empty() ? std::string(starting_position_fen) : join_arguments(arguments, 0);
+    search_position position;
+    if (!load_fen(fen, position)) {
+        std::cout << "Malformed FEN: " << fen << std::endl;
+        return 1;
+    }
+    tablebase_result result;
+    if (!active_tablebases->probe(position, result)) {
+        std::cout << "Not in the tables" << std::endl;
+        return 1;
+    }
+    constexpr std::array<std::string_view, 3> result_names = { "loss", "draw", "win" };
+    std::cout << result_names[static_cast<int>(result.wdl) + 1] << ", " << static_cast<int>(result.dtz)
+              << " plies to zeroing";
+    if (!is_clear_of_fifty_move_rule(result, position.halfmove_clock)) std::cout << ", past the fifty-move rule";
+    bitmove best_move;
+    tablebase_result best;
+    if (active_tablebases->probe_root(position, best_move, best)) {
+        std::cout << ", best move " << to_long_algebraic(best_move);
+    }
+    std::cout << std::endl;
+    return 0;
+}
 
+/**
+ * Writes a book of the opening moves of the given games, each a line of long algebraic moves from the starting
+ * position. Reading a line stops at the first field which is not a legal move, such as a result.
+ */
+int run_book_make_command(const std::vector<std::string_view>& arguments, const polyglot_random_table& randoms) {
+    if (arguments.size() < 2 || arguments.size() > 3) {
+        print_usage();
+        return 1;
+    }
+    std::ifstream games{ std::string(arguments[0]) };
+    if (!games) {
+        std::cerr << "Cannot read " << arguments[0] << std::endl;
+        return 1;
+    }
+    const std::size_t max_plies = arguments.size() > 2 ? std::stoul(std::string(arguments[2])) : 16;
+    std::map<std::pair<std::uint64_t, uint16_t>, std::uint64_t> counts;
+    std::size_t game_count = 0;
+    for (std::string line; std::getline(games, line); ++game_count) {
+        search_position position;
+        [[maybe_unused]] const bool is_loaded = load_fen(starting_position_fen, position);
+        std::string_view moves = line;
+        for (std::size_t ply = 0; ply < max_plies; ++ply) {
+            const bitmove move = parse_long_algebraic(position, take_field(moves));
+            if (move.is_null()) break;
+            ++counts[{ polyglot_key(position, randoms), polyglot_move(position, move) }];
+            make_move(move, position);
+        }
+    }
+    std::vector<book_entry> entries;
+    for (const auto& [entry, count] : counts) {
+        const auto weight = static_cast<uint16_t>(std::min<std::uint64_t>(count, UINT16_MAX));
+        entries.push_back(book_entry { .key = entry.first, .move = entry.second, .weight = weight, .learn = 0 });
+    }
+    const std::string path(arguments[1]);
+    if (!write_opening_book(path, entries)) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << entries.size() << " entries from " << game_count << " games to " << path << std::endl;
+    return 0;
+}
 
-int main() {
+/** Prints the moves the book has for a position, heaviest first, with their share of the total weight. */
+int run_book_probe_command(const std::vector<std::string_view>& arguments) {
+    if (!active_book) {
+        std::cerr << "No book, see --book" << std::endl;
+        return 1;
+    }
+    const std::string fen = arguments.empty() ? std::string(starting_position_fen) : join_arguments(arguments, 0);
+    search_position position;
+    if (!load_fen(fen, position)) {
+        std::cout << "Malformed FEN: " << fen << std::endl;
+        return 1;
+    }
+    std::vector<book_move> moves;
+    std::size_t move_count = 0;
+    const double seconds = time_seconds([&] { move_count = active_book->probe(position, moves); });
+    if (move_count == 0) {
+        std::cout << "Not in the book" << std::endl;
+        return 1;
+    }
+    std::uint64_t total_weight = 0;
+    for (const book_move& move : moves) total_weight += move.weight;
+    for (const book_move& move : moves) {
+        std::cout << std::left << std::setw(6) << to_long_algebraic(move.move) << std::right << " weight "
+                  << std::setw(5) << move.weight << " " << std::fixed << std::setprecision(1) << std::setw(5)
+                  << 100.0 * move.weight / static_cast<double>(total_weight) << "%\n";
+    }
+    std::cout << "Probed " << active_book->entry_count() << " entries in " << std::setprecision(1)
+              << seconds * 1e6 << " us" << std::endl;
     return 0;
 }
+
+int main(int argc, char** argv) {
+    std::vector<std::string_view> arguments(argv + 1, argv + argc);
+    const std::string network_path(take_option(arguments, "--nnue", ""));
+    std::unique_ptr<nnue_network> network;
+    if (!network_path.empty()) {
+        network = std::make_unique<nnue_network>(network_path);
+        if (!network->is_open()) {
+            std::cerr << "Cannot map network " << network_path << std::endl;
+            return 1;
+        }
+        active_network = network.get();
+    }
+    const std::string tablebase_directory(take_option(arguments, "--tablebases", ""));
+    std::unique_ptr<tablebase_set> tablebases;
+    if (!tablebase_directory.empty()) {
+        tablebases = std::make_unique<tablebase_set>(tablebase_directory);
+        if (tablebases->table_count() == 0) {
+            std::cerr << "No tablebases in " << tablebase_directory << std::endl;
+            return 1;
+        }
+        active_tablebases = tablebases.get();
+    }
+    const std::string book_keys_path(take_option(arguments, "--book-keys", ""));
+    polyglot_random_table book_randoms = polyglot_randoms;
+    if (!book_keys_path.empty() && !load_polyglot_randoms(book_keys_path, book_randoms)) {
+        std::cerr << "Cannot read the 781 Polyglot random numbers from " << book_keys_path << std::endl;
+        return 1;
+    }
+    const std::string book_path(take_option(arguments, "--book", ""));
+    std::unique_ptr<opening_book> book;
+    if (!book_path.empty()) {
+        book = std::make_unique<opening_book>(book_path, book_randoms);
+        if (!book->is_open()) {
+            std::cerr << "Cannot map book " << book_path << std::endl;
+            return 1;
+        }
+        active_book = book.get();
+    }
+    if (!arguments.empty() && arguments[0] == "perft") {
+        reset_instrumentation();
+        const int status = run_perft_command({ arguments.begin() + 1, arguments.end() });
+        print_instrumentation_report(std::cout, "instrumentation: ");
+        return status;
+    }
+    if (!arguments.empty() && arguments[0] == "search") {
+        return run_search_command({ arguments.begin() + 1, arguments.end() });
+    }
+    if (!arguments.empty() && arguments[0] == "fen-bench") {
+        return run_fen_benchmark_command({ arguments.begin() + 1, arguments.end() });
+    }
+    if (!arguments.empty() && arguments[0] == "pack") {
+        return run_pack_command({ arguments.begin() + 1, arguments.end() });
+    }
+    if (!arguments.empty() && arguments[0] == "unpack") {
+        return run_unpack_command({ arguments.begin() + 1, arguments.end() });
+    }
+    if (!arguments.empty() && arguments[0] == "analyze") {
+        return run_analyze_command({ arguments.begin() + 1, arguments.end() });
+    }
+    if (arguments.size() >= 2 && arguments[0] == "tablebase" && arguments[1] == "generate") {
+        return run_tablebase_generate_command({ arguments.begin() + 2, arguments.end() });
+    }
+    if (arguments.size() >= 2 && arguments[0] == "tablebase" && arguments[1] == "probe") {
+        return run_tablebase_probe_command({ arguments.begin() + 2, arguments.end() });
+    }
+    if (arguments.size() >= 2 && arguments[0] == "book" && arguments[1] == "make") {
+        return run_book_make_command({ arguments.begin() + 2, arguments.end() }, book_randoms);
+    }
+    if (arguments.size() >= 2 && arguments[0] == "book" && arguments[1] == "probe") {
+        return run_book_probe_command({ arguments.begin() + 2, arguments.end() });
+    }
+    if (!arguments.empty() && arguments[0] == "smp-bench") {
+        return run_smp_benchmark_command({ arguments.begin() + 1, arguments.end() });
+    }
+    if (arguments.empty()) {
+        return run_uci_loop();
+    }
+    print_usage();
+    return 1;
+}